@@ -0,0 +1,108 @@
+// Sustained append throughput of `append_writer` against `mmap_ostream`, which
+// grows its mapping as it goes. Each variant writes the same records to a fresh
+// file, and the time includes closing the file.
+//
+// usage: mio.append_writer.benchmark [size in MiB] [record size in bytes] [batch size in KiB]
+
+#include "benchmark.hpp"
+
+#include <mio/append_writer.hpp>
+#include <mio/mmap_iostream.hpp>
+
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+const char* path = "bench-append-writer-file";
+
+void run_ostream(const std::vector<char>& record, size_t count)
+{
+    std::remove(path);
+    const auto start = bench::clock::now();
+    {
+        mio::mmap_ostream out(path, std::ios_base::out | std::ios_base::trunc);
+        for(size_t i = 0; i < count; ++i) { out.write(record.data(), record.size()); }
+    }
+    bench::report_throughput("mmap_ostream", record.size() * count, bench::seconds_since(start));
+}
+
+void run_writer(const std::vector<char>& record, size_t count, size_t batch_size)
+{
+    std::remove(path);
+    const auto start = bench::clock::now();
+    std::error_code error;
+    {
+        mio::append_writer_options options;
+        options.batch_size = batch_size;
+        options.truncate = true;
+        mio::append_writer writer(path, options);
+        for(size_t i = 0; i < count && !error; ++i)
+        {
+            writer.append(record.data(), record.size(), error);
+        }
+        if(!error) { writer.close(error); }
+    }
+    if(error)
+    {
+        std::printf("append_writer failed: %s\n", error.message().c_str());
+        return;
+    }
+    bench::report_throughput("append_writer", record.size() * count, bench::seconds_since(start));
+}
+
+// Appends while reading back the last record through the view every so often, as
+// a consumer tailing recent writes would.
+void run_writer_with_reads(const std::vector<char>& record, size_t count, size_t batch_size)
+{
+    std::remove(path);
+    const auto start = bench::clock::now();
+    std::error_code error;
+    uint64_t sum = 0;
+    {
+        mio::append_writer_options options;
+        options.batch_size = batch_size;
+        options.truncate = true;
+        mio::append_writer writer(path, options);
+        const size_t read_every = std::max<size_t>(batch_size / record.size(), 1);
+        for(size_t i = 0; i < count && !error; ++i)
+        {
+            writer.append(record.data(), record.size(), error);
+            if(i % read_every == 0 && writer.committed_size() > 0)
+            {
+                const auto view = writer.view(error);
+                sum += static_cast<unsigned char>(view[view.size() - 1]);
+            }
+        }
+        if(!error) { writer.close(error); }
+    }
+    bench::keep(sum);
+    if(error)
+    {
+        std::printf("append_writer failed: %s\n", error.message().c_str());
+        return;
+    }
+    bench::report_throughput("append_writer + view reads", record.size() * count,
+        bench::seconds_since(start));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t size = bench::arg(argc, argv, 1, 512) << 20;
+    const size_t record_size = std::max<size_t>(bench::arg(argc, argv, 2, 256), 1);
+    const size_t batch_size = bench::arg(argc, argv, 3, 1024) << 10;
+
+    std::vector<char> record(record_size);
+    for(size_t i = 0; i < record.size(); ++i) { record[i] = static_cast<char>(i * 31); }
+    const size_t count = size / record_size;
+
+    for(int round = 0; round < 2; ++round)
+    {
+        run_ostream(record, count);
+        run_writer(record, count, batch_size);
+        run_writer_with_reads(record, count, batch_size);
+    }
+    std::remove(path);
+}
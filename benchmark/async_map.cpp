@@ -0,0 +1,60 @@
+// Time the calling thread, e.g. an event loop, is blocked setting up mappings of
+// files that are not in the page cache: mapping and prefaulting each of them in
+// place, against submitting them to `async_map` with `prefault`. Also reports how
+// long the asynchronous mappings take to complete.
+//
+// usage: mio.async_map.benchmark [number of files] [file size in MiB]
+
+#include "benchmark.hpp"
+
+#include <mio/async_map.hpp>
+#include <mio/mmap.hpp>
+#include <mio/page.hpp>
+
+#include <cstdio>
+#include <future>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+std::string file_path(size_t i) { return "bench-async-map-" + std::to_string(i); }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t count = bench::arg(argc, argv, 1, 16);
+    const size_t size = bench::arg(argc, argv, 2, 16) << 20;
+    for(size_t i = 0; i < count; ++i) { bench::create_file(file_path(i).c_str(), size); }
+
+    {
+        for(size_t i = 0; i < count; ++i) { bench::drop_cache(file_path(i).c_str()); }
+        std::vector<mio::mmap_source> mmaps(count);
+        std::error_code error;
+        const auto start = bench::clock::now();
+        for(size_t i = 0; i < count; ++i)
+        {
+            mmaps[i].map(file_path(i), error);
+            if(!error) { mio::prefault(mmaps[i].data(), mmaps[i].size()); }
+        }
+        std::printf("%-24s caller blocked %8.2f ms\n", "map + prefault",
+            bench::seconds_since(start) * 1e3);
+    }
+    {
+        for(size_t i = 0; i < count; ++i) { bench::drop_cache(file_path(i).c_str()); }
+        std::vector<std::future<mio::async_map_result<mio::mmap_source>>> futures;
+        mio::async_map_options options;
+        options.prefault = true;
+        const auto start = bench::clock::now();
+        for(size_t i = 0; i < count; ++i) { futures.push_back(mio::async_map(file_path(i), options)); }
+        const double blocked = bench::seconds_since(start);
+        size_t failed = 0;
+        for(auto& future : futures) { failed += static_cast<bool>(future.get().error); }
+        std::printf("%-24s caller blocked %8.2f ms, completed after %.2f ms, %zu failed\n",
+            "async_map", blocked * 1e3, bench::seconds_since(start) * 1e3, failed);
+    }
+
+    for(size_t i = 0; i < count; ++i) { std::remove(file_path(i).c_str()); }
+}
@@ -0,0 +1,144 @@
+#ifndef MIO_BENCHMARK_HEADER
+#define MIO_BENCHMARK_HEADER
+
+#include <mio/page.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// Helpers shared by the benchmark executables. These are POSIX only.
+namespace bench {
+
+using clock = std::chrono::steady_clock;
+
+inline double seconds_since(clock::time_point start)
+{
+    return std::chrono::duration<double>(clock::now() - start).count();
+}
+
+/** Returns the `index`th command line argument as a number, or `fallback`. */
+inline size_t arg(int argc, char** argv, int index, size_t fallback)
+{
+    return argc > index ? std::strtoull(argv[index], nullptr, 10) : fallback;
+}
+
+/** Creates a `size` byte file at `path` filled with a non-repeating pattern. */
+inline void create_file(const char* path, size_t size)
+{
+    const int fd = ::open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if(fd == -1) { std::perror("open"); std::exit(1); }
+    std::vector<char> block(1 << 20);
+    uint64_t x = 88172645463325252ull;
+    for(size_t written = 0; written < size;)
+    {
+        for(auto& b : block) { x ^= x << 13; x ^= x >> 7; x ^= x << 17; b = static_cast<char>(x); }
+        const size_t n = std::min(block.size(), size - written);
+        if(::write(fd, block.data(), n) != static_cast<ssize_t>(n)) { std::perror("write"); std::exit(1); }
+        written += n;
+    }
+    ::fsync(fd);
+    ::close(fd);
+}
+
+/**
+ * Evicts the file's pages from the page cache, so that the next access hits the
+ * disk. This only works on file systems backed by a block device.
+ */
+inline void drop_cache(const char* path)
+{
+    const int fd = ::open(path, O_RDONLY);
+    if(fd == -1) { return; }
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+}
+
+inline volatile uint64_t& sink()
+{
+    static volatile uint64_t value;
+    return value;
+}
+
+/** Stores `value` where the compiler can't prove it unused. */
+inline void keep(uint64_t value) { sink() = value; }
+
+/** Reads one byte of every page, returning their sum so the reads are kept. */
+inline uint64_t touch_pages(const char* data, size_t size)
+{
+    uint64_t sum = 0;
+    const size_t page_size = mio::page_size();
+    for(size_t i = 0; i < size; i += page_size) { sum += static_cast<unsigned char>(data[i]); }
+    return sum;
+}
+
+/** Returns the number of the file's pages that are in the page cache. */
+inline size_t cached_pages(const char* path)
+{
+    const int fd = ::open(path, O_RDONLY);
+    if(fd == -1) { return 0; }
+    const off_t size = ::lseek(fd, 0, SEEK_END);
+    size_t count = 0;
+    if(size > 0)
+    {
+        void* p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if(p != MAP_FAILED)
+        {
+            const size_t page_size = mio::page_size();
+            std::vector<unsigned char> vec((size + page_size - 1) / page_size);
+            if(::mincore(p, size, vec.data()) == 0)
+            {
+                for(auto v : vec) { count += v & 1; }
+            }
+            ::munmap(p, size);
+        }
+    }
+    ::close(fd);
+    return count;
+}
+
+/**
+ * Returns the current resident set size of this process in KiB, or the peak one
+ * where the current one can't be queried.
+ */
+inline long rss_kib()
+{
+    if(std::FILE* f = std::fopen("/proc/self/statm", "r"))
+    {
+        long size = 0, resident = 0;
+        const int n = std::fscanf(f, "%ld %ld", &size, &resident);
+        std::fclose(f);
+        if(n == 2) { return resident * static_cast<long>(mio::page_size() / 1024); }
+    }
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/** Returns the nearest-rank `p`th percentile of `samples`, sorting them first. */
+inline double percentile(std::vector<double>& samples, double p)
+{
+    if(samples.empty()) { return 0; }
+    std::sort(samples.begin(), samples.end());
+    const size_t rank = static_cast<size_t>(p / 100.0 * (samples.size() - 1) + 0.5);
+    return samples[std::min(rank, samples.size() - 1)];
+}
+
+inline void report_throughput(const char* name, size_t bytes, double seconds)
+{
+    std::printf("%-32s %10.1f MiB/s  (%.3f s)\n", name,
+        bytes / (1024.0 * 1024.0) / seconds, seconds);
+}
+
+} // namespace bench
+
+#endif // MIO_BENCHMARK_HEADER
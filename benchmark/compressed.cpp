@@ -0,0 +1,112 @@
+// Sequential and random 4 KiB reads of a block-compressed container through
+// `compressed_reader`, against the same reads of the raw file through `mmap_source`.
+// The data are log-like text, which compresses moderately. Reports the compression
+// ratio and the cache's hit rate.
+//
+// usage: mio.compressed.benchmark [size in MiB] [number of random reads]
+
+#include "benchmark.hpp"
+
+#include <mio/compressed.hpp>
+#include <mio/mmap.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+const char* raw_path = "bench-compressed-raw";
+const char* container_path = "bench-compressed-container";
+const size_t read_size = 4096;
+
+std::string make_data(size_t size)
+{
+    std::mt19937_64 random(42);
+    std::string data;
+    data.reserve(size + 128);
+    while(data.size() < size)
+    {
+        data += "2024-01-01 12:00:" + std::to_string(random() % 60) + " INFO request id="
+            + std::to_string(random()) + " status=" + std::to_string(200 + random() % 3 * 100)
+            + " bytes=" + std::to_string(random() % 100000) + "\n";
+    }
+    data.resize(size);
+    return data;
+}
+
+template<typename Read>
+void run(const char* name, const std::vector<size_t>& offsets, Read read)
+{
+    std::vector<char> buffer(read_size);
+    uint64_t sum = 0;
+    const auto start = bench::clock::now();
+    for(const size_t offset : offsets)
+    {
+        read(offset, buffer.data());
+        sum += buffer[0];
+    }
+    bench::keep(sum);
+    bench::report_throughput(name, offsets.size() * read_size, bench::seconds_since(start));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t size = bench::arg(argc, argv, 1, 256) << 20;
+    const size_t random_reads = bench::arg(argc, argv, 2, 100000);
+    {
+        const std::string data = make_data(size);
+        std::ofstream(raw_path, std::ios_base::binary | std::ios_base::trunc) << data;
+        const auto start = bench::clock::now();
+        mio::compressed_writer writer(container_path);
+        std::error_code error;
+        writer.write(data.data(), data.size(), error);
+        const size_t compressed = writer.compressed_size();
+        writer.close(error);
+        if(error) { std::fprintf(stderr, "compressed_writer: %s\n", error.message().c_str()); return 1; }
+        bench::report_throughput("compress", size, bench::seconds_since(start));
+        std::printf("%-32s %.2fx (%zu -> %zu bytes)\n", "compression ratio",
+            static_cast<double>(size) / compressed, size, compressed);
+    }
+
+    std::vector<size_t> sequential;
+    for(size_t offset = 0; offset + read_size <= size; offset += read_size) { sequential.push_back(offset); }
+    std::vector<size_t> random_offsets(random_reads);
+    std::mt19937_64 random(7);
+    for(auto& offset : random_offsets) { offset = random() % (size - read_size); }
+
+    mio::mmap_source raw(raw_path);
+    const auto raw_read = [&](size_t offset, char* out) { std::memcpy(out, raw.data() + offset, read_size); };
+    bench::touch_pages(raw.data(), raw.size());
+    run("mmap_source sequential", sequential, raw_read);
+    run("mmap_source random", random_offsets, raw_read);
+
+    for(const size_t cache_size : { size_t(64) << 20, size_t(4) << 20 })
+    {
+        mio::compressed_reader_options options;
+        options.cache_size = cache_size;
+        mio::compressed_reader reader(container_path, options);
+        bench::touch_pages(reader.mmap().data(), reader.mmap().size());
+        std::error_code error;
+        const auto compressed_read = [&](size_t offset, char* out)
+        {
+            reader.read(offset, out, read_size, error);
+        };
+        const std::string suffix = " (" + std::to_string(cache_size >> 20) + " MiB cache)";
+        run(("compressed sequential" + suffix).c_str(), sequential, compressed_read);
+        run(("compressed random" + suffix).c_str(), random_offsets, compressed_read);
+        const auto stats = reader.stats();
+        std::printf("%-32s %.1f%% hits, %llu evictions\n", "", 100.0 * stats.hits
+            / static_cast<double>(stats.hits + stats.misses),
+            static_cast<unsigned long long>(stats.evictions));
+    }
+
+    std::remove(raw_path);
+    std::remove(container_path);
+}
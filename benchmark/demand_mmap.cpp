@@ -0,0 +1,52 @@
+// Sequential scan of a `demand_mmap` filled by an in-process provider that computes
+// its pages, with no fault-around, with the default fault-around, and with the
+// whole range prefetched ahead of the scan. Reports throughput and the number of
+// faults and provider calls each took.
+//
+// usage: mio.demand_mmap.benchmark [size in MiB]
+
+#include "benchmark.hpp"
+
+#include <mio/demand_mmap.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+
+namespace {
+
+void fill(size_t offset, char* buffer, size_t length, std::error_code&)
+{
+    std::memset(buffer, static_cast<int>(offset >> 12), length);
+}
+
+void run(const char* name, size_t size, const mio::demand_options& options, bool prefetch)
+{
+    mio::demand_mmap mmap;
+    std::error_code error;
+    mmap.map(size, fill, options, error);
+    if(error) { std::fprintf(stderr, "demand_mmap: %s\n", error.message().c_str()); std::exit(1); }
+    const auto start = bench::clock::now();
+    if(prefetch) { mmap.prefetch(0, size); }
+    bench::keep(bench::touch_pages(mmap.data(), mmap.size()));
+    const double seconds = bench::seconds_since(start);
+    const auto stats = mmap.stats();
+    bench::report_throughput(name, size, seconds);
+    std::printf("%-32s %llu faults, %llu provider calls, %llu pages filled ahead\n", "",
+        static_cast<unsigned long long>(stats.faults),
+        static_cast<unsigned long long>(stats.batches),
+        static_cast<unsigned long long>(stats.pages_prefetched));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t size = bench::arg(argc, argv, 1, 256) << 20;
+
+    mio::demand_options options;
+    options.fault_around = 0;
+    run("no fault-around", size, options, false);
+    run("fault-around 15", size, mio::demand_options(), false);
+    run("fault-around 15, prefetch", size, mio::demand_options(), true);
+}
@@ -0,0 +1,71 @@
+// One-pass scan through a mapping versus `direct_reader`, reporting throughput
+// and how much of the file is left in the page cache afterwards.
+//
+// usage: mio.direct_reader.benchmark [size in MiB] [chunk size in KiB]
+
+#include "benchmark.hpp"
+
+#include <mio/mmap.hpp>
+#include <mio/chunk_reader.hpp>
+#include <mio/direct_reader.hpp>
+
+#include <cstdio>
+
+namespace {
+
+const char* path = "bench-direct-reader-file";
+
+uint64_t checksum(const mio::span<const char>& chunk)
+{
+    uint64_t sum = 0;
+    for(size_t i = 0; i < chunk.size(); i += 64) { sum += static_cast<unsigned char>(chunk[i]); }
+    return sum;
+}
+
+template<typename Reader>
+void scan(Reader& reader, const char* name, size_t size, bench::clock::time_point start)
+{
+    uint64_t sum = 0;
+    for(const auto& chunk : reader) { sum += checksum(chunk); }
+    const double seconds = bench::seconds_since(start);
+    bench::keep(sum);
+    bench::report_throughput(name, size, seconds);
+}
+
+void report_footprint(size_t size)
+{
+    const size_t cached = bench::cached_pages(path) * mio::page_size();
+    std::printf("%-32s %6.1f%% of the file cached, rss %ld KiB\n", "",
+        100.0 * cached / size, bench::rss_kib());
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t size = bench::arg(argc, argv, 1, 1024) << 20;
+    const size_t chunk_size = bench::arg(argc, argv, 2, 1024) << 10;
+    bench::create_file(path, size);
+
+    {
+        bench::drop_cache(path);
+        const auto start = bench::clock::now();
+        mio::mmap_source mmap(path);
+        mio::mmap_chunk_reader reader(mmap, chunk_size);
+        scan(reader, "mmap_source", size, start);
+        report_footprint(size);
+    }
+
+    {
+        bench::drop_cache(path);
+        const auto start = bench::clock::now();
+        mio::direct_reader_options options;
+        options.chunk_size = chunk_size;
+        mio::direct_reader reader(path, options);
+        scan(reader, reader.is_direct() ? "direct_reader (O_DIRECT)"
+            : "direct_reader (buffered)", size, start);
+        report_footprint(size);
+    }
+
+    std::remove(path);
+}
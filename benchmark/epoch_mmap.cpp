@@ -0,0 +1,135 @@
+// Read throughput of many threads reading a mapping that a writer keeps growing,
+// with `epoch_mmap_sink` guards against a `std::shared_mutex` around an
+// `mmap_sink` that is remapped in place. Each read pins the mapping and sums a
+// few bytes at random offsets.
+//
+// usage: mio.epoch_mmap.benchmark [seconds per run] [max readers] [remap interval in us]
+
+#include "benchmark.hpp"
+
+#include <mio/mmap.hpp>
+#include <mio/epoch_mmap.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* path = "bench-epoch-mmap-file";
+const size_t initial_size = 16 << 20;
+const size_t growth = 64 << 10;
+
+struct result
+{
+    uint64_t reads = 0;
+    uint64_t remaps = 0;
+    double remap_seconds = 0;
+};
+
+template<typename Read, typename Remap>
+result run(size_t num_readers, double duration, size_t interval_us, Read read, Remap remap)
+{
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> reads(0);
+    std::vector<std::thread> readers;
+    for(size_t t = 0; t < num_readers; ++t)
+    {
+        readers.emplace_back([&, t]
+        {
+            std::minstd_rand rng(static_cast<unsigned>(t + 1));
+            uint64_t n = 0, sum = 0;
+            while(!stop)
+            {
+                sum += read(rng);
+                ++n;
+            }
+            reads += n;
+            bench::keep(sum);
+        });
+    }
+
+    result r;
+    size_t size = initial_size;
+    const auto start = bench::clock::now();
+    while(bench::seconds_since(start) < duration)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(interval_us));
+        size += growth;
+        const auto t = bench::clock::now();
+        remap(size);
+        r.remap_seconds += bench::seconds_since(t);
+        ++r.remaps;
+    }
+    stop = true;
+    for(auto& t : readers) { t.join(); }
+    r.reads = reads;
+    return r;
+}
+
+void report(const char* name, size_t num_readers, double duration, const result& r)
+{
+    std::printf("%-14s %3zu readers %12.0f reads/s %10.0f per reader  %5llu remaps, %8.1f us each\n",
+        name, num_readers, r.reads / duration, r.reads / duration / num_readers,
+        (unsigned long long)r.remaps, r.remaps ? r.remap_seconds / r.remaps * 1e6 : 0.0);
+}
+
+template<typename Guard, typename Rng>
+uint64_t sum_bytes(const Guard& data, size_t size, Rng& rng)
+{
+    uint64_t sum = 0;
+    for(int i = 0; i < 4; ++i) { sum += static_cast<unsigned char>(data[rng() % size]); }
+    return sum;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const double duration = static_cast<double>(bench::arg(argc, argv, 1, 1));
+    const size_t max_readers = bench::arg(argc, argv, 2, 64);
+    const size_t interval_us = bench::arg(argc, argv, 3, 1000);
+
+    for(size_t num_readers = 1; num_readers <= max_readers; num_readers *= 2)
+    {
+        bench::create_file(path, initial_size);
+        {
+            mio::epoch_mmap_sink mmap(path);
+            const auto r = run(num_readers, duration, interval_us,
+                [&](std::minstd_rand& rng)
+                {
+                    const auto guard = mmap.pin();
+                    return sum_bytes(guard.data(), guard.size(), rng);
+                },
+                [&](size_t size)
+                {
+                    std::error_code error;
+                    mmap.remap(0, size, error);
+                });
+            report("epoch_mmap", num_readers, duration, r);
+        }
+
+        bench::create_file(path, initial_size);
+        {
+            mio::mmap_sink mmap(path);
+            std::shared_mutex mutex;
+            const auto r = run(num_readers, duration, interval_us,
+                [&](std::minstd_rand& rng)
+                {
+                    std::shared_lock<std::shared_mutex> lock(mutex);
+                    return sum_bytes(mmap.data(), mmap.size(), rng);
+                },
+                [&](size_t size)
+                {
+                    std::unique_lock<std::shared_mutex> lock(mutex);
+                    std::error_code error;
+                    mmap.remap(0, size, error);
+                });
+            report("shared_mutex", num_readers, duration, r);
+        }
+    }
+    std::remove(path);
+}
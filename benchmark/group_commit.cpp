@@ -0,0 +1,95 @@
+// Commits per second and commit latency of concurrent writers that each write a
+// small record to a shared mapping and wait for it to be durable, either with their
+// own `sync` or through a `group_commit` coordinator.
+//
+// usage: mio.group_commit.benchmark [seconds per run] [record size in bytes] [window in us]
+
+#include "benchmark.hpp"
+
+#include <mio/mmap.hpp>
+#include <mio/group_commit.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* path = "bench-group-commit-file";
+const size_t file_size = 64 << 20;
+
+template<typename Commit>
+void run(const char* name, mio::mmap_sink& mmap, size_t num_writers, double duration,
+        size_t record_size, Commit commit)
+{
+    std::atomic<bool> stop(false);
+    std::mutex mutex;
+    std::vector<double> latencies;
+    std::vector<std::thread> writers;
+    for(size_t t = 0; t < num_writers; ++t)
+    {
+        writers.emplace_back([&, t]
+        {
+            std::vector<double> local;
+            const size_t slots = file_size / record_size / num_writers;
+            for(size_t i = 0; !stop; ++i)
+            {
+                const size_t offset = ((i % slots) * num_writers + t) * record_size;
+                std::fill_n(mmap.data() + offset, record_size, static_cast<char>(i));
+                const auto start = bench::clock::now();
+                commit(offset, record_size);
+                local.push_back(bench::seconds_since(start) * 1e6);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            latencies.insert(latencies.end(), local.begin(), local.end());
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+    stop = true;
+    for(auto& w : writers) { w.join(); }
+
+    const size_t commits = latencies.size();
+    std::printf("%-24s %3zu writers %10.0f commits/s  p50 %8.1f us  p99 %8.1f us\n",
+        name, num_writers, commits / duration, bench::percentile(latencies, 50),
+        bench::percentile(latencies, 99));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const double duration = static_cast<double>(bench::arg(argc, argv, 1, 1));
+    const size_t record_size = std::max<size_t>(bench::arg(argc, argv, 2, 128), 1);
+    const auto window = std::chrono::microseconds(bench::arg(argc, argv, 3, 100));
+    bench::create_file(path, file_size);
+
+    mio::mmap_sink mmap(path);
+    for(size_t num_writers : { 1, 2, 4, 8, 16, 32, 64 })
+    {
+        run("sync per writer", mmap, num_writers, duration, record_size,
+            [&](size_t, size_t)
+            {
+                std::error_code error;
+                mmap.sync(error);
+            });
+
+        for(auto w : { std::chrono::microseconds(0), window })
+        {
+            mio::group_commit commit(mmap, w);
+            char name[32];
+            std::snprintf(name, sizeof(name), "group commit, %lldus", (long long)w.count());
+            run(name, mmap, num_writers, duration, record_size,
+                [&](size_t offset, size_t length)
+                {
+                    std::error_code error;
+                    commit.commit(offset, length, error);
+                });
+        }
+    }
+    mmap.unmap();
+    std::remove(path);
+}
@@ -0,0 +1,99 @@
+// Durable small transactions per second through a `journal`, against writing to
+// an `mmap_sink` and syncing the whole mapping after each transaction. Every
+// transaction writes a few small records at random offsets. The journal's time
+// includes the final checkpoint that syncs the data file.
+//
+// usage: mio.journal.benchmark [data size in MiB] [transactions] [writes per transaction]
+
+#include "benchmark.hpp"
+
+#include <mio/mmap.hpp>
+#include <mio/journal.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+const char* path = "bench-journal-file";
+const char* log_path = "bench-journal-log";
+const size_t record_size = 64;
+
+void report(const char* name, size_t transactions, std::vector<double>& latencies, double seconds)
+{
+    std::printf("%-24s %10.0f transactions/s  p50 %8.1f us  p99 %8.1f us\n", name,
+        transactions / seconds, bench::percentile(latencies, 50), bench::percentile(latencies, 99));
+}
+
+void run_sync(size_t transactions, size_t writes)
+{
+    mio::mmap_sink mmap(path);
+    std::mt19937_64 rng(1);
+    char record[record_size];
+    std::vector<double> latencies;
+    const auto start = bench::clock::now();
+    for(size_t i = 0; i < transactions; ++i)
+    {
+        const auto t = bench::clock::now();
+        for(size_t w = 0; w < writes; ++w)
+        {
+            std::memset(record, static_cast<int>(i), sizeof(record));
+            std::memcpy(mmap.data() + rng() % (mmap.size() - record_size), record, sizeof(record));
+        }
+        std::error_code error;
+        mmap.sync(error);
+        latencies.push_back(bench::seconds_since(t) * 1e6);
+    }
+    report("write + sync", transactions, latencies, bench::seconds_since(start));
+}
+
+void run_journal(const char* name, bool lazy, size_t transactions, size_t writes)
+{
+    mio::journal_options options;
+    options.lazy_apply = lazy;
+    mio::journal journal(path, log_path, options);
+    std::mt19937_64 rng(1);
+    char record[record_size];
+    std::vector<double> latencies;
+    const auto start = bench::clock::now();
+    for(size_t i = 0; i < transactions; ++i)
+    {
+        const auto t = bench::clock::now();
+        auto transaction = journal.begin();
+        for(size_t w = 0; w < writes; ++w)
+        {
+            std::memset(record, static_cast<int>(i), sizeof(record));
+            transaction.write(rng() % (journal.size() - record_size), record, sizeof(record));
+        }
+        std::error_code error;
+        journal.commit(transaction, error);
+        if(error) { std::printf("commit failed: %s\n", error.message().c_str()); return; }
+        latencies.push_back(bench::seconds_since(t) * 1e6);
+    }
+    const double commit_seconds = bench::seconds_since(start);
+    std::error_code error;
+    journal.close(error);
+    report(name, transactions, latencies, bench::seconds_since(start));
+    std::printf("%24s %10.0f transactions/s before the checkpoint, which took %.3f s\n", "",
+        transactions / commit_seconds, bench::seconds_since(start) - commit_seconds);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t size = bench::arg(argc, argv, 1, 1024) << 20;
+    const size_t transactions = bench::arg(argc, argv, 2, 10000);
+    const size_t writes = std::max<size_t>(bench::arg(argc, argv, 3, 4), 1);
+    bench::create_file(path, size);
+    std::remove(log_path);
+
+    run_sync(transactions, writes);
+    run_journal("journal, lazy apply", true, transactions, writes);
+    run_journal("journal, apply on commit", false, transactions, writes);
+
+    std::remove(path);
+    std::remove(log_path);
+}
@@ -0,0 +1,127 @@
+// Startup cost of opening many small files of which few are read: mapping each of
+// them with `mmap_source` against opening them with `lazy_mmap_source`, which only
+// maps the ones that are accessed. Reports the time to open all the files, the
+// number of mappings of the process afterwards and the time to then read 1% of
+// them.
+//
+// usage: mio.lazy_mmap.benchmark [number of files] [file size in KiB]
+//
+// The number of files is capped by the limit on open files, which is raised to its
+// hard limit, and by the limit on mappings, vm.max_map_count.
+
+#include "benchmark.hpp"
+
+#include <mio/lazy_mmap.hpp>
+#include <mio/mmap.hpp>
+
+#include <cstdio>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+namespace {
+
+const char* directory = "bench-lazy-mmap";
+
+std::string file_path(size_t i)
+{
+    return std::string(directory) + "/" + std::to_string(i);
+}
+
+/** Returns the number of lines of /proc/self/maps, i.e. of mappings. */
+size_t count_mappings()
+{
+    size_t count = 0;
+    if(std::FILE* f = std::fopen("/proc/self/maps", "r"))
+    {
+        for(int c; (c = std::fgetc(f)) != EOF;) { count += c == '\n'; }
+        std::fclose(f);
+    }
+    return count;
+}
+
+/** Raises the limit on open files as far as allowed and returns how many to use. */
+size_t max_files(size_t wanted)
+{
+    rlimit limit;
+    if(::getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+        ::getrlimit(RLIMIT_NOFILE, &limit);
+        // Leave some descriptors for the standard streams and /proc.
+        if(limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < wanted + 64)
+        {
+            wanted = limit.rlim_cur > 64 ? limit.rlim_cur - 64 : 0;
+        }
+    }
+    if(std::FILE* f = std::fopen("/proc/sys/vm/max_map_count", "r"))
+    {
+        size_t max_map_count = 0;
+        // Leave room for the mappings of the executable and the libraries.
+        if(std::fscanf(f, "%zu", &max_map_count) == 1 && max_map_count < wanted + 1024)
+        {
+            wanted = max_map_count > 1024 ? max_map_count - 1024 : 0;
+        }
+        std::fclose(f);
+    }
+    return wanted;
+}
+
+template<typename MMap>
+void run(const char* name, size_t count, size_t file_size)
+{
+    const size_t base_mappings = count_mappings();
+    std::vector<MMap> mmaps(count);
+    std::error_code error;
+    const auto start = bench::clock::now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        mmaps[i].map(file_path(i), error);
+        if(error) { std::fprintf(stderr, "%s: %s\n", name, error.message().c_str()); std::exit(1); }
+    }
+    const double open_seconds = bench::seconds_since(start);
+    const size_t mappings = count_mappings() - base_mappings;
+
+    uint64_t sum = 0;
+    const auto read_start = bench::clock::now();
+    for(size_t i = 0; i < count; i += 100) { sum += bench::touch_pages(mmaps[i].data(), file_size); }
+    const double read_seconds = bench::seconds_since(read_start);
+    bench::keep(sum);
+
+    std::printf("%-20s open %8.1f ms (%6.2f us/file), %7zu mappings, read 1%% %6.1f ms\n",
+        name, open_seconds * 1e3, open_seconds * 1e6 / count, mappings, read_seconds * 1e3);
+
+    const auto close_start = bench::clock::now();
+    mmaps.clear();
+    std::printf("%-20s close %7.1f ms\n", "", bench::seconds_since(close_start) * 1e3);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t wanted = bench::arg(argc, argv, 1, 100000);
+    const size_t file_size = bench::arg(argc, argv, 2, 4) << 10;
+    const size_t count = max_files(wanted);
+    if(count < wanted) { std::printf("limited to %zu files\n", count); }
+
+    ::mkdir(directory, 0755);
+    const std::vector<char> contents(file_size, 'x');
+    for(size_t i = 0; i < count; ++i)
+    {
+        std::FILE* f = std::fopen(file_path(i).c_str(), "wb");
+        if(!f) { std::perror("fopen"); return 1; }
+        std::fwrite(contents.data(), 1, contents.size(), f);
+        std::fclose(f);
+    }
+
+    run<mio::mmap_source>("mmap_source", count, file_size);
+    run<mio::lazy_mmap_source>("lazy_mmap_source", count, file_size);
+
+    for(size_t i = 0; i < count; ++i) { std::remove(file_path(i).c_str()); }
+    ::rmdir(directory);
+}
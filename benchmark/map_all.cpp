@@ -0,0 +1,110 @@
+// Mapping many files with `map_all`, in parallel on a thread pool, against mapping
+// them one after the other with `mmap_source::map`. Reports the wall-clock time of
+// each, and for `map_all` the parallelism achieved. Parallelism pays off where
+// opening a file is slow, e.g. on a network file system or with a cold dentry cache,
+// and with as many hardware threads as the pool has workers.
+//
+// usage: mio.map_all.benchmark [number of files] [threads] [batch size]
+//
+// The number of files is capped by the limit on open files, which is raised to its
+// hard limit, and by the limit on mappings, vm.max_map_count.
+
+#include "benchmark.hpp"
+
+#include <mio/map_all.hpp>
+#include <mio/mmap.hpp>
+#include <mio/thread_pool.hpp>
+
+#include <cstdio>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+namespace {
+
+const char* directory = "bench-map-all";
+
+/** Raises the limit on open files as far as allowed and returns how many to use. */
+size_t max_files(size_t wanted)
+{
+    rlimit limit;
+    if(::getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+        ::getrlimit(RLIMIT_NOFILE, &limit);
+        if(limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < wanted + 64)
+        {
+            wanted = limit.rlim_cur > 64 ? limit.rlim_cur - 64 : 0;
+        }
+    }
+    if(std::FILE* f = std::fopen("/proc/sys/vm/max_map_count", "r"))
+    {
+        size_t max_map_count = 0;
+        if(std::fscanf(f, "%zu", &max_map_count) == 1 && max_map_count < wanted + 1024)
+        {
+            wanted = max_map_count > 1024 ? max_map_count - 1024 : 0;
+        }
+        std::fclose(f);
+    }
+    return wanted;
+}
+
+double milliseconds(std::chrono::nanoseconds duration) { return duration.count() / 1e6; }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t wanted = bench::arg(argc, argv, 1, 20000);
+    const size_t threads = bench::arg(argc, argv, 2, std::thread::hardware_concurrency());
+    const size_t batch_size = bench::arg(argc, argv, 3, 64);
+    const size_t count = max_files(wanted);
+    if(count < wanted) { std::printf("limited to %zu files\n", count); }
+
+    ::mkdir(directory, 0755);
+    std::vector<std::string> paths;
+    const std::string contents(4096, 'x');
+    for(size_t i = 0; i < count; ++i)
+    {
+        paths.push_back(std::string(directory) + "/" + std::to_string(i));
+        std::FILE* f = std::fopen(paths.back().c_str(), "wb");
+        if(!f) { std::perror("fopen"); return 1; }
+        std::fwrite(contents.data(), 1, contents.size(), f);
+        std::fclose(f);
+    }
+
+    {
+        std::vector<mio::mmap_source> mmaps(count);
+        std::error_code error;
+        size_t failed = 0;
+        const auto start = bench::clock::now();
+        for(size_t i = 0; i < count; ++i)
+        {
+            mmaps[i].map(paths[i], error);
+            failed += static_cast<bool>(error);
+        }
+        const double seconds = bench::seconds_since(start);
+        std::printf("%-24s %8.1f ms (%6.2f us/file), %zu failed\n", "sequential map",
+            seconds * 1e3, seconds * 1e6 / count, failed);
+    }
+    {
+        mio::thread_pool pool(threads);
+        mio::batch_options options;
+        options.batch_size = batch_size;
+        const auto result = mio::map_all(paths, options, pool);
+        const double elapsed = milliseconds(result.elapsed);
+        char name[32];
+        std::snprintf(name, sizeof(name), "map_all, %zu threads", pool.size());
+        std::printf("%-24s %8.1f ms (%6.2f us/file), %zu failed, parallelism %.2f\n", name,
+            elapsed, elapsed * 1e3 / count, result.num_failed(),
+            elapsed > 0 ? milliseconds(result.busy_time) / elapsed : 0.0);
+    }
+
+    for(const auto& path : paths) { std::remove(path.c_str()); }
+    ::rmdir(directory);
+}
@@ -0,0 +1,155 @@
+// Many small files stored in a `pack_writer` archive against one file, and one
+// mapping, each. Reports the startup cost, i.e. the time to open and map everything
+// and the number of mappings it takes, and the mean latency of looking up an entry
+// by name and reading its first byte: in the archive with `pack_reader::find`, for
+// the individual files in a hash map from name to mapping.
+//
+// usage: mio.pack.benchmark [number of files] [file size in bytes]
+//
+// The individual files are capped by the limit on open files, which is raised to
+// its hard limit, and by the limit on mappings, vm.max_map_count; the archive is
+// not.
+
+#include "benchmark.hpp"
+
+#include <mio/mmap.hpp>
+#include <mio/pack.hpp>
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+namespace {
+
+const char* directory = "bench-pack";
+const char* pack_path = "bench-pack-file";
+
+std::string entry_name(size_t i) { return "assets/" + std::to_string(i) + ".bin"; }
+
+std::string file_path(size_t i) { return std::string(directory) + "/" + std::to_string(i); }
+
+size_t count_mappings()
+{
+    size_t count = 0;
+    if(std::FILE* f = std::fopen("/proc/self/maps", "r"))
+    {
+        for(int c; (c = std::fgetc(f)) != EOF;) { count += c == '\n'; }
+        std::fclose(f);
+    }
+    return count;
+}
+
+/** Raises the limit on open files as far as allowed and returns how many to use. */
+size_t max_files(size_t wanted)
+{
+    rlimit limit;
+    if(::getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+        ::getrlimit(RLIMIT_NOFILE, &limit);
+        if(limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < wanted + 64)
+        {
+            wanted = limit.rlim_cur > 64 ? limit.rlim_cur - 64 : 0;
+        }
+    }
+    if(std::FILE* f = std::fopen("/proc/sys/vm/max_map_count", "r"))
+    {
+        size_t max_map_count = 0;
+        if(std::fscanf(f, "%zu", &max_map_count) == 1 && max_map_count < wanted + 1024)
+        {
+            wanted = max_map_count > 1024 ? max_map_count - 1024 : 0;
+        }
+        std::fclose(f);
+    }
+    return wanted;
+}
+
+/** Looks up random entries with `find`, returning the mean time per lookup in ns. */
+template<typename Find>
+double lookup(size_t count, Find find)
+{
+    const size_t lookups = 1 << 20;
+    std::vector<std::string> names;
+    std::mt19937_64 random(42);
+    for(size_t i = 0; i < 4096; ++i) { names.push_back(entry_name(random() % count)); }
+    uint64_t sum = 0;
+    const auto start = bench::clock::now();
+    for(size_t i = 0; i < lookups; ++i) { sum += static_cast<unsigned char>(*find(names[i % names.size()])); }
+    const double seconds = bench::seconds_since(start);
+    bench::keep(sum);
+    return seconds * 1e9 / lookups;
+}
+
+void report(const char* name, size_t count, double seconds, size_t mappings, double lookup_ns)
+{
+    std::printf("%-20s %8zu files, startup %8.2f ms (%6.3f us/file), %6zu mappings, lookup %6.1f ns\n",
+        name, count, seconds * 1e3, seconds * 1e6 / count, mappings, lookup_ns);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t count = bench::arg(argc, argv, 1, 1000000);
+    const size_t file_size = std::max<size_t>(bench::arg(argc, argv, 2, 512), 1);
+    const std::string contents(file_size, 'x');
+
+    {
+        const auto start = bench::clock::now();
+        mio::pack_writer writer(pack_path);
+        std::error_code error;
+        for(size_t i = 0; i < count && !error; ++i)
+        {
+            writer.add(entry_name(i), contents.data(), contents.size(), error);
+        }
+        if(!error) { writer.close(error); }
+        if(error) { std::fprintf(stderr, "pack: %s\n", error.message().c_str()); return 1; }
+        std::printf("%-20s %8zu files, %.1f ms\n", "pack_writer", count,
+            bench::seconds_since(start) * 1e3);
+    }
+    {
+        const size_t base_mappings = count_mappings();
+        const auto start = bench::clock::now();
+        mio::pack_reader reader(pack_path);
+        const double seconds = bench::seconds_since(start);
+        const size_t mappings = count_mappings() - base_mappings;
+        const double ns = lookup(count, [&](const std::string& name) { return reader.find(name).data(); });
+        report("pack_reader", count, seconds, mappings, ns);
+    }
+    std::remove(pack_path);
+
+    const size_t files = max_files(count);
+    if(files < count) { std::printf("individual files limited to %zu\n", files); }
+    ::mkdir(directory, 0755);
+    for(size_t i = 0; i < files; ++i)
+    {
+        std::FILE* f = std::fopen(file_path(i).c_str(), "wb");
+        if(!f) { std::perror("fopen"); return 1; }
+        std::fwrite(contents.data(), 1, contents.size(), f);
+        std::fclose(f);
+    }
+    {
+        const size_t base_mappings = count_mappings();
+        const auto start = bench::clock::now();
+        std::unordered_map<std::string, mio::mmap_source> mmaps(files);
+        std::error_code error;
+        for(size_t i = 0; i < files && !error; ++i)
+        {
+            mmaps[entry_name(i)].map(file_path(i), error);
+        }
+        if(error) { std::fprintf(stderr, "mmap: %s\n", error.message().c_str()); return 1; }
+        const double seconds = bench::seconds_since(start);
+        const size_t mappings = count_mappings() - base_mappings;
+        const double ns = lookup(files, [&](const std::string& name) { return mmaps.find(name)->second.data(); });
+        report("mmap_source each", files, seconds, mappings, ns);
+    }
+    for(size_t i = 0; i < files; ++i) { std::remove(file_path(i).c_str()); }
+    ::rmdir(directory);
+}
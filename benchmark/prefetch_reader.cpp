@@ -0,0 +1,71 @@
+// Cold-cache sequential scan of a mapping by a consumer doing some work per byte,
+// with `mmap_chunk_reader`, which relies on the kernel's readahead alone, and with
+// `mmap_prefetch_reader`, with and without its helper thread. Reports throughput,
+// the reader's hit rate and the time it spent stalled on page faults.
+//
+// usage: mio.prefetch_reader.benchmark [size in MiB] [initial distance in MiB]
+
+#include "benchmark.hpp"
+
+#include <mio/mmap.hpp>
+#include <mio/chunk_reader.hpp>
+#include <mio/prefetch_reader.hpp>
+
+#include <cstdio>
+
+namespace {
+
+const char* path = "bench-prefetch-file";
+
+/** Stands in for a parser, going over every byte. */
+uint64_t consume(const char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for(size_t i = 0; i < size; ++i) { hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull; }
+    return hash;
+}
+
+template<typename Reader>
+double scan(Reader& reader)
+{
+    uint64_t sum = 0;
+    const auto start = bench::clock::now();
+    for(const auto& chunk : reader) { sum += consume(chunk.data(), chunk.size()); }
+    bench::keep(sum);
+    return bench::seconds_since(start);
+}
+
+void scan_prefetched(const char* name, size_t size, size_t distance, bool use_helper_thread)
+{
+    bench::drop_cache(path);
+    mio::mmap_source mmap(path);
+    mio::prefetch_options options;
+    options.distance = distance;
+    options.use_helper_thread = use_helper_thread;
+    mio::mmap_prefetch_reader reader(mmap, options);
+    bench::report_throughput(name, size, scan(reader));
+    const auto stats = reader.stats();
+    std::printf("%-32s hit rate %.1f%% (%llu misses), stalled %.1f ms, final distance %.1f MiB\n", "",
+        100 * stats.hit_rate(), static_cast<unsigned long long>(stats.misses),
+        std::chrono::duration<double, std::milli>(stats.stall_time).count(),
+        stats.distance / (1024.0 * 1024.0));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t size = bench::arg(argc, argv, 1, 1024) << 20;
+    const size_t distance = bench::arg(argc, argv, 2, 4) << 20;
+
+    bench::create_file(path, size);
+    {
+        bench::drop_cache(path);
+        mio::mmap_source mmap(path);
+        mio::mmap_chunk_reader reader(mmap, 256 << 10);
+        bench::report_throughput("mmap_chunk_reader", size, scan(reader));
+    }
+    scan_prefetched("mmap_prefetch_reader", size, distance, false);
+    scan_prefetched("mmap_prefetch_reader, helper", size, distance, true);
+    std::remove(path);
+}
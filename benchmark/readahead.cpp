@@ -0,0 +1,84 @@
+// Cold-cache sequential scan of a mapping, with and without the readahead engine.
+//
+// usage: mio.readahead.benchmark [size in MiB] [window in MiB] [queue depth]
+
+#include "benchmark.hpp"
+
+#include <mio/mmap.hpp>
+#include <mio/readahead.hpp>
+
+#include <cstdio>
+#include <system_error>
+
+namespace {
+
+const char* path = "bench-readahead-file";
+
+void scan_plain(size_t size)
+{
+    bench::drop_cache(path);
+    mio::mmap_source mmap(path);
+    const auto start = bench::clock::now();
+    const uint64_t sum = bench::touch_pages(mmap.data(), mmap.size());
+    const double seconds = bench::seconds_since(start);
+    bench::report_throughput("page faults only", size, seconds);
+    bench::keep(sum);
+}
+
+void scan_with_engine(size_t size, size_t window, unsigned queue_depth,
+        mio::readahead_engine::backend preferred, const char* name)
+{
+    bench::drop_cache(path);
+    mio::mmap_source mmap(path);
+    mio::readahead_engine engine(queue_depth, 128 * 1024, preferred);
+    if(engine.active_backend() != preferred)
+    {
+        std::printf("%-32s unavailable\n", name);
+        return;
+    }
+
+    const size_t step = 1 << 20;
+    std::error_code error;
+    const auto start = bench::clock::now();
+    size_t prefetched = 0;
+    uint64_t sum = 0;
+    for(size_t pos = 0; pos < mmap.size(); pos += step)
+    {
+        const size_t target = std::min(pos + window, mmap.size());
+        if(prefetched < target)
+        {
+            engine.prefetch(mmap, prefetched, target - prefetched, error);
+            prefetched = target;
+        }
+        else
+        {
+            engine.poll(error);
+        }
+        sum += bench::touch_pages(mmap.data() + pos, std::min(step, mmap.size() - pos));
+    }
+    const double seconds = bench::seconds_since(start);
+    engine.wait(error);
+    bench::report_throughput(name, size, seconds);
+    std::printf("%-32s avg queue depth %.1f, max %llu, %llu reads\n", "",
+        engine.stats().average_queue_depth(),
+        static_cast<unsigned long long>(engine.stats().max_queue_depth),
+        static_cast<unsigned long long>(engine.stats().completed));
+    bench::keep(sum);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t size = bench::arg(argc, argv, 1, 512) << 20;
+    const size_t window = bench::arg(argc, argv, 2, 32) << 20;
+    const unsigned queue_depth = static_cast<unsigned>(bench::arg(argc, argv, 3, 32));
+
+    bench::create_file(path, size);
+    scan_plain(size);
+    scan_with_engine(size, window, queue_depth,
+        mio::readahead_engine::backend::syscall, "readahead(2)");
+    scan_with_engine(size, window, queue_depth,
+        mio::readahead_engine::backend::io_uring, "io_uring");
+    std::remove(path);
+}
@@ -0,0 +1,79 @@
+// Latency of releasing a large, fully faulted-in mapping on the request thread, by
+// destroying it, against handing it over to a `mmap_reaper`. Each of the request
+// threads repeatedly maps the file, touches every page and releases the mapping,
+// timing the release alone. Reports percentiles of the release latency and the
+// time the reaper then needs to catch up.
+//
+// usage: mio.reaper.benchmark [size in MiB] [iterations] [threads]
+
+#include "benchmark.hpp"
+
+#include <mio/mmap.hpp>
+#include <mio/page.hpp>
+#include <mio/reaper.hpp>
+
+#include <cstdio>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* path = "bench-reaper-file";
+
+template<typename Release>
+void run(const char* name, size_t iterations, size_t threads, Release release)
+{
+    std::mutex mutex;
+    std::vector<double> samples;
+    std::vector<std::thread> workers;
+    for(size_t t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&]
+        {
+            std::vector<double> local;
+            for(size_t i = 0; i < iterations; ++i)
+            {
+                mio::mmap_source mmap(path);
+                mio::prefault(mmap.data(), mmap.size());
+                const auto start = bench::clock::now();
+                release(mmap);
+                local.push_back(bench::seconds_since(start) * 1e6);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            samples.insert(samples.end(), local.begin(), local.end());
+        });
+    }
+    for(auto& worker : workers) { worker.join(); }
+    std::printf("%-20s release p50 %8.1f us  p99 %8.1f us  max %8.1f us\n", name,
+        bench::percentile(samples, 50), bench::percentile(samples, 99),
+        bench::percentile(samples, 100));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t size = bench::arg(argc, argv, 1, 512) << 20;
+    const size_t iterations = bench::arg(argc, argv, 2, 50);
+    const size_t threads = std::max<size_t>(bench::arg(argc, argv, 3, 2), 1);
+    bench::create_file(path, size);
+
+    run("destructor", iterations, threads, [](mio::mmap_source& mmap) { mmap.unmap(); });
+
+    mio::mmap_reaper reaper;
+    run("mmap_reaper", iterations, threads, [&](mio::mmap_source& mmap)
+    {
+        reaper.release(std::move(mmap));
+    });
+    const auto start = bench::clock::now();
+    reaper.drain();
+    const auto stats = reaper.stats();
+    std::printf("%-20s drain %.1f ms, %llu released in %llu batches, %llu inline\n", "",
+        bench::seconds_since(start) * 1e3,
+        static_cast<unsigned long long>(stats.released),
+        static_cast<unsigned long long>(stats.batches),
+        static_cast<unsigned long long>(stats.released_inline));
+    std::remove(path);
+}
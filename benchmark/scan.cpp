@@ -0,0 +1,76 @@
+// Sequential scan of a mapping with `mmap_chunk_reader`, which leaves every page it
+// read resident, and with `mmap_scan_reader`, which drops the pages behind it.
+// Reports throughput, the peak growth of the resident set during the scan and how
+// much of the file is left in the page cache afterwards.
+//
+// usage: mio.scan.benchmark [size in MiB] [lag in MiB]
+
+#include "benchmark.hpp"
+
+#include <mio/mmap.hpp>
+#include <mio/chunk_reader.hpp>
+#include <mio/scan_reader.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <system_error>
+
+namespace {
+
+const char* path = "bench-scan-file";
+
+template<typename Reader>
+void scan(const char* name, size_t size, Reader& reader)
+{
+    const long base_rss = bench::rss_kib();
+    long peak_rss = base_rss;
+    uint64_t sum = 0;
+    size_t chunks = 0;
+    const auto start = bench::clock::now();
+    for(const auto& chunk : reader)
+    {
+        sum += bench::touch_pages(chunk.data(), chunk.size());
+        if(++chunks % 16 == 0) { peak_rss = std::max(peak_rss, bench::rss_kib()); }
+    }
+    const double seconds = bench::seconds_since(start);
+    peak_rss = std::max(peak_rss, bench::rss_kib());
+    bench::report_throughput(name, size, seconds);
+    std::printf("%-32s peak RSS +%.1f MiB, %.1f MiB left in page cache\n", "",
+        (peak_rss - base_rss) / 1024.0,
+        bench::cached_pages(path) * (mio::page_size() / 1024.0) / 1024.0);
+    bench::keep(sum);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t size = bench::arg(argc, argv, 1, 1024) << 20;
+    const size_t lag = bench::arg(argc, argv, 2, 8) << 20;
+
+    bench::create_file(path, size);
+    {
+        bench::drop_cache(path);
+        mio::mmap_source mmap(path);
+        mio::mmap_chunk_reader reader(mmap, 1 << 20);
+        scan("mmap_chunk_reader", size, reader);
+    }
+    {
+        bench::drop_cache(path);
+        mio::mmap_source mmap(path);
+        mio::scan_options options;
+        options.lag = lag;
+        options.drop_page_cache = false;
+        mio::mmap_scan_reader reader(mmap, options);
+        scan("mmap_scan_reader, keep cache", size, reader);
+    }
+    {
+        bench::drop_cache(path);
+        mio::mmap_source mmap(path);
+        mio::scan_options options;
+        options.lag = lag;
+        mio::mmap_scan_reader reader(mmap, options);
+        scan("mmap_scan_reader, drop cache", size, reader);
+    }
+    std::remove(path);
+}
@@ -0,0 +1,87 @@
+// Throughput of sending slices of a mapped file to a local pipe and socket pair
+// with each of `send_range`'s methods. A second thread drains the other end.
+//
+// usage: mio.send_range.benchmark [size in MiB] [slice size in KiB]
+
+#include "benchmark.hpp"
+
+#include <mio/mmap.hpp>
+#include <mio/send_range.hpp>
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+
+namespace {
+
+const char* path = "bench-send-range-file";
+
+struct target
+{
+    const char* name;
+    bool socket;
+};
+
+void run(const mio::mmap_source& mmap, size_t slice, const target& t,
+        mio::send_method method, const char* method_name)
+{
+    int fds[2];
+    if((t.socket ? ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) : ::pipe(fds)) != 0)
+    {
+        std::perror("pipe");
+        return;
+    }
+
+    size_t received = 0;
+    std::thread reader([&]
+    {
+        std::vector<char> buf(1 << 20);
+        ssize_t n;
+        while((n = ::read(fds[0], buf.data(), buf.size())) > 0) { received += n; }
+    });
+
+    std::error_code error;
+    const auto start = bench::clock::now();
+    for(size_t offset = 0; offset < mmap.size() && !error; offset += slice)
+    {
+        mio::send_range(mmap, offset, slice, fds[1], error, method);
+    }
+    ::close(fds[1]);
+    reader.join();
+    const double seconds = bench::seconds_since(start);
+    ::close(fds[0]);
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s, %s", t.name, method_name);
+    if(error || received != mmap.size())
+    {
+        std::printf("%-32s failed: %s\n", name, error.message().c_str());
+        return;
+    }
+    bench::report_throughput(name, mmap.size(), seconds);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t size = bench::arg(argc, argv, 1, 1024) << 20;
+    const size_t slice = bench::arg(argc, argv, 2, 1024) << 10;
+    bench::create_file(path, size);
+
+    mio::mmap_source mmap(path);
+    // Start out with a warm cache, as the point is the cost of moving the data.
+    bench::keep(bench::touch_pages(mmap.data(), mmap.size()));
+
+    const target pipe_target = { "pipe", false };
+    const target socket_target = { "socketpair", true };
+    run(mmap, slice, pipe_target, mio::send_method::write, "write");
+    run(mmap, slice, pipe_target, mio::send_method::splice, "splice");
+    run(mmap, slice, pipe_target, mio::send_method::vmsplice, "vmsplice");
+    run(mmap, slice, socket_target, mio::send_method::write, "write");
+    run(mmap, slice, socket_target, mio::send_method::sendfile, "sendfile");
+
+    std::remove(path);
+}
@@ -0,0 +1,120 @@
+// Scan of a sparse file of which 1% holds data, with `mmap_chunk_reader`, which
+// faults in a zero page for every page of the holes, and with `mmap_sparse_reader`,
+// which only reads the data extents, on one and on several threads. Reports the
+// time of each scan and how many bytes it touched.
+//
+// usage: mio.sparse.benchmark [size in MiB] [density in 1/1000] [threads]
+
+#include "benchmark.hpp"
+
+#include <mio/chunk_reader.hpp>
+#include <mio/mmap.hpp>
+#include <mio/sparse_reader.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* path = "bench-sparse-file";
+
+/** Writes 64 KiB of data every `stride` bytes of a `size` byte sparse file. */
+void create_sparse_file(size_t size, size_t stride)
+{
+    const int fd = ::open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if(fd == -1) { std::perror("open"); std::exit(1); }
+    const std::string block(64 << 10, 'x');
+    for(size_t offset = 0; offset + block.size() <= size; offset += stride)
+    {
+        if(::pwrite(fd, block.data(), block.size(), static_cast<off_t>(offset)) == -1)
+        {
+            std::perror("pwrite");
+            std::exit(1);
+        }
+    }
+    if(::ftruncate(fd, static_cast<off_t>(size)) == -1) { std::perror("ftruncate"); std::exit(1); }
+    ::fsync(fd);
+    ::close(fd);
+}
+
+template<typename Reader>
+uint64_t scan(Reader& reader, size_t& bytes)
+{
+    uint64_t sum = 0;
+    for(const auto& chunk : reader)
+    {
+        sum += bench::touch_pages(chunk.data(), chunk.size());
+        bytes += chunk.size();
+    }
+    return sum;
+}
+
+void report(const char* name, size_t bytes, double seconds)
+{
+    std::printf("%-32s %10.1f ms, %8.1f MiB touched\n", name, seconds * 1e3,
+        bytes / (1024.0 * 1024.0));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t size = bench::arg(argc, argv, 1, 4096) << 20;
+    const size_t density = std::max<size_t>(bench::arg(argc, argv, 2, 10), 1);
+    const size_t threads = std::max<size_t>(bench::arg(argc, argv, 3, 4), 1);
+    create_sparse_file(size, (64 << 10) * 1000 / density);
+
+    mio::mmap_source mmap(path);
+    std::error_code error;
+    const auto extents = mmap.data_extents(error);
+    if(error) { std::fprintf(stderr, "data_extents: %s\n", error.message().c_str()); }
+    size_t data_size = 0;
+    for(const auto& extent : extents) { data_size += extent.length; }
+    std::printf("%zu MiB file, %zu extents holding %.1f MiB\n", size >> 20,
+        extents.size(), data_size / (1024.0 * 1024.0));
+    if(extents.size() <= 1) { std::printf("the file system doesn't report holes\n"); }
+
+    {
+        // A fresh mapping, so that no page is mapped yet.
+        mio::mmap_source scanned(path);
+        mio::mmap_chunk_reader reader(scanned, 1 << 20);
+        size_t bytes = 0;
+        const auto start = bench::clock::now();
+        bench::keep(scan(reader, bytes));
+        report("mmap_chunk_reader", bytes, bench::seconds_since(start));
+    }
+    {
+        mio::mmap_source scanned(path);
+        const auto start = bench::clock::now();
+        mio::mmap_sparse_reader reader(scanned, 1 << 20);
+        size_t bytes = 0;
+        bench::keep(scan(reader, bytes));
+        report("mmap_sparse_reader", bytes, bench::seconds_since(start));
+    }
+    {
+        mio::mmap_source scanned(path);
+        const auto start = bench::clock::now();
+        const auto parts = mio::split_extents(scanned.data_extents(error), threads);
+        std::atomic<size_t> total(0);
+        std::vector<std::thread> workers;
+        for(const auto& part : parts)
+        {
+            workers.emplace_back([&, part]
+            {
+                mio::mmap_sparse_reader reader(scanned, part, 1 << 20);
+                size_t bytes = 0;
+                bench::keep(scan(reader, bytes));
+                total += bytes;
+            });
+        }
+        for(auto& worker : workers) { worker.join(); }
+        char name[48];
+        std::snprintf(name, sizeof(name), "mmap_sparse_reader, %zu threads", parts.size());
+        report(name, total, bench::seconds_since(start));
+    }
+    std::remove(path);
+}
@@ -0,0 +1,112 @@
+// Dirty memory and write stalls when filling a large mapping, with and without a
+// background `writeback`. Each step writes one chunk; reported are the slowest
+// steps, the time of the final `sync` and the peak of the system's dirty memory.
+//
+// usage: mio.writeback.benchmark [size in MiB] [chunk size in KiB] [dirty limit in MiB]
+
+#include "benchmark.hpp"
+
+#include <mio/mmap.hpp>
+#include <mio/writeback.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+
+const char* path = "bench-writeback-file";
+
+/** Returns the system's dirty and under writeback memory in KiB from /proc/meminfo. */
+long dirty_kib()
+{
+    long total = 0;
+    if(std::FILE* f = std::fopen("/proc/meminfo", "r"))
+    {
+        char line[128];
+        while(std::fgets(line, sizeof(line), f))
+        {
+            long value;
+            if(std::sscanf(line, "Dirty: %ld", &value) == 1
+               || std::sscanf(line, "Writeback: %ld", &value) == 1)
+            {
+                total += value;
+            }
+        }
+        std::fclose(f);
+    }
+    return total;
+}
+
+void run(const char* name, size_t size, size_t chunk, const mio::writeback_options* options)
+{
+    std::remove(path);
+    const int fd = ::open(path, O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if(fd == -1 || ::ftruncate(fd, size) != 0) { std::perror("create"); std::exit(1); }
+    ::close(fd);
+
+    mio::mmap_sink mmap(path);
+    std::unique_ptr<mio::writeback> writeback;
+    if(options) { writeback.reset(new mio::writeback(mmap, *options)); }
+
+    std::vector<double> steps;
+    long peak_dirty = 0;
+    const auto start = bench::clock::now();
+    for(size_t offset = 0; offset < size; offset += chunk)
+    {
+        const auto step = bench::clock::now();
+        const size_t n = std::min(chunk, size - offset);
+        std::memset(mmap.data() + offset, static_cast<int>(offset >> 20), n);
+        if(writeback) { writeback->note_written(offset, n); }
+        steps.push_back(bench::seconds_since(step) * 1e3);
+        peak_dirty = std::max(peak_dirty, dirty_kib());
+    }
+    const double write_seconds = bench::seconds_since(start);
+    const auto sync_start = bench::clock::now();
+    std::error_code error;
+    mmap.sync(error);
+    const double sync_seconds = bench::seconds_since(sync_start);
+
+    const double p99 = bench::percentile(steps, 99);
+    const double max = steps.empty() ? 0 : steps.back();
+    std::printf("%-22s write %6.2f s  sync %6.3f s  step p99 %7.2f ms  max %7.2f ms  peak dirty %6ld MiB\n",
+        name, write_seconds, sync_seconds, p99, max, peak_dirty / 1024);
+    if(writeback)
+    {
+        const auto stats = writeback->stats();
+        std::printf("%22s %llu flushes, %llu MiB, waited %.3f s, writers stalled %.3f s\n", "",
+            (unsigned long long)stats.flushes(), (unsigned long long)(stats.bytes_flushed >> 20),
+            std::chrono::duration<double>(stats.flush_wait_time).count(),
+            std::chrono::duration<double>(stats.writer_stall_time).count());
+    }
+    writeback.reset();
+    mmap.unmap();
+    std::remove(path);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t size = bench::arg(argc, argv, 1, 2048) << 20;
+    const size_t chunk = std::max<size_t>(bench::arg(argc, argv, 2, 1024) << 10, mio::page_size());
+    const size_t limit = bench::arg(argc, argv, 3, 32) << 20;
+
+    run("no writeback", size, chunk, nullptr);
+
+    mio::writeback_options threshold;
+    threshold.interval = std::chrono::milliseconds(0);
+    threshold.dirty_bytes_limit = limit;
+    run("dirty bytes threshold", size, chunk, &threshold);
+
+    mio::writeback_options timed;
+    timed.interval = std::chrono::milliseconds(100);
+    timed.dirty_bytes_limit = 0;
+    run("every 100 ms", size, chunk, &timed);
+
+    mio::writeback_options msync;
+    msync.dirty_bytes_limit = limit;
+    msync.method = mio::writeback_method::async_msync;
+    run("async msync threshold", size, chunk, &msync);
+}
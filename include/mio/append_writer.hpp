@@ -0,0 +1,281 @@
+#ifndef MIO_APPEND_WRITER_HEADER
+#define MIO_APPEND_WRITER_HEADER
+
+#include "mio/mmap.hpp"
+#include "mio/span.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <system_error>
+#include <vector>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/uio.h>
+#endif
+
+namespace mio {
+
+struct append_writer_options
+{
+    // Appends are gathered until this many bytes are pending, which are then
+    // written with a single `pwritev`. Appends at least this large aren't copied.
+    size_t batch_size = 1 << 20;
+
+    // Whether to discard the file's contents rather than appending to them.
+    bool truncate = false;
+};
+
+/**
+ * Appends to a file with batched `pwrite`s while giving zero-copy read access to
+ * what has been written.
+ *
+ * For sequential appends, writing through a growing `mmap_sink` costs a page fault
+ * on each new page and a remap each time the file is extended, both of which plain
+ * writes avoid. Written data may still be read back in place: `view` returns the
+ * committed prefix of the file through a read-only mapping, which is only extended
+ * when it's requested after the file has grown. Address space is reserved ahead of
+ * the file's end, so that extending the view only maps the new tail.
+ *
+ * Bytes given to `append` are committed, i.e. written to the file, once `batch_size`
+ * of them are pending or on `flush`, `sync` and `close`. The view relies on a unified
+ * page cache to see them immediately, as Linux and the BSDs have.
+ *
+ * This is only supported on POSIX systems.
+ */
+class append_writer
+{
+public:
+    using value_type = char;
+    using size_type = size_t;
+    using span_type = span<const char>;
+    using handle_type = file_handle_type;
+
+    append_writer() = default;
+    append_writer(const append_writer&) = delete;
+    append_writer& operator=(const append_writer&) = delete;
+
+#ifdef __cpp_exceptions
+    /**
+     * The same as invoking the `open` function, except any error that may occur
+     * while opening the file is wrapped in a `std::system_error` and is thrown.
+     */
+    template<typename String>
+    explicit append_writer(const String& path,
+            append_writer_options options = append_writer_options())
+    {
+        std::error_code error;
+        open(path, options, error);
+        if(error) { throw std::system_error(error); }
+    }
+#endif // __cpp_exceptions
+
+    /** Writes any pending bytes and closes the file, ignoring errors. */
+    ~append_writer()
+    {
+        std::error_code error;
+        close(error);
+    }
+
+    /**
+     * Opens or creates the file at `path`, appending after its current contents
+     * unless `options.truncate` is set. Upon failure, `error` is set to indicate the
+     * reason and the writer remains closed.
+     */
+    template<typename String>
+    void open(const String& path, const append_writer_options& options, std::error_code& error)
+    {
+        close(error);
+        error.clear();
+        if(detail::empty(path))
+        {
+            error = std::make_error_code(std::errc::invalid_argument);
+            return;
+        }
+#ifdef _WIN32
+        (void)options;
+        error = std::make_error_code(std::errc::not_supported);
+#else
+        const int fd = ::open(detail::c_str(path),
+            O_RDWR | O_CREAT | O_CLOEXEC | (options.truncate ? O_TRUNC : 0), 0644);
+        if(fd == -1) { error = detail::last_error(); return; }
+        const auto file_size = detail::query_file_size(fd, error);
+        if(error) { ::close(fd); return; }
+
+        file_handle_ = fd;
+        committed_ = static_cast<size_type>(file_size);
+        batch_size_ = std::max<size_type>(options.batch_size, 1);
+        pending_.reserve(batch_size_);
+#endif
+    }
+
+    /** Writes any pending bytes, then releases the view and closes the file. */
+    void close(std::error_code& error)
+    {
+        error.clear();
+        if(!is_open()) { return; }
+        flush(error);
+        view_.unmap();
+#ifndef _WIN32
+        ::close(file_handle_);
+#endif
+        file_handle_ = invalid_handle;
+        committed_ = 0;
+        pending_.clear();
+    }
+
+    bool is_open() const noexcept { return file_handle_ != invalid_handle; }
+    handle_type file_handle() const noexcept { return file_handle_; }
+
+    /** Returns the number of bytes in the file, including those still pending. */
+    size_type size() const noexcept { return committed_ + pending_.size(); }
+
+    /** Returns the number of bytes actually written to the file. */
+    size_type committed_size() const noexcept { return committed_; }
+
+    /** Returns the number of bytes appended but not yet written to the file. */
+    size_type pending_size() const noexcept { return pending_.size(); }
+
+    /**
+     * Appends `length` bytes at `data` to the file. Upon failure, `error` is set and
+     * whatever couldn't be written of the pending and the given bytes is dropped.
+     */
+    void append(const char* data, size_type length, std::error_code& error)
+    {
+        error.clear();
+        if(!is_open())
+        {
+            error = std::make_error_code(std::errc::bad_file_descriptor);
+            return;
+        }
+        if(pending_.size() + length < batch_size_)
+        {
+            pending_.insert(pending_.end(), data, data + length);
+            return;
+        }
+        // Write the pending bytes and the new ones together, without copying the latter.
+        write(data, length, error);
+    }
+
+    void append(span_type data, std::error_code& error)
+    {
+        append(data.data(), data.size(), error);
+    }
+
+    /** Writes all pending bytes to the file. */
+    void flush(std::error_code& error)
+    {
+        error.clear();
+        if(!is_open())
+        {
+            error = std::make_error_code(std::errc::bad_file_descriptor);
+            return;
+        }
+        if(!pending_.empty()) { write(nullptr, 0, error); }
+    }
+
+    /** Writes all pending bytes and waits for the file's data to reach the disk. */
+    void sync(std::error_code& error)
+    {
+        flush(error);
+        if(error) { return; }
+#ifndef _WIN32
+        if(::fdatasync(file_handle_) != 0) { error = detail::last_error(); }
+#endif
+    }
+
+    /**
+     * Returns the committed bytes of the file. The returned span is invalidated by
+     * `close`, and by the next call to `view` or `read` that has to extend the mapping
+     * beyond the address space reserved for it, which doubles each time.
+     */
+    span_type view(std::error_code& error)
+    {
+        error.clear();
+        if(view_.size() < committed_)
+        {
+            extend_view(error);
+            if(error) { return span_type(); }
+        }
+        return span_type(view_.data(), committed_);
+    }
+
+    /**
+     * Returns up to `length` committed bytes starting at `offset`, with the same
+     * lifetime as the spans returned by `view`.
+     */
+    span_type read(size_type offset, size_type length, std::error_code& error)
+    {
+        return view(error).subspan(offset, length);
+    }
+
+private:
+    /** Maps the committed bytes not yet in the view, growing it in place. */
+    void extend_view(std::error_code& error)
+    {
+        if(!view_.is_mapped())
+        {
+            view_.map(file_handle_, 0, committed_, error);
+            return;
+        }
+        if(view_.capacity() < committed_)
+        {
+            view_.reserve(2 * committed_, error);
+            if(error) { return; }
+        }
+        view_.extend_to_file(error);
+    }
+
+    void write(const char* data, size_type length, std::error_code& error)
+    {
+#ifdef _WIN32
+        (void)data;
+        (void)length;
+        error = std::make_error_code(std::errc::not_supported);
+#else
+        iovec iov[2];
+        int count = 0;
+        if(!pending_.empty()) { iov[count++] = { pending_.data(), pending_.size() }; }
+        if(length > 0) { iov[count++] = { const_cast<char*>(data), length }; }
+
+        iovec* next = iov;
+        while(count > 0)
+        {
+            const ssize_t ret = ::pwritev(file_handle_, next, count,
+                static_cast<off_t>(committed_));
+            if(ret < 0)
+            {
+                if(errno == EINTR) { continue; }
+                error = detail::last_error();
+                break;
+            }
+            committed_ += static_cast<size_type>(ret);
+            // Skip the fully written buffers and trim the partially written one.
+            size_type n = static_cast<size_type>(ret);
+            while(count > 0 && n >= next->iov_len)
+            {
+                n -= next->iov_len;
+                ++next;
+                --count;
+            }
+            if(count > 0)
+            {
+                next->iov_base = static_cast<char*>(next->iov_base) + n;
+                next->iov_len -= n;
+            }
+        }
+        pending_.clear();
+#endif
+    }
+
+    mmap_source view_;
+    std::vector<char> pending_;
+    handle_type file_handle_ = invalid_handle;
+    size_type committed_ = 0;
+    size_type batch_size_ = 1;
+};
+
+} // namespace mio
+
+#endif // MIO_APPEND_WRITER_HEADER
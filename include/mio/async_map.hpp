@@ -0,0 +1,97 @@
+#ifndef MIO_ASYNC_MAP_HEADER
+#define MIO_ASYNC_MAP_HEADER
+
+#include "mio/mmap.hpp"
+#include "mio/page.hpp"
+#include "mio/thread_pool.hpp"
+#include "mio/detail/string_util.hpp"
+
+#include <future>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace mio {
+
+struct async_map_options
+{
+    // The range of the file to map; see `basic_mmap::map`.
+    size_t offset = 0;
+    size_t length = map_entire_file;
+
+    // How the file is opened. Its `readahead` asks the kernel to start reading the
+    // start of the range before the mapping is handed over.
+    open_options open;
+
+    // Whether to fault in every page of the mapping before it is handed over, so that
+    // accessing it doesn't block either. This reads the whole range from disk.
+    bool prefault = false;
+};
+
+/** The outcome of `async_map`: the mapping, left unmapped if `error` is set. */
+template<typename MMap>
+struct async_map_result
+{
+    MMap mmap;
+    std::error_code error;
+};
+
+/**
+ * Maps the file at `path` on `pool`, so that the calling thread, e.g. an event loop,
+ * doesn't block on opening, querying and mapping it, which can take long on a slow
+ * or network file system. Once done, `callback` is invoked on the worker with the
+ * mapping as an rvalue and the error, if any.
+ *
+ * `MMap` is any mapping type with a `map(path, offset, length, options, error)`
+ * member, e.g. `mmap_source` or `shared_mmap_sink`. The path is copied.
+ */
+template<
+    typename MMap = mmap_source,
+    typename String,
+    typename Callback,
+    typename = typename std::enable_if<
+        !std::is_same<typename std::decay<Callback>::type, thread_pool>::value>::type
+> void async_map(const String& path, const async_map_options& options, Callback callback,
+        thread_pool& pool = default_thread_pool())
+{
+    using char_type = typename detail::char_type<String>::type;
+    std::basic_string<char_type> owned_path(detail::c_str(path));
+    // The pool's tasks must be copyable, hence the shared state.
+    auto state = std::make_shared<std::pair<std::basic_string<char_type>, Callback>>(
+        std::move(owned_path), std::move(callback));
+    pool.post([state, options]
+    {
+        MMap mmap;
+        std::error_code error;
+        mmap.map(state->first, options.offset, options.length, options.open, error);
+        if(!error && options.prefault) { prefault(mmap.data(), mmap.size()); }
+        state->second(std::move(mmap), error);
+    });
+}
+
+/**
+ * The same as the callback version of `async_map`, except the mapping and the error
+ * are delivered through the returned future.
+ */
+template<typename MMap = mmap_source, typename String>
+std::future<async_map_result<MMap>> async_map(const String& path,
+        const async_map_options& options = async_map_options(),
+        thread_pool& pool = default_thread_pool())
+{
+    auto promise = std::make_shared<std::promise<async_map_result<MMap>>>();
+    auto future = promise->get_future();
+    async_map<MMap>(path, options, [promise](MMap&& mmap, std::error_code error)
+    {
+        async_map_result<MMap> result;
+        result.mmap = std::move(mmap);
+        result.error = error;
+        promise->set_value(std::move(result));
+    }, pool);
+    return future;
+}
+
+} // namespace mio
+
+#endif // MIO_ASYNC_MAP_HEADER
@@ -0,0 +1,164 @@
+#ifndef MIO_ASYNC_READER_HEADER
+#define MIO_ASYNC_READER_HEADER
+
+#include "mio/page.hpp"
+#include "mio/span.hpp"
+#include "mio/thread_pool.hpp"
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <algorithm>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace mio {
+
+/**
+ * Collects coroutines that are ready to continue after their pages were faulted in
+ * on a background thread, so that they can be resumed on the thread that owns them,
+ * e.g. from the event loop of a single-threaded reactor.
+ */
+class resume_queue
+{
+public:
+    /** Queues `handle` for resumption. May be called from any thread. */
+    void push(std::coroutine_handle<> handle)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            handles_.push_back(handle);
+        }
+        cv_.notify_one();
+    }
+
+    /** Resumes all queued coroutines on the calling thread and returns their number. */
+    size_t run()
+    {
+        std::deque<std::coroutine_handle<>> handles;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            handles.swap(handles_);
+        }
+        for(auto handle : handles) { handle.resume(); }
+        return handles.size();
+    }
+
+    /** Blocks until at least one coroutine is queued. */
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !handles_.empty(); });
+    }
+
+    bool empty() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return handles_.empty();
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::coroutine_handle<>> handles_;
+};
+
+/**
+ * Reads sequentially from a memory mapping without blocking the calling thread on
+ * major page faults.
+ *
+ * `co_await reader.read(n)` yields a span of up to `n` bytes at the current position
+ * (an empty span at the end of the mapping). If all of its pages are resident, the
+ * coroutine continues immediately. Otherwise it is suspended while the pages are
+ * faulted in on `pool`, and is resumed through `resume` if provided (e.g. by pushing
+ * it onto a `resume_queue` drained by the owning thread), or on the pool otherwise.
+ *
+ * The reader does not own the mapping, which must outlive it.
+ */
+template<typename ByteT>
+class basic_async_reader
+{
+public:
+    using value_type = ByteT;
+    using size_type = size_t;
+    using span_type = span<const ByteT>;
+    using resume_function = std::function<void(std::coroutine_handle<>)>;
+
+    class read_awaitable
+    {
+    public:
+        bool await_ready() const noexcept
+        {
+            return is_resident(chunk_.data(), chunk_.size());
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            reader_.fault_in(chunk_, handle);
+        }
+
+        span_type await_resume() noexcept
+        {
+            reader_.position_ += chunk_.size();
+            return chunk_;
+        }
+
+    private:
+        friend class basic_async_reader;
+
+        read_awaitable(basic_async_reader& reader, span_type chunk)
+            : reader_(reader), chunk_(chunk)
+        {}
+
+        basic_async_reader& reader_;
+        span_type chunk_;
+    };
+
+    template<typename MMap>
+    explicit basic_async_reader(const MMap& mmap, resume_function resume = nullptr,
+            thread_pool& pool = default_thread_pool())
+        : data_(mmap.data())
+        , size_(mmap.size())
+        , resume_(std::move(resume))
+        , pool_(pool)
+    {}
+
+    /** Returns an awaitable yielding the next (at most) `n` bytes. */
+    read_awaitable read(size_type n) noexcept
+    {
+        return read_awaitable(*this, span_type(data_, size_).subspan(position_, n));
+    }
+
+    size_type position() const noexcept { return position_; }
+    void seek(size_type position) noexcept { position_ = std::min(position, size_); }
+    size_type size() const noexcept { return size_; }
+    bool eof() const noexcept { return position_ >= size_; }
+
+private:
+    void fault_in(span_type chunk, std::coroutine_handle<> handle)
+    {
+        pool_.post([this, chunk, handle]
+        {
+            prefault(chunk.data(), chunk.size());
+            if(resume_) { resume_(handle); }
+            else { handle.resume(); }
+        });
+    }
+
+    const ByteT* data_;
+    size_type size_;
+    size_type position_ = 0;
+    resume_function resume_;
+    thread_pool& pool_;
+};
+
+using async_reader = basic_async_reader<char>;
+using uasync_reader = basic_async_reader<unsigned char>;
+
+} // namespace mio
+
+#endif // __cpp_impl_coroutine
+
+#endif // MIO_ASYNC_READER_HEADER
@@ -0,0 +1,169 @@
+#ifndef MIO_BUFFER_POOL_HEADER
+#define MIO_BUFFER_POOL_HEADER
+
+#include "mio/page.hpp"
+#include "mio/span.hpp"
+
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+# include <malloc.h>
+#endif
+
+namespace mio {
+
+/**
+ * A thread-safe pool of fixed-size, aligned I/O buffers.
+ *
+ * Buffers are aligned to `alignment` (the page size by default), which satisfies the
+ * requirements of unbuffered I/O such as `O_DIRECT`. Released buffers are kept for
+ * reuse instead of being freed, so readers that are repeatedly opened and closed
+ * don't allocate every time. The pool must outlive all buffers acquired from it.
+ */
+class buffer_pool
+{
+public:
+    /** An acquired buffer, which is returned to its pool on destruction. */
+    class buffer
+    {
+    public:
+        buffer() = default;
+        buffer(const buffer&) = delete;
+        buffer& operator=(const buffer&) = delete;
+        buffer(buffer&& other) noexcept
+            : pool_(other.pool_), data_(other.data_)
+        {
+            other.pool_ = nullptr;
+            other.data_ = nullptr;
+        }
+
+        buffer& operator=(buffer&& other) noexcept
+        {
+            if(this != &other)
+            {
+                release();
+                pool_ = other.pool_;
+                data_ = other.data_;
+                other.pool_ = nullptr;
+                other.data_ = nullptr;
+            }
+            return *this;
+        }
+
+        ~buffer() { release(); }
+
+        char* data() const noexcept { return data_; }
+        size_t size() const noexcept { return pool_ ? pool_->buffer_size() : 0; }
+        span<char> as_span() const noexcept { return span<char>(data_, size()); }
+        explicit operator bool() const noexcept { return data_ != nullptr; }
+
+        /** Hands the buffer back to its pool ahead of destruction. */
+        void release() noexcept
+        {
+            if(pool_) { pool_->release(data_); }
+            pool_ = nullptr;
+            data_ = nullptr;
+        }
+
+    private:
+        friend class buffer_pool;
+        buffer(buffer_pool* pool, char* data) : pool_(pool), data_(data) {}
+
+        buffer_pool* pool_ = nullptr;
+        char* data_ = nullptr;
+    };
+
+    /**
+     * `buffer_size` is rounded up to a multiple of `alignment`, which must be a power
+     * of two.
+     */
+    explicit buffer_pool(size_t buffer_size, size_t alignment = page_size())
+        : buffer_size_((buffer_size + alignment - 1) / alignment * alignment)
+        , alignment_(alignment)
+    {}
+
+    buffer_pool(const buffer_pool&) = delete;
+    buffer_pool& operator=(const buffer_pool&) = delete;
+
+    ~buffer_pool()
+    {
+        for(char* p : free_) { deallocate(p); }
+    }
+
+    size_t buffer_size() const noexcept { return buffer_size_; }
+    size_t alignment() const noexcept { return alignment_; }
+
+    /** Returns a free buffer, allocating a new one if there is none. */
+    buffer acquire()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(!free_.empty())
+            {
+                char* p = free_.back();
+                free_.pop_back();
+                return buffer(this, p);
+            }
+        }
+        return buffer(this, allocate());
+    }
+
+    /** Returns the number of buffers waiting to be reused. */
+    size_t free_count() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return free_.size();
+    }
+
+    /** Frees all buffers waiting to be reused. */
+    void trim()
+    {
+        std::vector<char*> free;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free.swap(free_);
+        }
+        for(char* p : free) { deallocate(p); }
+    }
+
+private:
+    char* allocate()
+    {
+#ifdef _WIN32
+        void* p = ::_aligned_malloc(buffer_size_, alignment_);
+        if(!p) { throw std::bad_alloc(); }
+#else
+        void* p = nullptr;
+        if(::posix_memalign(&p, alignment_, buffer_size_) != 0) { throw std::bad_alloc(); }
+#endif
+        return static_cast<char*>(p);
+    }
+
+    static void deallocate(char* p) noexcept
+    {
+#ifdef _WIN32
+        ::_aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+
+    void release(char* p)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(p);
+    }
+
+    const size_t buffer_size_;
+    const size_t alignment_;
+    mutable std::mutex mutex_;
+    std::vector<char*> free_;
+};
+
+} // namespace mio
+
+#endif // MIO_BUFFER_POOL_HEADER
@@ -0,0 +1,119 @@
+#ifndef MIO_CHUNK_READER_HEADER
+#define MIO_CHUNK_READER_HEADER
+
+#include "mio/mmap.hpp"
+#include "mio/span.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <system_error>
+
+namespace mio {
+
+/**
+ * An input iterator over the chunks of a chunk reader, i.e. any type with a
+ * `bool next(span_type& chunk, std::error_code& error)` member that yields
+ * consecutive chunks until it returns false. Iteration stops at the end of the
+ * data or at the first error, which the reader then reports via `error()`.
+ */
+template<typename Reader>
+class chunk_iterator
+{
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = typename Reader::span_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    /** Constructs the end iterator. */
+    chunk_iterator() = default;
+
+    explicit chunk_iterator(Reader& reader) : reader_(&reader) { ++*this; }
+
+    reference operator*() const noexcept { return chunk_; }
+    pointer operator->() const noexcept { return &chunk_; }
+
+    chunk_iterator& operator++()
+    {
+        std::error_code error;
+        if(!reader_->next(chunk_, error)) { reader_ = nullptr; }
+        return *this;
+    }
+
+    void operator++(int) { ++*this; }
+
+    friend bool operator==(const chunk_iterator& a, const chunk_iterator& b) noexcept
+    {
+        return a.reader_ == b.reader_;
+    }
+
+    friend bool operator!=(const chunk_iterator& a, const chunk_iterator& b) noexcept
+    {
+        return !(a == b);
+    }
+
+private:
+    Reader* reader_ = nullptr;
+    value_type chunk_;
+};
+
+/**
+ * Yields the contents of a mapping as consecutive chunks of `chunk_size` bytes (the
+ * last one may be shorter). This has the same interface as other chunk readers,
+ * such as `direct_reader`, so that code consuming chunks can switch between
+ * mapping a file and reading it without changes.
+ *
+ * The reader does not own the mapping, which must outlive it.
+ */
+template<typename ByteT>
+class basic_mmap_chunk_reader
+{
+public:
+    using value_type = ByteT;
+    using size_type = size_t;
+    using span_type = span<const ByteT>;
+    using iterator = chunk_iterator<basic_mmap_chunk_reader>;
+
+    template<typename MMap>
+    basic_mmap_chunk_reader(const MMap& mmap, size_type chunk_size)
+        : data_(mmap.data())
+        , size_(mmap.size())
+        , chunk_size_(std::max<size_type>(chunk_size, 1))
+    {}
+
+    /**
+     * Sets `chunk` to the next chunk and returns true, or returns false at the end
+     * of the mapping. Mappings can't fail to be read, so `error` is always cleared.
+     */
+    bool next(span_type& chunk, std::error_code& error) noexcept
+    {
+        error.clear();
+        if(position_ >= size_) { return false; }
+        chunk = span_type(data_, size_).subspan(position_, chunk_size_);
+        position_ += chunk.size();
+        return true;
+    }
+
+    iterator begin() { return iterator(*this); }
+    iterator end() { return iterator(); }
+
+    size_type size() const noexcept { return size_; }
+    size_type position() const noexcept { return position_; }
+    size_type chunk_size() const noexcept { return chunk_size_; }
+    std::error_code error() const noexcept { return std::error_code(); }
+
+private:
+    const ByteT* data_;
+    size_type size_;
+    size_type chunk_size_;
+    size_type position_ = 0;
+};
+
+using mmap_chunk_reader = basic_mmap_chunk_reader<char>;
+using ummap_chunk_reader = basic_mmap_chunk_reader<unsigned char>;
+
+} // namespace mio
+
+#endif // MIO_CHUNK_READER_HEADER
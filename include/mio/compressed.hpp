@@ -0,0 +1,787 @@
+#ifndef MIO_COMPRESSED_HEADER
+#define MIO_COMPRESSED_HEADER
+
+#include "mio/mmap.hpp"
+#include "mio/span.hpp"
+#include "mio/detail/growing_sink.hpp"
+#include "mio/detail/hash.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mio {
+
+/**
+ * A dependency-free LZ77 codec, in the spirit of LZ4: matches are found through a
+ * hash table of 4-byte sequences and encoded as a token, literal and match lengths
+ * and a 2-byte offset. It favours speed over ratio.
+ *
+ * A codec for `compressed_writer` and `compressed_reader` has an `id`, stored in the
+ * container and checked when it's opened, and these members. `decompress` must be
+ * safe to call concurrently, and must not trust its input.
+ */
+class lz_codec
+{
+public:
+    static constexpr uint32_t id = 1;
+
+    /** Returns the size of the largest output `compress` may produce for `n` bytes. */
+    static size_t compress_bound(size_t n) noexcept { return n + n / 255 + 16; }
+
+    /**
+     * Compresses the `n` bytes at `src` into the `capacity` bytes at `dst`, and
+     * returns the compressed size, or 0 if it doesn't fit.
+     */
+    size_t compress(const char* src, size_t n, char* dst, size_t capacity)
+    {
+        const auto in = reinterpret_cast<const unsigned char*>(src);
+        auto out = reinterpret_cast<unsigned char*>(dst);
+        const auto out_end = out + capacity;
+        table_.assign(table_size, 0);
+
+        size_t anchor = 0;
+        size_t position = 0;
+        size_t misses = 0;
+        // The last bytes are always literals, so that a stream always ends with some,
+        // and sequences may be read 4 bytes at a time without running past the end.
+        const size_t match_end = n >= min_match ? n - min_match : 0;
+        while(position + min_match <= match_end)
+        {
+            const uint32_t sequence = read32(in + position);
+            const uint32_t slot = hash(sequence);
+            const size_t candidate = table_[slot];
+            table_[slot] = static_cast<uint32_t>(position + 1);
+            if(candidate == 0 || position + 1 - candidate > max_offset
+               || read32(in + candidate - 1) != sequence)
+            {
+                // Skip faster through incompressible data.
+                position += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+            const size_t match = candidate - 1;
+            const size_t length = min_match + match_length(in + match + min_match,
+                in + position + min_match, in + match_end);
+
+            out = emit(out, out_end, in + anchor, position - anchor, position - match, length);
+            if(!out) { return 0; }
+            position += length;
+            anchor = position;
+        }
+        out = emit(out, out_end, in + anchor, n - anchor, 0, 0);
+        return out ? static_cast<size_t>(out - reinterpret_cast<unsigned char*>(dst)) : 0;
+    }
+
+    /**
+     * Decompresses the `n` bytes at `src` into the `size` bytes at `dst`. Returns
+     * false if the input is malformed or doesn't decompress to exactly `size` bytes.
+     */
+    bool decompress(const char* src, size_t n, char* dst, size_t size) const noexcept
+    {
+        auto in = reinterpret_cast<const unsigned char*>(src);
+        const auto in_end = in + n;
+        auto out = reinterpret_cast<unsigned char*>(dst);
+        const auto out_begin = out;
+        const auto out_end = out + size;
+        while(in < in_end)
+        {
+            const unsigned token = *in++;
+            size_t literals = token >> 4;
+            if(literals == 15 && !read_length(in, in_end, literals)) { return false; }
+            if(literals > static_cast<size_t>(in_end - in)
+               || literals > static_cast<size_t>(out_end - out))
+            {
+                return false;
+            }
+            // Short runs are copied by a fixed 16 bytes where there's room, which is
+            // much faster than an exact copy; the excess is overwritten next.
+            if(literals <= 16 && in_end - in >= 16 && out_end - out >= 16)
+            {
+                std::memcpy(out, in, 16);
+            }
+            else
+            {
+                std::memcpy(out, in, literals);
+            }
+            in += literals;
+            out += literals;
+            // The last sequence has no match.
+            if(in == in_end) { break; }
+
+            if(in_end - in < 2) { return false; }
+            const size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+            in += 2;
+            size_t length = token & 15;
+            if(length == 15 && !read_length(in, in_end, length)) { return false; }
+            length += min_match;
+            if(offset == 0 || offset > static_cast<size_t>(out - out_begin)
+               || length > static_cast<size_t>(out_end - out))
+            {
+                return false;
+            }
+            const unsigned char* match = out - offset;
+            if(offset >= 8 && static_cast<size_t>(out_end - out) >= length + 8)
+            {
+                // Each 8 bytes are copied from before the ones written.
+                for(size_t i = 0; i < length; i += 8) { std::memcpy(out + i, match + i, 8); }
+                out += length;
+            }
+            else if(offset >= length)
+            {
+                std::memcpy(out, match, length);
+                out += length;
+            }
+            else
+            {
+                // The match overlaps what it produces, e.g. a run of one byte.
+                for(size_t i = 0; i < length; ++i) { *out++ = *match++; }
+            }
+        }
+        return out == out_end;
+    }
+
+private:
+    static constexpr size_t min_match = 4;
+    static constexpr size_t max_offset = 65535;
+    static constexpr unsigned hash_log = 14;
+    static constexpr size_t table_size = size_t(1) << hash_log;
+
+    static uint32_t read32(const unsigned char* p) noexcept
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    /** Returns the number of bytes `a` and `b` have in common, up to `b_end`. */
+    static size_t match_length(const unsigned char* a, const unsigned char* b,
+            const unsigned char* b_end) noexcept
+    {
+        const unsigned char* const start = b;
+        while(b_end - b >= 8)
+        {
+            uint64_t x, y;
+            std::memcpy(&x, a, 8);
+            std::memcpy(&y, b, 8);
+            if(x != y)
+            {
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+                return static_cast<size_t>(b - start) + (__builtin_ctzll(x ^ y) >> 3);
+#else
+                break;
+#endif
+            }
+            a += 8;
+            b += 8;
+        }
+        while(b < b_end && *a == *b) { ++a; ++b; }
+        return static_cast<size_t>(b - start);
+    }
+
+    static uint32_t hash(uint32_t sequence) noexcept
+    {
+        return (sequence * 2654435761u) >> (32 - hash_log);
+    }
+
+    static unsigned char* write_length(unsigned char* out, const unsigned char* out_end,
+            size_t length) noexcept
+    {
+        for(; length >= 255; length -= 255)
+        {
+            if(out == out_end) { return nullptr; }
+            *out++ = 255;
+        }
+        if(out == out_end) { return nullptr; }
+        *out++ = static_cast<unsigned char>(length);
+        return out;
+    }
+
+    static bool read_length(const unsigned char*& in, const unsigned char* in_end,
+            size_t& length) noexcept
+    {
+        for(;;)
+        {
+            if(in == in_end) { return false; }
+            const unsigned byte = *in++;
+            length += byte;
+            if(byte != 255) { return true; }
+        }
+    }
+
+    /** Writes a sequence of literals followed by a match, unless `length` is 0. */
+    static unsigned char* emit(unsigned char* out, const unsigned char* out_end,
+            const unsigned char* literals, size_t literal_count, size_t offset,
+            size_t length) noexcept
+    {
+        if(out == out_end) { return nullptr; }
+        const size_t match_code = length > 0 ? length - min_match : 0;
+        unsigned char* token = out++;
+        *token = static_cast<unsigned char>((std::min<size_t>(literal_count, 15) << 4)
+            | std::min<size_t>(match_code, 15));
+        if(literal_count >= 15 && !(out = write_length(out, out_end, literal_count - 15)))
+        {
+            return nullptr;
+        }
+        if(literal_count > static_cast<size_t>(out_end - out)) { return nullptr; }
+        std::memcpy(out, literals, literal_count);
+        out += literal_count;
+        if(length == 0) { return out; }
+
+        if(out_end - out < 2) { return nullptr; }
+        *out++ = static_cast<unsigned char>(offset);
+        *out++ = static_cast<unsigned char>(offset >> 8);
+        if(match_code >= 15 && !(out = write_length(out, out_end, match_code - 15)))
+        {
+            return nullptr;
+        }
+        return out;
+    }
+
+    std::vector<uint32_t> table_;
+};
+
+namespace detail {
+
+/**
+ * The on-disk layout shared by `compressed_writer` and `compressed_reader`, in the
+ * byte order of the machine that wrote it:
+ *
+ *   header | compressed blocks | index
+ *
+ * The index holds one entry per block, in order. Blocks that don't compress are
+ * stored as they are.
+ */
+namespace compressed_format {
+
+struct header
+{
+    char magic[8];
+    uint32_t codec;
+    uint32_t reserved;
+    uint64_t block_size;
+    uint64_t size;
+    uint64_t block_count;
+    uint64_t index_offset;
+    uint64_t checksum;
+};
+
+struct index_entry
+{
+    uint64_t offset;
+    uint32_t size;
+    uint32_t flags;
+};
+
+constexpr size_t header_size = 64;
+constexpr uint32_t stored = 1;
+
+inline const char* magic() noexcept { return "MIOBLKZ1"; }
+
+inline uint64_t header_checksum(const header& h) noexcept
+{
+    return fnv1a(&h, offsetof(header, checksum));
+}
+
+} // namespace compressed_format
+} // namespace detail
+
+struct compressed_writer_options
+{
+    // Size of the blocks the data are split into and compressed separately. Reading
+    // any byte decompresses its whole block.
+    size_t block_size = 64 << 10;
+
+    // Size the container file starts out with, before it grows to fit the blocks.
+    size_t initial_capacity = 1 << 20;
+};
+
+/**
+ * Writes data into a container of separately compressed fixed-size blocks, which
+ * `basic_compressed_reader` reads back at random offsets.
+ *
+ * Data are buffered until a block is full, which is then compressed straight into
+ * the growing `mmap_sink` the container is written through. `close` compresses the
+ * last, partial block and appends the index and the header, after which the
+ * container is valid. A writer is not thread-safe.
+ */
+template<typename Codec>
+class basic_compressed_writer
+{
+public:
+    using size_type = size_t;
+
+    basic_compressed_writer() = default;
+    basic_compressed_writer(const basic_compressed_writer&) = delete;
+    basic_compressed_writer& operator=(const basic_compressed_writer&) = delete;
+
+#ifdef __cpp_exceptions
+    /**
+     * The same as invoking the `open` function, except any error that may occur
+     * while creating the container is wrapped in a `std::system_error` and is thrown.
+     */
+    template<typename String>
+    explicit basic_compressed_writer(const String& path,
+            const compressed_writer_options& options = compressed_writer_options())
+    {
+        std::error_code error;
+        open(path, options, error);
+        if(error) { throw std::system_error(error); }
+    }
+#endif // __cpp_exceptions
+
+    /** Writes the last block, the index and the header, ignoring errors. */
+    ~basic_compressed_writer()
+    {
+        std::error_code error;
+        close(error);
+    }
+
+    /**
+     * Creates the container at `path`, replacing any file there. Upon failure,
+     * `error` is set and the writer remains closed.
+     */
+    template<typename String>
+    void open(const String& path, const compressed_writer_options& options,
+            std::error_code& error)
+    {
+        close(error);
+        if(error) { return; }
+        if(options.block_size == 0 || options.block_size > UINT32_MAX)
+        {
+            error = std::make_error_code(std::errc::invalid_argument);
+            return;
+        }
+        file_.open(path, detail::compressed_format::header_size, options.initial_capacity,
+            error);
+        if(error) { return; }
+        block_size_ = options.block_size;
+        block_.reserve(block_size_);
+        end_ = detail::compressed_format::header_size;
+    }
+
+    /** Appends the `size` bytes at `data`. */
+    void write(const void* data, size_type size, std::error_code& error)
+    {
+        error.clear();
+        if(!is_open())
+        {
+            error = std::make_error_code(std::errc::bad_file_descriptor);
+            return;
+        }
+        auto p = static_cast<const char*>(data);
+        while(size > 0)
+        {
+            const size_type n = std::min(size, block_size_ - block_.size());
+            block_.insert(block_.end(), p, p + n);
+            p += n;
+            size -= n;
+            size_ += n;
+            if(block_.size() == block_size_)
+            {
+                write_block(error);
+                if(error) { return; }
+            }
+        }
+    }
+
+    /**
+     * Writes the last block, the index and the header, shrinks the file to its
+     * contents and syncs it, then closes it.
+     */
+    void close(std::error_code& error)
+    {
+        error.clear();
+        if(!is_open()) { return; }
+        if(!block_.empty()) { write_block(error); }
+        if(!error) { write_index(error); }
+        file_.close();
+        index_.clear();
+        block_.clear();
+        size_ = end_ = 0;
+    }
+
+    bool is_open() const noexcept { return file_.is_open(); }
+
+    /** Returns the number of bytes written, before compression. */
+    size_type size() const noexcept { return size_; }
+
+    /** Returns the size of the compressed blocks written so far. */
+    size_type compressed_size() const noexcept
+    {
+        return end_ > detail::compressed_format::header_size
+            ? end_ - detail::compressed_format::header_size : 0;
+    }
+
+private:
+    void write_block(std::error_code& error)
+    {
+        file_.reserve(end_ + Codec::compress_bound(block_.size()), error);
+        if(error) { return; }
+        char* const out = file_.data() + end_;
+        detail::compressed_format::index_entry entry;
+        entry.offset = end_;
+        entry.flags = 0;
+        size_type size = codec_.compress(block_.data(), block_.size(), out, block_.size() - 1);
+        if(size == 0)
+        {
+            // Incompressible: stored as it is.
+            std::memcpy(out, block_.data(), block_.size());
+            size = block_.size();
+            entry.flags = detail::compressed_format::stored;
+        }
+        entry.size = static_cast<uint32_t>(size);
+        index_.push_back(entry);
+        end_ += size;
+        block_.clear();
+    }
+
+    void write_index(std::error_code& error)
+    {
+        namespace format = detail::compressed_format;
+        const size_type index_offset = (end_ + 7) & ~size_type(7);
+        const size_type total_size = index_offset + index_.size() * sizeof(format::index_entry);
+        file_.reserve(total_size, error);
+        if(error) { return; }
+        char* const base = file_.data();
+        std::memset(base + end_, 0, index_offset - end_);
+        if(!index_.empty())
+        {
+            std::memcpy(base + index_offset, index_.data(),
+                index_.size() * sizeof(format::index_entry));
+        }
+
+        format::header header;
+        std::memcpy(header.magic, format::magic(), sizeof(header.magic));
+        header.codec = Codec::id;
+        header.reserved = 0;
+        header.block_size = block_size_;
+        header.size = size_;
+        header.block_count = index_.size();
+        header.index_offset = index_offset;
+        header.checksum = format::header_checksum(header);
+        file_.finish(&header, sizeof(header), total_size, error);
+    }
+
+    Codec codec_;
+    detail::growing_sink file_;
+    std::vector<detail::compressed_format::index_entry> index_;
+    std::vector<char> block_;
+    size_type block_size_ = 0;
+    size_type size_ = 0;
+    size_type end_ = 0;
+};
+
+struct compressed_reader_options
+{
+    // Upper bound on the memory taken by decompressed blocks, split evenly between
+    // the shards of the cache. Each shard holds at least one block.
+    size_t cache_size = 64 << 20;
+
+    // Number of independently locked shards of the cache, which blocks are spread
+    // over by index, so that concurrent readers rarely contend.
+    size_t shards = 16;
+
+    // How the container is opened; see `open_options`.
+    open_options open;
+};
+
+/**
+ * A decompressed block of a `basic_compressed_reader`, or part of one. It keeps the
+ * block alive, even once evicted from the cache.
+ */
+class compressed_span
+{
+public:
+    using span_type = mio::span<const char>;
+
+    compressed_span() = default;
+    compressed_span(std::shared_ptr<const std::vector<char>> block, span_type data)
+        : block_(std::move(block))
+        , data_(data)
+    {}
+
+    const char* data() const noexcept { return data_.data(); }
+    size_t size() const noexcept { return data_.size(); }
+    bool empty() const noexcept { return data_.empty(); }
+    const char* begin() const noexcept { return data_.data(); }
+    const char* end() const noexcept { return data_.data() + data_.size(); }
+    char operator[](size_t i) const noexcept { return data_.data()[i]; }
+    span_type as_span() const noexcept { return data_; }
+
+private:
+    std::shared_ptr<const std::vector<char>> block_;
+    span_type data_;
+};
+
+/**
+ * Maps a container written by `basic_compressed_writer` and reads it at any offset
+ * of the uncompressed data, decompressing the blocks needed on demand.
+ *
+ * Decompressed blocks are kept in a sharded LRU cache of bounded size, so that
+ * reading near a recent read doesn't decompress again. `view` gives zero-copy access
+ * to the rest of the block holding an offset; `read` copies any range. Reads may be
+ * made from any number of threads; a block missing from the cache may then be
+ * decompressed by more than one of them.
+ */
+template<typename Codec>
+class basic_compressed_reader
+{
+public:
+    using size_type = size_t;
+
+    struct statistics
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    basic_compressed_reader() = default;
+    basic_compressed_reader(const basic_compressed_reader&) = delete;
+    basic_compressed_reader& operator=(const basic_compressed_reader&) = delete;
+
+#ifdef __cpp_exceptions
+    /**
+     * The same as invoking the `open` function, except any error that may occur
+     * while opening the container is wrapped in a `std::system_error` and is thrown.
+     */
+    template<typename String>
+    explicit basic_compressed_reader(const String& path,
+            const compressed_reader_options& options = compressed_reader_options())
+    {
+        std::error_code error;
+        open(path, options, error);
+        if(error) { throw std::system_error(error); }
+    }
+#endif // __cpp_exceptions
+
+    /**
+     * Maps the container at `path`. Fails with `invalid_argument` if it isn't a
+     * valid container written with `Codec`, in which case the reader remains closed.
+     */
+    template<typename String>
+    void open(const String& path, const compressed_reader_options& options,
+            std::error_code& error)
+    {
+        close();
+        file_.map(path, 0, map_entire_file, options.open, error);
+        if(error) { return; }
+        if(!read_header())
+        {
+            close();
+            error = std::make_error_code(std::errc::invalid_argument);
+            return;
+        }
+        const size_type shard_count = std::max<size_type>(options.shards, 1);
+        const size_type per_shard = std::max<size_type>(
+            options.cache_size / shard_count / block_size_, 1);
+        shards_.reset(new shard[shard_count]);
+        shard_count_ = shard_count;
+        for(size_type i = 0; i < shard_count; ++i) { shards_[i].capacity = per_shard; }
+    }
+
+    template<typename String>
+    void open(const String& path, std::error_code& error)
+    {
+        open(path, compressed_reader_options(), error);
+    }
+
+    /** Closes the container. No thread may be reading from it. */
+    void close()
+    {
+        file_.unmap();
+        shards_.reset();
+        shard_count_ = 0;
+        index_ = nullptr;
+        size_ = block_size_ = block_count_ = 0;
+    }
+
+    bool is_open() const noexcept { return file_.is_open(); }
+
+    /** Returns the size of the uncompressed data. */
+    size_type size() const noexcept { return size_; }
+    size_type block_size() const noexcept { return block_size_; }
+    size_type block_count() const noexcept { return block_count_; }
+
+    const mmap_source& mmap() const noexcept { return file_; }
+
+    /**
+     * Returns the uncompressed data from `offset` to the end of its block, or an
+     * empty span at the end of the data. Upon failure, e.g. if the block is
+     * corrupt, `error` is set.
+     */
+    compressed_span view(size_type offset, std::error_code& error) const
+    {
+        error.clear();
+        if(offset >= size_) { return compressed_span(); }
+        const size_type index = offset / block_size_;
+        auto block = get_block(index, error);
+        if(error) { return compressed_span(); }
+        const size_type in_block = offset - index * block_size_;
+        const span<const char> data(block->data() + in_block, block->size() - in_block);
+        return compressed_span(std::move(block), data);
+    }
+
+    /**
+     * Copies up to `length` bytes from `offset` to `buffer` and returns their
+     * number, which is less only at the end of the data or upon failure.
+     */
+    size_type read(size_type offset, void* buffer, size_type length, std::error_code& error) const
+    {
+        error.clear();
+        auto out = static_cast<char*>(buffer);
+        size_type done = 0;
+        while(done < length)
+        {
+            const compressed_span data = view(offset + done, error);
+            if(error || data.empty()) { break; }
+            const size_type n = std::min(data.size(), length - done);
+            std::memcpy(out + done, data.data(), n);
+            done += n;
+        }
+        return done;
+    }
+
+    statistics stats() const noexcept
+    {
+        statistics stats;
+        stats.hits = hits_.load();
+        stats.misses = misses_.load();
+        stats.evictions = evictions_.load();
+        return stats;
+    }
+
+private:
+    using block_ptr = std::shared_ptr<const std::vector<char>>;
+
+    struct shard
+    {
+        using lru_list = std::list<std::pair<size_type, block_ptr>>;
+
+        std::mutex mutex;
+        // Most recently used first.
+        lru_list lru;
+        std::unordered_map<size_type, typename lru_list::iterator> blocks;
+        size_type capacity = 1;
+    };
+
+    bool read_header() noexcept
+    {
+        namespace format = detail::compressed_format;
+        const size_type file_size = file_.size();
+        format::header header;
+        if(file_size < format::header_size) { return false; }
+        std::memcpy(&header, file_.data(), sizeof(header));
+        if(std::memcmp(header.magic, format::magic(), sizeof(header.magic)) != 0
+           || header.checksum != format::header_checksum(header)
+           || header.codec != Codec::id
+           || header.block_size == 0 || header.block_size > UINT32_MAX
+           || header.block_count != header.size / header.block_size
+                                     + (header.size % header.block_size != 0)
+           || header.index_offset % alignof(format::index_entry) != 0
+           || header.index_offset > file_size
+           || header.block_count > (file_size - header.index_offset) / sizeof(format::index_entry))
+        {
+            return false;
+        }
+        index_ = reinterpret_cast<const format::index_entry*>(file_.data() + header.index_offset);
+        size_ = header.size;
+        block_size_ = header.block_size;
+        block_count_ = header.block_count;
+        return true;
+    }
+
+    block_ptr get_block(size_type index, std::error_code& error) const
+    {
+        shard& s = shards_[index % shard_count_];
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            auto it = s.blocks.find(index);
+            if(it != s.blocks.end())
+            {
+                s.lru.splice(s.lru.begin(), s.lru, it->second);
+                ++hits_;
+                return it->second->second;
+            }
+        }
+        ++misses_;
+        block_ptr block = decompress(index, error);
+        if(error) { return nullptr; }
+
+        std::lock_guard<std::mutex> lock(s.mutex);
+        // Another thread may have decompressed it meanwhile.
+        auto it = s.blocks.find(index);
+        if(it != s.blocks.end()) { return it->second->second; }
+        s.lru.emplace_front(index, block);
+        s.blocks[index] = s.lru.begin();
+        while(s.lru.size() > s.capacity)
+        {
+            s.blocks.erase(s.lru.back().first);
+            s.lru.pop_back();
+            ++evictions_;
+        }
+        return block;
+    }
+
+    block_ptr decompress(size_type index, std::error_code& error) const
+    {
+        if(index >= block_count_)
+        {
+            error = std::make_error_code(std::errc::bad_message);
+            return nullptr;
+        }
+        const auto& entry = index_[index];
+        const size_type block_size = std::min(block_size_, size_ - index * block_size_);
+        if(entry.offset > file_.size() || entry.size > file_.size() - entry.offset)
+        {
+            error = std::make_error_code(std::errc::bad_message);
+            return nullptr;
+        }
+        const char* const in = file_.data() + entry.offset;
+        std::shared_ptr<std::vector<char>> block = std::make_shared<std::vector<char>>(block_size);
+        if(entry.flags & detail::compressed_format::stored)
+        {
+            if(entry.size != block_size)
+            {
+                error = std::make_error_code(std::errc::bad_message);
+                return nullptr;
+            }
+            std::memcpy(block->data(), in, block_size);
+        }
+        else if(!codec_.decompress(in, entry.size, block->data(), block_size))
+        {
+            error = std::make_error_code(std::errc::bad_message);
+            return nullptr;
+        }
+        return block;
+    }
+
+    Codec codec_;
+    mmap_source file_;
+    const detail::compressed_format::index_entry* index_ = nullptr;
+    size_type size_ = 0;
+    size_type block_size_ = 0;
+    size_type block_count_ = 0;
+    std::unique_ptr<shard[]> shards_;
+    size_type shard_count_ = 0;
+    mutable std::atomic<uint64_t> hits_{0};
+    mutable std::atomic<uint64_t> misses_{0};
+    mutable std::atomic<uint64_t> evictions_{0};
+};
+
+using compressed_writer = basic_compressed_writer<lz_codec>;
+using compressed_reader = basic_compressed_reader<lz_codec>;
+
+} // namespace mio
+
+#endif // MIO_COMPRESSED_HEADER
@@ -0,0 +1,480 @@
+#ifndef MIO_DEMAND_MMAP_HEADER
+#define MIO_DEMAND_MMAP_HEADER
+
+#include "mio/mmap.hpp"
+#include "mio/page.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// userfaultfd support is detected from the kernel headers and may be disabled by
+// defining `MIO_NO_USERFAULTFD`.
+#if !defined(MIO_NO_USERFAULTFD) && defined(__linux__) && defined(__has_include)
+# if __has_include(<linux/userfaultfd.h>)
+#  define MIO_HAS_USERFAULTFD 1
+# endif
+#endif
+
+#ifdef MIO_HAS_USERFAULTFD
+# include <cerrno>
+# include <fcntl.h>
+# include <linux/userfaultfd.h>
+# include <poll.h>
+# include <sys/eventfd.h>
+# include <sys/ioctl.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+namespace mio {
+
+/**
+ * Supplies the contents of a `demand_mmap`: fills the `length` bytes at `buffer`
+ * with those at `offset` in the mapping. Offsets and lengths are multiples of the
+ * page size, and the range may extend past the end of the mapping into its last
+ * page. Upon failure, set `error`; the range then reads as zeros.
+ *
+ * The provider is invoked on the mapping's handler thread, one range at a time. It
+ * must not throw nor access the mapping, whose faults it is there to resolve.
+ */
+using page_provider = std::function<void(size_t offset, char* buffer, size_t length,
+    std::error_code& error)>;
+
+struct demand_options
+{
+    // Number of pages following a faulting page that are filled along with it,
+    // unless they already were, in the same call to the provider. Sequential access
+    // then faults once per `1 + fault_around` pages.
+    size_t fault_around = 15;
+
+    // Maximum number of pages filled by one call to the provider. Faults pending on
+    // adjacent pages when the handler wakes up are filled together, up to this many.
+    size_t max_batch = 64;
+};
+
+/**
+ * A mapping whose pages are filled on first access by a `page_provider`, e.g. from
+ * decompressed blocks, a remote cache or computed data, rather than from a file,
+ * while keeping the plain pointer access of `basic_mmap`.
+ *
+ * The mapping is anonymous memory registered with userfaultfd. A handler thread
+ * waits for faults on pages that weren't filled yet, fills them through the provider
+ * and wakes the faulting threads up. Once filled, a page is ordinary memory: it may
+ * be written to, and isn't filled again. `prefetch` asks the handler to fill a range
+ * ahead of its use.
+ *
+ * This is only supported on Linux, where userfaultfd must be allowed for the process.
+ * Unprivileged processes need `vm.unprivileged_userfaultfd` set, or else Linux 5.11,
+ * with which only faults in user space are handled: system calls reading into or
+ * writing from pages not filled yet then fail with `EFAULT`. Elsewhere, `map` fails
+ * with `not_supported`.
+ *
+ * The mapping is not thread-safe, apart from accessing its data and `prefetch`.
+ */
+class demand_mmap
+{
+public:
+    using value_type = char;
+    using size_type = size_t;
+    using pointer = char*;
+    using const_pointer = const char*;
+    using iterator = pointer;
+    using const_iterator = const_pointer;
+
+    struct statistics
+    {
+        // Number of faults handled, of provider calls and of pages filled, and of
+        // those pages that were filled by `prefetch` or around a fault.
+        uint64_t faults = 0;
+        uint64_t batches = 0;
+        uint64_t pages_filled = 0;
+        uint64_t pages_prefetched = 0;
+    };
+
+    demand_mmap() = default;
+    demand_mmap(demand_mmap&&) = default;
+    demand_mmap& operator=(demand_mmap&&) = default;
+
+#ifdef __cpp_exceptions
+    /**
+     * The same as invoking the `map` function, except any error that may occur
+     * while setting up the mapping is wrapped in a `std::system_error` and is thrown.
+     */
+    demand_mmap(size_type size, page_provider provider,
+            const demand_options& options = demand_options())
+    {
+        std::error_code error;
+        map(size, std::move(provider), options, error);
+        if(error) { throw std::system_error(error); }
+    }
+#endif // __cpp_exceptions
+
+    /**
+     * Sets up a mapping of `size` bytes filled by `provider`, replacing any previous
+     * mapping. Upon failure, `error` is set and the object remains unmapped.
+     */
+    void map(size_type size, page_provider provider, const demand_options& options,
+            std::error_code& error)
+    {
+        error.clear();
+        unmap();
+        if(size == 0 || !provider)
+        {
+            error = std::make_error_code(std::errc::invalid_argument);
+            return;
+        }
+#ifdef MIO_HAS_USERFAULTFD
+        std::unique_ptr<handler> h(new handler(size, std::move(provider), options));
+        h->open(error);
+        if(error) { return; }
+        handler_ = std::move(h);
+#else
+        (void)options;
+        error = std::make_error_code(std::errc::not_supported);
+#endif
+    }
+
+    /** Stops the handler and releases the mapping. No thread may access it anymore. */
+    void unmap() { handler_.reset(); }
+
+    bool is_open() const noexcept { return handler_ != nullptr; }
+
+    pointer data() noexcept { return handler_ ? handler_->data() : nullptr; }
+    const_pointer data() const noexcept { return handler_ ? handler_->data() : nullptr; }
+    size_type size() const noexcept { return handler_ ? handler_->size() : 0; }
+    size_type length() const noexcept { return size(); }
+    bool empty() const noexcept { return size() == 0; }
+
+    iterator begin() noexcept { return data(); }
+    const_iterator begin() const noexcept { return data(); }
+    const_iterator cbegin() const noexcept { return data(); }
+    iterator end() noexcept { return data() + size(); }
+    const_iterator end() const noexcept { return data() + size(); }
+    const_iterator cend() const noexcept { return data() + size(); }
+
+    char& operator[](const size_type i) noexcept { return data()[i]; }
+    const char& operator[](const size_type i) const noexcept { return data()[i]; }
+
+    /**
+     * Asks the handler to fill the pages of the given range that weren't yet, in the
+     * background. This is only a hint: accesses fault as usual until it's done.
+     */
+    void prefetch(size_type offset, size_type length)
+    {
+        if(handler_) { handler_->prefetch(offset, length); }
+    }
+
+    /**
+     * Returns the error the provider, or placing its pages in the mapping, last
+     * failed with, if any. Pages that couldn't be placed read as zeros, or are
+     * filled again on their next fault if even that failed.
+     */
+    std::error_code error() const
+    {
+        return handler_ ? handler_->error() : std::error_code();
+    }
+
+    statistics stats() const { return handler_ ? handler_->stats() : statistics(); }
+
+private:
+#ifdef MIO_HAS_USERFAULTFD
+    /**
+     * The region, the userfaultfd and the thread serving it, kept at a fixed address
+     * so that the mapping may be moved.
+     */
+    class handler
+    {
+    public:
+        handler(size_type size, page_provider provider, const demand_options& options)
+            : size_(size)
+            , mapped_length_(make_offset_page_aligned(size + page_size() - 1))
+            , provider_(std::move(provider))
+            , options_(options)
+            , filled_(mapped_length_ / page_size(), false)
+        {
+            options_.max_batch = std::max<size_type>(options_.max_batch, 1);
+        }
+
+        ~handler()
+        {
+            if(thread_.joinable())
+            {
+                stopping_ = true;
+                wake();
+                thread_.join();
+            }
+            if(event_fd_ != -1) { ::close(event_fd_); }
+            if(uffd_ != -1) { ::close(uffd_); }
+            if(data_) { ::munmap(data_, mapped_length_); }
+        }
+
+        void open(std::error_code& error)
+        {
+            uffd_ = static_cast<int>(::syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK));
+# ifdef UFFD_USER_MODE_ONLY
+            // Unprivileged processes may still handle faults in user space only, on
+            // Linux 5.11 and later.
+            if(uffd_ == -1 && errno == EPERM)
+            {
+                uffd_ = static_cast<int>(::syscall(__NR_userfaultfd,
+                    O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY));
+            }
+# endif
+            if(uffd_ == -1) { error = detail::last_error(); return; }
+
+            uffdio_api api = {};
+            api.api = UFFD_API;
+            if(::ioctl(uffd_, UFFDIO_API, &api) == -1) { error = detail::last_error(); return; }
+
+            void* data = ::mmap(nullptr, mapped_length_, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if(data == MAP_FAILED) { error = detail::last_error(); return; }
+            data_ = static_cast<char*>(data);
+
+            uffdio_register reg = {};
+            reg.range.start = reinterpret_cast<uintptr_t>(data_);
+            reg.range.len = mapped_length_;
+            reg.mode = UFFDIO_REGISTER_MODE_MISSING;
+            if(::ioctl(uffd_, UFFDIO_REGISTER, &reg) == -1) { error = detail::last_error(); return; }
+
+            event_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if(event_fd_ == -1) { error = detail::last_error(); return; }
+            thread_ = std::thread([this] { run(); });
+        }
+
+        char* data() const noexcept { return data_; }
+        size_type size() const noexcept { return size_; }
+
+        void prefetch(size_type offset, size_type length)
+        {
+            if(offset >= size_ || length == 0) { return; }
+            length = std::min(length, size_ - offset);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                prefetches_.emplace_back(offset / page_size(),
+                    (offset + length - 1) / page_size() + 1);
+            }
+            wake();
+        }
+
+        std::error_code error() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return error_;
+        }
+
+        statistics stats() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return stats_;
+        }
+
+    private:
+        using page_range = std::pair<size_type, size_type>;
+
+        void wake() noexcept
+        {
+            const uint64_t one = 1;
+            while(::write(event_fd_, &one, sizeof(one)) == -1 && errno == EINTR) {}
+        }
+
+        void run()
+        {
+            std::vector<char> buffer(options_.max_batch * page_size());
+            std::vector<size_type> faults;
+            uffd_msg messages[64];
+            while(!stopping_)
+            {
+                pollfd fds[2] = { { uffd_, POLLIN, 0 }, { event_fd_, POLLIN, 0 } };
+                if(::poll(fds, 2, -1) == -1) { continue; }
+
+                if(fds[1].revents != 0)
+                {
+                    uint64_t count;
+                    while(::read(event_fd_, &count, sizeof(count)) > 0) {}
+                }
+
+                // Gather all pending faults, so that adjacent ones are filled at once.
+                faults.clear();
+                for(;;)
+                {
+                    const ssize_t n = ::read(uffd_, messages, sizeof(messages));
+                    if(n <= 0) { break; }
+                    for(size_t i = 0; i < static_cast<size_t>(n) / sizeof(uffd_msg); ++i)
+                    {
+                        if(messages[i].event != UFFD_EVENT_PAGEFAULT) { continue; }
+                        const auto address = static_cast<uintptr_t>(messages[i].arg.pagefault.address);
+                        faults.push_back((address - reinterpret_cast<uintptr_t>(data_)) / page_size());
+                    }
+                }
+                std::sort(faults.begin(), faults.end());
+                faults.erase(std::unique(faults.begin(), faults.end()), faults.end());
+                add_stats(faults.size(), 0, 0, 0);
+                for(size_t i = 0; i < faults.size();)
+                {
+                    const size_type first = faults[i++];
+                    if(filled_[first])
+                    {
+                        // Filled since it faulted, by a previous batch.
+                        wake_range(first, 1);
+                        continue;
+                    }
+                    // Adjacent faults join the batch, then the pages following them.
+                    size_type last = first + 1;
+                    while(i < faults.size() && faults[i] == last && !filled_[last]
+                          && last - first < options_.max_batch)
+                    {
+                        ++last;
+                        ++i;
+                    }
+                    const size_type faulted_end = last;
+                    while(last < filled_.size() && !filled_[last]
+                          && last - faulted_end < options_.fault_around
+                          && last - first < options_.max_batch)
+                    {
+                        ++last;
+                    }
+                    fill(first, last, buffer, last - faulted_end);
+                }
+
+                std::vector<page_range> prefetches;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    prefetches.swap(prefetches_);
+                }
+                for(const auto& range : prefetches) { prefetch_range(range, buffer); }
+            }
+        }
+
+        /** Fills the pages in the range that weren't yet, in batches. */
+        void prefetch_range(page_range range, std::vector<char>& buffer)
+        {
+            for(size_type page = range.first; page < range.second;)
+            {
+                if(filled_[page]) { ++page; continue; }
+                size_type end = page + 1;
+                while(end < range.second && !filled_[end] && end - page < options_.max_batch) { ++end; }
+                fill(page, end, buffer, end - page);
+                page = end;
+            }
+        }
+
+        /** Fills the pages in [first, last), none of which may have been filled. */
+        void fill(size_type first, size_type last, std::vector<char>& buffer, size_type extra)
+        {
+            const size_type length = (last - first) * page_size();
+            std::error_code error;
+            provider_(first * page_size(), buffer.data(), length, error);
+            if(error)
+            {
+                std::fill(buffer.begin(), buffer.begin() + length, 0);
+                std::lock_guard<std::mutex> lock(mutex_);
+                error_ = error;
+            }
+
+            size_type done = 0;
+            while(done < length)
+            {
+                uffdio_copy copy = {};
+                copy.dst = reinterpret_cast<uintptr_t>(data_) + first * page_size() + done;
+                copy.src = reinterpret_cast<uintptr_t>(buffer.data()) + done;
+                copy.len = length - done;
+                if(::ioctl(uffd_, UFFDIO_COPY, &copy) == 0) { done = length; break; }
+                if(copy.copy > 0) { done += static_cast<size_type>(copy.copy); }
+                if(errno == EAGAIN) { continue; }
+                // The page at `done` is somehow populated already: skip it, making
+                // sure whoever waits on it wakes up.
+                if(errno == EEXIST)
+                {
+                    wake_range(first + done / page_size(), 1);
+                    done += page_size();
+                    continue;
+                }
+                std::lock_guard<std::mutex> lock(mutex_);
+                error_ = detail::last_error();
+                break;
+            }
+            if(done < length) { done += fill_zeros(first * page_size() + done, length - done); }
+
+            // Pages left unfilled are woken up, so that their faults are retried
+            // rather than left waiting.
+            const size_type filled = done / page_size();
+            if(first + filled < last) { wake_range(first + filled, last - first - filled); }
+            std::fill(filled_.begin() + first, filled_.begin() + first + filled, true);
+            add_stats(0, 1, filled, std::min(extra, filled));
+        }
+
+        /**
+         * Maps zero pages over the `length` bytes at `offset` after a copy failed, and
+         * returns the number of bytes mapped.
+         */
+        size_type fill_zeros(size_type offset, size_type length) noexcept
+        {
+            uffdio_zeropage zero = {};
+            zero.range.start = reinterpret_cast<uintptr_t>(data_) + offset;
+            zero.range.len = length;
+            if(::ioctl(uffd_, UFFDIO_ZEROPAGE, &zero) == 0) { return length; }
+            return zero.zeropage > 0 ? static_cast<size_type>(zero.zeropage) : 0;
+        }
+
+        void wake_range(size_type first, size_type count) noexcept
+        {
+            uffdio_range range;
+            range.start = reinterpret_cast<uintptr_t>(data_) + first * page_size();
+            range.len = count * page_size();
+            ::ioctl(uffd_, UFFDIO_WAKE, &range);
+        }
+
+        void add_stats(uint64_t faults, uint64_t batches, uint64_t pages, uint64_t prefetched)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.faults += faults;
+            stats_.batches += batches;
+            stats_.pages_filled += pages;
+            stats_.pages_prefetched += prefetched;
+        }
+
+        size_type size_;
+        size_type mapped_length_;
+        page_provider provider_;
+        demand_options options_;
+        char* data_ = nullptr;
+        int uffd_ = -1;
+        int event_fd_ = -1;
+        // Which pages were filled. Only the handler thread accesses it.
+        std::vector<bool> filled_;
+
+        mutable std::mutex mutex_;
+        std::vector<page_range> prefetches_;
+        std::error_code error_;
+        statistics stats_;
+        std::atomic<bool> stopping_{false};
+        std::thread thread_;
+    };
+#else
+    class handler
+    {
+    public:
+        char* data() const noexcept { return nullptr; }
+        size_type size() const noexcept { return 0; }
+        void prefetch(size_type, size_type) {}
+        std::error_code error() const { return std::error_code(); }
+        statistics stats() const { return statistics(); }
+    };
+#endif
+
+    std::unique_ptr<handler> handler_;
+};
+
+} // namespace mio
+
+#endif // MIO_DEMAND_MMAP_HEADER
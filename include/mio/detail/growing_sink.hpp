@@ -0,0 +1,82 @@
+#ifndef MIO_GROWING_SINK_HEADER
+#define MIO_GROWING_SINK_HEADER
+
+#include "mio/mmap.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <system_error>
+
+namespace mio {
+namespace detail {
+
+/**
+ * A file that a writer of one of mio's file formats fills in through a `mmap_sink`,
+ * growing it as it goes, and that starts with a fixed-size header.
+ *
+ * The header is zeroed by `open` and only written by `finish`, once everything else
+ * is in place, so that a file left unfinished is never mistaken for a valid one.
+ */
+class growing_sink
+{
+public:
+    using size_type = size_t;
+
+    /**
+     * Creates the file at `path`, replacing any file there, with a size of
+     * `initial_capacity` bytes, or of `header_size` if that's more. Upon failure,
+     * `error` is set and the file remains closed.
+     */
+    template<typename String>
+    void open(const String& path, size_type header_size, size_type initial_capacity,
+            std::error_code& error)
+    {
+        const size_type capacity = std::max(initial_capacity, header_size);
+        open_options options;
+        options.initial_size = capacity;
+        file_.map(path, 0, map_entire_file, options, error);
+        if(!error) { file_.truncate(capacity, error); }
+        if(error)
+        {
+            file_.unmap();
+            return;
+        }
+        std::memset(file_.data(), 0, header_size);
+    }
+
+    bool is_open() const noexcept { return file_.is_open(); }
+    char* data() noexcept { return file_.data(); }
+
+    /**
+     * Makes the file at least `size` bytes, at least doubling it when it grows so
+     * that the cost of remapping is amortized. This moves the mapping.
+     */
+    void reserve(size_type size, std::error_code& error)
+    {
+        if(size <= file_.size()) { return; }
+        file_.truncate(std::max(size, 2 * file_.size()), error);
+    }
+
+    /**
+     * Writes the `length` bytes of `header` at the start of the file, shrinks it to
+     * `size` bytes and syncs it.
+     */
+    void finish(const void* header, size_type length, size_type size, std::error_code& error)
+    {
+        std::memcpy(file_.data(), header, length);
+        file_.truncate(size, error);
+        if(!error) { file_.sync(error); }
+    }
+
+    /** Unmaps and closes the file, finished or not. */
+    void close() { file_.unmap(); }
+
+private:
+    mmap_sink file_;
+};
+
+} // namespace detail
+} // namespace mio
+
+#endif // MIO_GROWING_SINK_HEADER
@@ -0,0 +1,25 @@
+#ifndef MIO_HASH_HEADER
+#define MIO_HASH_HEADER
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mio {
+namespace detail {
+
+/** 64-bit FNV-1a, as used for the checksums and hash tables of mio's file formats. */
+inline uint64_t fnv1a(const void* data, size_t length,
+        uint64_t hash = 0xcbf29ce484222325ull) noexcept
+{
+    const auto p = static_cast<const unsigned char*>(data);
+    for(size_t i = 0; i < length; ++i)
+    {
+        hash = (hash ^ p[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+} // namespace detail
+} // namespace mio
+
+#endif // MIO_HASH_HEADER
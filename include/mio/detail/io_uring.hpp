@@ -0,0 +1,207 @@
+#ifndef MIO_IO_URING_HEADER
+#define MIO_IO_URING_HEADER
+
+// io_uring support is detected from the kernel headers and may be disabled by
+// defining `MIO_NO_IO_URING`. No liburing is needed, the ring is driven through
+// the raw system calls.
+#if !defined(MIO_NO_IO_URING) && defined(__linux__) && defined(__has_include)
+# if __has_include(<linux/io_uring.h>)
+#  define MIO_HAS_IO_URING 1
+# endif
+#endif
+
+#ifdef MIO_HAS_IO_URING
+
+#include <cstring>
+#include <system_error>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace mio {
+namespace detail {
+
+/**
+ * A minimal io_uring instance: one submission and one completion queue, with
+ * submission entries handed out in order and completions consumed in order.
+ */
+class io_uring
+{
+public:
+    io_uring() = default;
+    io_uring(const io_uring&) = delete;
+    io_uring& operator=(const io_uring&) = delete;
+
+    ~io_uring() { close(); }
+
+    /**
+     * Sets up a ring with room for `entries` submissions. Fails if the kernel does
+     * not support io_uring or if it is disallowed, e.g. by a seccomp filter.
+     */
+    void open(unsigned entries, std::error_code& error)
+    {
+        error.clear();
+        close();
+
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if(fd_ < 0)
+        {
+            fd_ = -1;
+            error.assign(errno, std::system_category());
+            return;
+        }
+
+        sq_ring_length_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_length_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if(single_mmap)
+        {
+            if(cq_ring_length_ > sq_ring_length_) { sq_ring_length_ = cq_ring_length_; }
+            cq_ring_length_ = sq_ring_length_;
+        }
+
+        sq_ring_ = map_ring(sq_ring_length_, IORING_OFF_SQ_RING);
+        cq_ring_ = single_mmap ? sq_ring_ : map_ring(cq_ring_length_, IORING_OFF_CQ_RING);
+        sqes_length_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = map_ring(sqes_length_, IORING_OFF_SQES);
+        if(!sq_ring_ || !cq_ring_ || !sqes)
+        {
+            error.assign(errno, std::system_category());
+            if(sqes) { ::munmap(sqes, sqes_length_); }
+            close();
+            return;
+        }
+
+        char* sq = static_cast<char*>(sq_ring_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sq_entries_ = params.sq_entries;
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+        sqe_tail_ = sqe_head_ = *sq_tail_;
+
+        char* cq = static_cast<char*>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    bool is_open() const noexcept { return fd_ != -1; }
+
+    void close() noexcept
+    {
+        if(sqes_) { ::munmap(sqes_, sqes_length_); }
+        if(cq_ring_ && cq_ring_ != sq_ring_) { ::munmap(cq_ring_, cq_ring_length_); }
+        if(sq_ring_) { ::munmap(sq_ring_, sq_ring_length_); }
+        if(fd_ != -1) { ::close(fd_); }
+        fd_ = -1;
+        sq_ring_ = cq_ring_ = nullptr;
+        sqes_ = nullptr;
+    }
+
+    /**
+     * Returns a zeroed submission entry to fill in, or `nullptr` if the submission
+     * queue is full. Entries are only passed to the kernel by `submit`.
+     */
+    io_uring_sqe* get_sqe() noexcept
+    {
+        const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if(sqe_tail_ - head >= sq_entries_) { return nullptr; }
+        io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+        ++sqe_tail_;
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    /**
+     * Submits all entries obtained since the last call, along with any the kernel
+     * didn't consume before, and waits for at least `wait_nr` completions. Returns
+     * the number of entries submitted.
+     */
+    unsigned submit(unsigned wait_nr, std::error_code& error) noexcept
+    {
+        error.clear();
+        unsigned tail = *sq_tail_;
+        for(; sqe_head_ != sqe_tail_; ++sqe_head_, ++tail)
+        {
+            sq_array_[tail & sq_mask_] = sqe_head_ & sq_mask_;
+        }
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+        // The kernel may have consumed fewer entries than it was passed last time,
+        // leaving them in the ring, so count them from its head.
+        const unsigned to_submit = tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+
+        if(to_submit == 0 && wait_nr == 0) { return 0; }
+        int ret;
+        do
+        {
+            ret = static_cast<int>(::syscall(__NR_io_uring_enter, fd_, to_submit,
+                wait_nr, wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+        } while(ret < 0 && errno == EINTR);
+        if(ret < 0)
+        {
+            error.assign(errno, std::system_category());
+            return 0;
+        }
+        return static_cast<unsigned>(ret);
+    }
+
+    /** Invokes `f` with each available completion entry and consumes them. */
+    template<typename F>
+    unsigned for_each_cqe(F f)
+    {
+        unsigned head = *cq_head_;
+        const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        for(; head != tail; ++head, ++count)
+        {
+            f(cqes_[head & cq_mask_]);
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        return count;
+    }
+
+private:
+    void* map_ring(size_t length, off_t offset) noexcept
+    {
+        void* ptr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd_, offset);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+
+    int fd_ = -1;
+
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    size_t sq_ring_length_ = 0;
+    size_t cq_ring_length_ = 0;
+    size_t sqes_length_ = 0;
+
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    // Entries in [sqe_head_, sqe_tail_) have been handed out but not submitted.
+    unsigned sqe_head_ = 0;
+    unsigned sqe_tail_ = 0;
+
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+} // namespace detail
+} // namespace mio
+
+#endif // MIO_HAS_IO_URING
+
+#endif // MIO_IO_URING_HEADER
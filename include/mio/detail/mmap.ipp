@@ -66,19 +66,40 @@ inline std::wstring s_2_ws(const std::string& s)
     return ret;
 }
 
+inline DWORD creation_disposition(const creation_policy creation) noexcept
+{
+    switch(creation)
+    {
+    case creation_policy::open_existing: return OPEN_EXISTING;
+    case creation_policy::create_new: return CREATE_NEW;
+    default: return OPEN_ALWAYS;
+    }
+}
+
+inline DWORD flags_and_attributes(const access_pattern pattern) noexcept
+{
+    switch(pattern)
+    {
+    case access_pattern::sequential: return FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN;
+    case access_pattern::random: return FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS;
+    default: return FILE_ATTRIBUTE_NORMAL;
+    }
+}
+
 template<
     typename String,
     typename = typename std::enable_if<
         std::is_same<typename char_type<String>::type, char>::value
     >::type
-> file_handle_type open_file_helper(const String& path, const access_mode mode)
+> file_handle_type open_file_helper(const String& path, const access_mode mode,
+        const open_options& options)
 {
     return ::CreateFileA(c_str(path),
             mode == access_mode::read ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
             FILE_SHARE_READ | FILE_SHARE_WRITE,
             0,
-            OPEN_ALWAYS,
-            FILE_ATTRIBUTE_NORMAL,
+            creation_disposition(options.creation),
+            flags_and_attributes(options.pattern),
             0);
 }
 
@@ -86,14 +107,15 @@ template<typename String>
 typename std::enable_if<
     std::is_same<typename char_type<String>::type, wchar_t>::value,
     file_handle_type
->::type open_file_helper(const String& path, const access_mode mode)
+>::type open_file_helper(const String& path, const access_mode mode,
+        const open_options& options)
 {
     return ::CreateFileW(c_str(path),
             mode == access_mode::read ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
             FILE_SHARE_READ | FILE_SHARE_WRITE,
             0,
-            OPEN_ALWAYS,
-            FILE_ATTRIBUTE_NORMAL,
+            creation_disposition(options.creation),
+            flags_and_attributes(options.pattern),
             0);
 }
 
@@ -137,9 +159,71 @@ inline int64_t query_file_size(file_handle_type handle, std::error_code& error)
 #endif
 }
 
+/** Closes `handle`, which must have been obtained through `open_file`. */
+inline void close_file(file_handle_type handle) noexcept
+{
+#ifdef _WIN32
+    ::CloseHandle(handle);
+#else // POSIX
+    ::close(handle);
+#endif
+}
+
+/**
+ * Sets the size of the file behind `handle` to `size` bytes, allocating them on disk
+ * if `preallocate` is set.
+ */
+inline void resize_file(file_handle_type handle, int64_t size, bool preallocate,
+        std::error_code& error)
+{
+#ifdef _WIN32
+    (void)preallocate;
+    LARGE_INTEGER file_size;
+    file_size.QuadPart = size;
+    if(::SetFilePointerEx(handle, file_size, nullptr, FILE_BEGIN) == 0
+       || ::SetEndOfFile(handle) == 0)
+    {
+        error = detail::last_error();
+    }
+#else // POSIX
+# if !defined(__APPLE__)
+    if(preallocate)
+    {
+        const int ret = ::posix_fallocate(handle, 0, static_cast<off_t>(size));
+        if(ret == 0) { return; }
+        // Not all file systems support it, in which case the file is left sparse.
+        if(ret != EOPNOTSUPP && ret != EINVAL)
+        {
+            error = std::error_code(ret, std::system_category());
+            return;
+        }
+    }
+# else
+    (void)preallocate;
+# endif
+    if(::ftruncate(handle, static_cast<off_t>(size)) == -1) { error = detail::last_error(); }
+#endif
+}
+
+/** Passes `pattern` on to the kernel for the whole file. Errors are ignored. */
+inline void advise_file(file_handle_type handle, const access_pattern pattern) noexcept
+{
+#if defined(POSIX_FADV_SEQUENTIAL)
+    if(pattern != access_pattern::normal)
+    {
+        ::posix_fadvise(handle, 0, 0, pattern == access_pattern::sequential
+            ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_RANDOM);
+    }
+#else
+    // On Windows, the pattern is given when the file is opened.
+    (void)handle;
+    (void)pattern;
+#endif
+}
+
 template<typename String>
 file_handle_type open_file(const String& path, const access_mode mode,
-        std::error_code& error)
+        const open_options& options, std::error_code& error)
 {
     error.clear();
     if(detail::empty(path))
@@ -148,10 +232,27 @@ file_handle_type open_file(const String& path, const access_mode mode,
         return invalid_handle;
     }
 #ifdef _WIN32
-    const auto handle = win::open_file_helper(path, mode);
+    const auto handle = win::open_file_helper(path, mode, options);
 #else // POSIX
-    const auto handle = ::open(c_str(path),
-            mode == access_mode::read ? O_RDONLY : O_CREAT | O_RDWR);
+    int flags = mode == access_mode::read ? O_RDONLY : O_RDWR;
+    if(options.creation == creation_policy::create_new) { flags |= O_CREAT | O_EXCL; }
+    else if(options.creation == creation_policy::open_or_create
+            && mode == access_mode::write)
+    {
+        flags |= O_CREAT;
+    }
+    if(options.close_on_exec) { flags |= O_CLOEXEC; }
+# ifdef O_NOATIME
+    if(options.no_atime) { flags |= O_NOATIME; }
+# endif
+    auto handle = ::open(c_str(path), flags, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+# ifdef O_NOATIME
+    // Only the file's owner may open it with `O_NOATIME`.
+    if(handle == invalid_handle && errno == EPERM && (flags & O_NOATIME))
+    {
+        handle = ::open(c_str(path), flags & ~O_NOATIME, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+    }
+# endif
 #endif
     if(handle == invalid_handle)
     {
@@ -163,28 +264,27 @@ file_handle_type open_file(const String& path, const access_mode mode,
     {
         if (query_file_size(handle, error) == 0 && !error)
         {
-#ifdef _WIN32
-            void* buffer = ::_alloca(page_size());
-            DWORD bytesWritten = 0;
-            if (!buffer ||
-                ::WriteFile(handle, buffer, page_size(), &bytesWritten, NULL) == 0 ||
-                bytesWritten != page_size())
-#else  // POSIX
-            void* buffer = ::alloca(page_size());
-            if (!buffer ||
-                ::write(handle, buffer, page_size()) == -1 ||
-                fchmod(handle, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH) == -1)
-#endif
-            {
-                error = detail::last_error();
-                return invalid_handle;
-            }
+            resize_file(handle, options.initial_size > 0
+                ? options.initial_size : page_size(), options.preallocate, error);
+        }
+        if (error)
+        {
+            close_file(handle);
+            return invalid_handle;
         }
     }
+    advise_file(handle, options.pattern);
 
     return handle;
 }
 
+template<typename String>
+file_handle_type open_file(const String& path, const access_mode mode,
+        std::error_code& error)
+{
+    return open_file(path, mode, open_options(), error);
+}
+
 struct mmap_context
 {
     char* data;
@@ -319,6 +419,30 @@ inline mmap_context memory_remap(
     return ctx;
 }
 
+#ifndef _WIN32
+/** Rounds `length` up to a multiple of the page size. */
+inline size_t make_length_page_aligned(size_t length) noexcept
+{
+    return make_offset_page_aligned(length + page_size() - 1);
+}
+
+/** Reserves `length` bytes of inaccessible address space that commit no memory. */
+inline char* reserve_address_space(size_t length, std::error_code& error)
+{
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+    void* address = ::mmap(nullptr, length, PROT_NONE, flags, -1, 0);
+    if(address == MAP_FAILED)
+    {
+        error = detail::last_error();
+        return nullptr;
+    }
+    return static_cast<char*>(address);
+}
+#endif
+
 } // namespace detail
 
 // -- basic_mmap --
@@ -335,6 +459,9 @@ basic_mmap<AccessMode, ByteT>::basic_mmap(basic_mmap&& other)
     : data_(std::move(other.data_))
     , length_(std::move(other.length_))
     , mapped_length_(std::move(other.mapped_length_))
+    , file_offset_(std::move(other.file_offset_))
+    , reservation_(std::move(other.reservation_))
+    , reserved_length_(std::move(other.reserved_length_))
     , file_handle_(std::move(other.file_handle_))
 #ifdef _WIN32
     , file_mapping_handle_(std::move(other.file_mapping_handle_))
@@ -343,6 +470,9 @@ basic_mmap<AccessMode, ByteT>::basic_mmap(basic_mmap&& other)
 {
     other.data_ = nullptr;
     other.length_ = other.mapped_length_ = 0;
+    other.file_offset_ = 0;
+    other.reservation_ = nullptr;
+    other.reserved_length_ = 0;
     other.file_handle_ = invalid_handle;
 #ifdef _WIN32
     other.file_mapping_handle_ = invalid_handle;
@@ -360,6 +490,9 @@ basic_mmap<AccessMode, ByteT>::operator=(basic_mmap&& other)
         data_ = std::move(other.data_);
         length_ = std::move(other.length_);
         mapped_length_ = std::move(other.mapped_length_);
+        file_offset_ = std::move(other.file_offset_);
+        reservation_ = std::move(other.reservation_);
+        reserved_length_ = std::move(other.reserved_length_);
         file_handle_ = std::move(other.file_handle_);
 #ifdef _WIN32
         file_mapping_handle_ = std::move(other.file_mapping_handle_);
@@ -371,6 +504,9 @@ basic_mmap<AccessMode, ByteT>::operator=(basic_mmap&& other)
         // just moved into this.
         other.data_ = nullptr;
         other.length_ = other.mapped_length_ = 0;
+        other.file_offset_ = 0;
+        other.reservation_ = nullptr;
+        other.reserved_length_ = 0;
         other.file_handle_ = invalid_handle;
 #ifdef _WIN32
         other.file_mapping_handle_ = invalid_handle;
@@ -394,20 +530,30 @@ basic_mmap<AccessMode, ByteT>::mapping_handle() const noexcept
 template<access_mode AccessMode, typename ByteT>
 template<typename String>
 void basic_mmap<AccessMode, ByteT>::map(const String& path, const size_type offset,
-        const size_type length, std::error_code& error)
+        const size_type length, const open_options& options, std::error_code& error)
 {
     error.clear();
     
-    const auto handle = detail::open_file(path, AccessMode, error);
+    const auto handle = detail::open_file(path, AccessMode, options, error);
     if(error)
         return;
     
     map(handle, offset, length, error);
-    // This MUST be after the call to map, as that sets this to true.
-    if(!error)
+    if(error)
     {
-        is_handle_internal_ = true;
+        detail::close_file(handle);
+        return;
+    }
+    // This MUST be after the call to map, as that sets this to false.
+    is_handle_internal_ = true;
+
+#ifdef POSIX_FADV_WILLNEED
+    if(options.readahead > 0)
+    {
+        ::posix_fadvise(handle, static_cast<off_t>(offset),
+            static_cast<off_t>(std::min(options.readahead, length_)), POSIX_FADV_WILLNEED);
     }
+#endif
 }
 
 template<access_mode AccessMode, typename ByteT>
@@ -449,6 +595,7 @@ void basic_mmap<AccessMode, ByteT>::map(const handle_type handle,
         data_ = reinterpret_cast<pointer>(ctx.data);
         length_ = ctx.length;
         mapped_length_ = ctx.mapped_length;
+        file_offset_ = offset;
 #ifdef _WIN32
         file_mapping_handle_ = ctx.file_mapping_handle;
 #endif
@@ -493,39 +640,46 @@ template<access_mode A>
 typename std::enable_if<A == access_mode::write, void>::type
 basic_mmap<AccessMode, ByteT>::truncate(size_type file_size, std::error_code &error)
 {
-    if constexpr (AccessMode == access_mode::write)
+    error.clear();
+    if (!is_open())
     {
-        error.clear();
-        if (!is_open())
-        {
-            error = std::make_error_code(std::errc::bad_file_descriptor);
-            return;
-        }
+        error = std::make_error_code(std::errc::bad_file_descriptor);
+        return;
+    }
 
-        if (data())
-        {
 #ifdef _WIN32
-            if (is_mapped())
-            {
-                ::UnmapViewOfFile(get_mapping_start());
-                ::CloseHandle(file_mapping_handle_);
-                file_mapping_handle_ = invalid_handle;
-            }
-            LARGE_INTEGER file_offset, file_pointer;
-            file_offset.QuadPart = file_size;
-            if (SetFilePointerEx(file_handle_, file_offset, &file_pointer, FILE_BEGIN) == 0 ||
-                file_pointer.LowPart == INVALID_SET_FILE_POINTER ||
-                SetEndOfFile(file_handle_) == 0)
+    // The file cannot be resized while a view of it exists.
+    if (is_mapped())
+    {
+        ::UnmapViewOfFile(get_mapping_start());
+        ::CloseHandle(file_mapping_handle_);
+        file_mapping_handle_ = invalid_handle;
+    }
+    LARGE_INTEGER file_offset, file_pointer;
+    file_offset.QuadPart = file_size;
+    if (SetFilePointerEx(file_handle_, file_offset, &file_pointer, FILE_BEGIN) == 0 ||
+        file_pointer.LowPart == INVALID_SET_FILE_POINTER ||
+        SetEndOfFile(file_handle_) == 0)
 #else // POSIX
-            if (ftruncate(file_handle_, file_size) == -1)
+    if (ftruncate(file_handle_, file_size) == -1)
 #endif
-            {
-                error = detail::last_error();
-            }
-            
-            remap(file_size, error);
-        }
+    {
+        error = detail::last_error();
+        return;
     }
+
+    if (file_size > file_offset_ || reservation_)
+    {
+        remap(file_offset_, file_size > file_offset_ ? file_size - file_offset_ : 0, error);
+        return;
+    }
+
+    // Nothing is left to map past `file_offset_`, so only release the view.
+#ifndef _WIN32
+    if (data_) { ::munmap(get_mapping_start(), mapped_length_); }
+#endif
+    data_ = nullptr;
+    length_ = mapped_length_ = 0;
 }
 
 template<access_mode AccessMode, typename ByteT>
@@ -540,7 +694,8 @@ void basic_mmap<AccessMode, ByteT>::unmap()
         ::CloseHandle(file_mapping_handle_);
     }
 #else // POSIX
-    if(data_) { ::munmap(const_cast<pointer>(get_mapping_start()), mapped_length_); }
+    if(reservation_) { ::munmap(reservation_, reserved_length_); }
+    else if(data_) { ::munmap(const_cast<pointer>(get_mapping_start()), mapped_length_); }
 #endif
 
     // If `file_handle_` was obtained by our opening it (when map is called with
@@ -549,16 +704,15 @@ void basic_mmap<AccessMode, ByteT>::unmap()
     // instance.
     if(is_handle_internal_)
     {
-#ifdef _WIN32
-        ::CloseHandle(file_handle_);
-#else // POSIX
-        ::close(file_handle_);
-#endif
+        detail::close_file(file_handle_);
     }
 
     // Reset fields to their default values.
     data_ = nullptr;
     length_ = mapped_length_ = 0;
+    file_offset_ = 0;
+    reservation_ = nullptr;
+    reserved_length_ = 0;
     file_handle_ = invalid_handle;
 #ifdef _WIN32
     file_mapping_handle_ = invalid_handle;
@@ -573,6 +727,23 @@ basic_mmap<AccessMode, ByteT>::remap(const size_type new_offset, size_type new_l
     error.clear();
     if(!is_open()) { return; }
 
+#ifndef _WIN32
+    if(reservation_)
+    {
+        if(new_offset == file_offset_)
+        {
+            remap_in_place(new_length, error);
+            return;
+        }
+        // A different offset doesn't fit the reserved range, so give it up.
+        ::munmap(reservation_, reserved_length_);
+        reservation_ = nullptr;
+        reserved_length_ = 0;
+        data_ = nullptr;
+        length_ = mapped_length_ = 0;
+    }
+#endif
+
     // todo: remove?
 #ifdef _WIN32
     if(is_mapped())
@@ -592,12 +763,217 @@ basic_mmap<AccessMode, ByteT>::remap(const size_type new_offset, size_type new_l
         data_ = reinterpret_cast<pointer>(ctx.data);
         length_ = ctx.length;
         mapped_length_ = ctx.mapped_length;
+        file_offset_ = new_offset;
 #ifdef _WIN32
         file_mapping_handle_ = ctx.file_mapping_handle;
 #endif
     }
 }
 
+template<access_mode AccessMode, typename ByteT>
+void basic_mmap<AccessMode, ByteT>::reserve(const size_type capacity, std::error_code& error)
+{
+    error.clear();
+    if(!is_open())
+    {
+        error = std::make_error_code(std::errc::bad_file_descriptor);
+        return;
+    }
+#ifdef _WIN32
+    (void)capacity;
+    error = std::make_error_code(std::errc::not_supported);
+#else // POSIX
+    const size_type aligned_offset = make_offset_page_aligned(file_offset_);
+    const size_type head = file_offset_ - aligned_offset;
+    const size_type mapped_pages = data_ ? detail::make_length_page_aligned(mapped_length_) : 0;
+    const size_type length = std::max(
+        detail::make_length_page_aligned(head + capacity), mapped_pages);
+    if(length <= reserved_length_) { return; }
+
+    const int protection = AccessMode == access_mode::read ? PROT_READ : PROT_WRITE;
+    char* reservation = detail::reserve_address_space(length, error);
+    if(error) { return; }
+    // Map the same pages again at the start of the new range before releasing the
+    // old one, so that a failure leaves the mapping as it was.
+    if(mapped_pages > 0 && ::mmap(reservation, mapped_pages, protection,
+            MAP_SHARED | MAP_FIXED, file_handle_, aligned_offset) == MAP_FAILED)
+    {
+        error = detail::last_error();
+        ::munmap(reservation, length);
+        return;
+    }
+    if(reservation_) { ::munmap(reservation_, reserved_length_); }
+    else if(data_) { ::munmap(const_cast<pointer>(get_mapping_start()), mapped_length_); }
+
+    reservation_ = reinterpret_cast<pointer>(reservation);
+    reserved_length_ = length;
+    if(data_) { data_ = reservation_ + head; }
+#endif
+}
+
+template<access_mode AccessMode, typename ByteT>
+void basic_mmap<AccessMode, ByteT>::remap_in_place(
+        const size_type new_length, std::error_code& error)
+{
+#ifdef _WIN32
+    (void)new_length;
+    error = std::make_error_code(std::errc::not_supported);
+#else // POSIX
+    const size_type aligned_offset = make_offset_page_aligned(file_offset_);
+    const size_type head = file_offset_ - aligned_offset;
+    const size_type new_mapped_length = new_length > 0 ? head + new_length : 0;
+    const size_type new_pages = detail::make_length_page_aligned(new_mapped_length);
+    // Moving the mapping would leave the caller's pointers into it dangling.
+    if(new_pages > reserved_length_)
+    {
+        error = std::make_error_code(std::errc::not_enough_memory);
+        return;
+    }
+
+    // Grow the file as `detail::memory_remap` does. Read-only mappings may only be
+    // extended to the file's size, as pages past it can't be accessed.
+    const auto file_size = detail::query_file_size(file_handle_, error);
+    if(error) { return; }
+    if(int64_t(file_offset_ + new_length) > file_size)
+    {
+        if(AccessMode == access_mode::read)
+        {
+            error = std::make_error_code(std::errc::invalid_argument);
+            return;
+        }
+        if(::ftruncate(file_handle_, file_offset_ + new_length) == -1)
+        {
+            error = detail::last_error();
+            return;
+        }
+    }
+
+    const size_type old_pages = data_ ? detail::make_length_page_aligned(mapped_length_) : 0;
+    if(new_pages > old_pages)
+    {
+        const int protection = AccessMode == access_mode::read ? PROT_READ : PROT_WRITE;
+        if(::mmap(reservation_ + old_pages, new_pages - old_pages, protection,
+                MAP_SHARED | MAP_FIXED, file_handle_, aligned_offset + old_pages) == MAP_FAILED)
+        {
+            error = detail::last_error();
+            return;
+        }
+    }
+    else if(new_pages < old_pages)
+    {
+        // Return the pages cut off to the reservation.
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED;
+#ifdef MAP_NORESERVE
+        flags |= MAP_NORESERVE;
+#endif
+        if(::mmap(reservation_ + new_pages, old_pages - new_pages, PROT_NONE,
+                flags, -1, 0) == MAP_FAILED)
+        {
+            error = detail::last_error();
+            return;
+        }
+    }
+
+    data_ = new_mapped_length > 0 ? reservation_ + head : nullptr;
+    length_ = new_length;
+    mapped_length_ = new_mapped_length;
+#endif
+}
+
+template<access_mode AccessMode, typename ByteT>
+void basic_mmap<AccessMode, ByteT>::extend_to_file(std::error_code& error)
+{
+    error.clear();
+    if(!is_open())
+    {
+        error = std::make_error_code(std::errc::bad_file_descriptor);
+        return;
+    }
+    const auto file_size = detail::query_file_size(file_handle_, error);
+    if(error || file_size <= int64_t(file_offset_ + length_)) { return; }
+    const size_type new_length = static_cast<size_type>(file_size) - file_offset_;
+
+#ifndef _WIN32
+    if(reservation_)
+    {
+        remap_in_place(new_length, error);
+        return;
+    }
+#endif
+
+    // Map the new range before releasing the old one, so that a failure leaves the
+    // mapping as it was.
+    const auto ctx = detail::memory_map(file_handle_, file_offset_, new_length,
+        AccessMode, error);
+    if(error) { return; }
+#ifdef _WIN32
+    if(is_mapped())
+    {
+        ::UnmapViewOfFile(get_mapping_start());
+        ::CloseHandle(file_mapping_handle_);
+    }
+    file_mapping_handle_ = ctx.file_mapping_handle;
+#else // POSIX
+    if(data_) { ::munmap(const_cast<pointer>(get_mapping_start()), mapped_length_); }
+#endif
+    data_ = reinterpret_cast<pointer>(ctx.data);
+    length_ = ctx.length;
+    mapped_length_ = ctx.mapped_length;
+}
+
+template<access_mode AccessMode, typename ByteT>
+std::vector<data_extent> basic_mmap<AccessMode, ByteT>::data_extents(
+        std::error_code& error) const
+{
+    error.clear();
+    std::vector<data_extent> extents;
+    if(!is_open())
+    {
+        error = std::make_error_code(std::errc::bad_file_descriptor);
+        return extents;
+    }
+    if(length_ == 0) { return extents; }
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    // The handle's offset may be in use by the caller, so put it back afterwards.
+    const off_t saved_position = ::lseek(file_handle_, 0, SEEK_CUR);
+    const off_t begin = static_cast<off_t>(file_offset_);
+    const off_t end = static_cast<off_t>(file_offset_ + length_);
+    for(off_t position = begin; position < end;)
+    {
+        const off_t data = ::lseek(file_handle_, position, SEEK_DATA);
+        if(data == -1)
+        {
+            // There is no data past `position`.
+            if(errno == ENXIO) { break; }
+            // The file system can't tell; treat everything as data.
+            if(errno == EINVAL && position == begin)
+            {
+                extents.push_back(data_extent{ 0, length_ });
+                break;
+            }
+            error = detail::last_error();
+            break;
+        }
+        if(data >= end) { break; }
+        off_t hole = ::lseek(file_handle_, data, SEEK_HOLE);
+        if(hole == -1)
+        {
+            error = detail::last_error();
+            break;
+        }
+        hole = std::min(hole, end);
+        extents.push_back(data_extent{ static_cast<size_type>(data - begin),
+            static_cast<size_type>(hole - data) });
+        position = hole;
+    }
+    if(saved_position != -1) { ::lseek(file_handle_, saved_position, SEEK_SET); }
+    if(error) { extents.clear(); }
+#else
+    extents.push_back(data_extent{ 0, length_ });
+#endif
+    return extents;
+}
+
 template<access_mode AccessMode, typename ByteT>
 bool basic_mmap<AccessMode, ByteT>::is_mapped() const noexcept
 {
@@ -621,6 +997,9 @@ void basic_mmap<AccessMode, ByteT>::swap(basic_mmap& other)
 #endif
         swap(length_, other.length_);
         swap(mapped_length_, other.mapped_length_);
+        swap(file_offset_, other.file_offset_);
+        swap(reservation_, other.reservation_);
+        swap(reserved_length_, other.reserved_length_);
         swap(is_handle_internal_, other.is_handle_internal_);
     }
 }
@@ -0,0 +1,49 @@
+#ifndef MIO_SYNC_HEADER
+#define MIO_SYNC_HEADER
+
+#include "mio/mmap.hpp"
+#include "mio/page.hpp"
+
+#include <algorithm>
+#include <system_error>
+
+namespace mio {
+namespace detail {
+
+/**
+ * Flushes the dirty pages overlapping `[offset, offset + length)` of a mapping that
+ * starts, page aligned, at `mapping_start` and spans `mapped_length` bytes. The range
+ * is widened to page boundaries and clamped to the mapping.
+ *
+ * If `wait` is true this returns once the data has reached the disk. Otherwise the
+ * writeback is only scheduled (`MS_ASYNC`), which on Windows still waits for the view
+ * to be written to the file but not for the file's buffers to be flushed.
+ */
+inline void sync_range(const void* mapping_start, size_t mapped_length,
+        size_t offset, size_t length, file_handle_type handle, bool wait,
+        std::error_code& error)
+{
+    error.clear();
+    if(offset >= mapped_length || length == 0) { return; }
+    const size_t begin = make_offset_page_aligned(offset);
+    const size_t end = std::min(offset + std::min(length, mapped_length - offset), mapped_length);
+    char* address = const_cast<char*>(static_cast<const char*>(mapping_start)) + begin;
+#ifdef _WIN32
+    if(::FlushViewOfFile(address, end - begin) == 0
+       || (wait && ::FlushFileBuffers(handle) == 0))
+    {
+        error = last_error();
+    }
+#else
+    (void)handle;
+    if(::msync(address, end - begin, wait ? MS_SYNC : MS_ASYNC) != 0)
+    {
+        error = last_error();
+    }
+#endif
+}
+
+} // namespace detail
+} // namespace mio
+
+#endif // MIO_SYNC_HEADER
@@ -0,0 +1,306 @@
+#ifndef MIO_DIRECT_READER_HEADER
+#define MIO_DIRECT_READER_HEADER
+
+#include "mio/mmap.hpp"
+#include "mio/page.hpp"
+#include "mio/span.hpp"
+#include "mio/buffer_pool.hpp"
+#include "mio/chunk_reader.hpp"
+#include "mio/thread_pool.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <system_error>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+namespace mio {
+
+struct direct_reader_options
+{
+    // Size of each read, rounded up to the page size. It's also the size of the
+    // chunks yielded, apart from the last one.
+    size_t chunk_size = 1 << 20;
+
+    // Number of chunks being read or consumed at any time: 2 gives double buffering,
+    // 3 triple buffering and so on.
+    unsigned depth = 3;
+
+    // Whether to fall back to buffered reads if the file system doesn't support
+    // `O_DIRECT`. Consumed ranges are then evicted from the page cache.
+    bool allow_buffered = true;
+
+    // The pool to take buffers from. It may be shared by several readers, in which
+    // case its buffer size must be at least `chunk_size`. A private pool is created
+    // if this is empty.
+    std::shared_ptr<buffer_pool> pool;
+};
+
+/**
+ * Reads a file front to back bypassing the page cache with `O_DIRECT`, for one-pass
+ * scans over files that would otherwise evict more valuable data from the cache.
+ *
+ * While a chunk is being consumed the following `depth - 1` chunks are read into
+ * aligned buffers from a `buffer_pool` on a `thread_pool`, the shared one unless
+ * another is given to `open`. A chunk returned by `next` remains valid until the
+ * following call to `next` or `close`. `next` and `close` wait for reads on the
+ * pool, so they must not be called from one of its workers.
+ *
+ * The interface matches that of `mmap_chunk_reader`, so callers can decide per file
+ * whether to map or to read it. This is only supported on POSIX systems.
+ */
+class direct_reader
+{
+public:
+    using value_type = char;
+    using size_type = size_t;
+    using span_type = span<const char>;
+    using iterator = chunk_iterator<direct_reader>;
+    using handle_type = file_handle_type;
+
+    direct_reader() = default;
+    direct_reader(const direct_reader&) = delete;
+    direct_reader& operator=(const direct_reader&) = delete;
+
+#ifdef __cpp_exceptions
+    /**
+     * The same as invoking the `open` function, except any error that may occur
+     * while opening the file is wrapped in a `std::system_error` and is thrown.
+     */
+    template<typename String>
+    explicit direct_reader(const String& path,
+            direct_reader_options options = direct_reader_options(),
+            thread_pool& workers = default_thread_pool())
+    {
+        std::error_code error;
+        open(path, std::move(options), error, workers);
+        if(error) { throw std::system_error(error); }
+    }
+#endif // __cpp_exceptions
+
+    ~direct_reader() { close(); }
+
+    /**
+     * Opens the file at `path` and starts reading its first chunks on `workers`.
+     * Upon failure, `error` is set to indicate the reason and the reader remains
+     * closed.
+     */
+    template<typename String>
+    void open(const String& path, direct_reader_options options, std::error_code& error,
+            thread_pool& workers = default_thread_pool())
+    {
+        error.clear();
+        close();
+        if(detail::empty(path))
+        {
+            error = std::make_error_code(std::errc::invalid_argument);
+            return;
+        }
+#ifdef _WIN32
+        (void)options;
+        (void)workers;
+        error = std::make_error_code(std::errc::not_supported);
+#else
+        const int flags = O_RDONLY | O_CLOEXEC;
+        int fd = -1;
+#ifdef O_DIRECT
+        fd = ::open(detail::c_str(path), flags | O_DIRECT);
+        is_direct_ = fd != -1;
+        if(fd == -1 && errno != EINVAL) { error = detail::last_error(); return; }
+#endif
+        if(fd == -1)
+        {
+            if(!options.allow_buffered)
+            {
+                error = std::make_error_code(std::errc::not_supported);
+                return;
+            }
+            fd = ::open(detail::c_str(path), flags);
+            if(fd == -1) { error = detail::last_error(); return; }
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+
+        const auto file_size = detail::query_file_size(fd, error);
+        if(error) { ::close(fd); return; }
+
+        chunk_size_ = std::max(
+            make_offset_page_aligned(options.chunk_size + page_size() - 1), page_size());
+        pool_ = std::move(options.pool);
+        if(!pool_) { pool_ = std::make_shared<buffer_pool>(chunk_size_); }
+        if(pool_->buffer_size() < chunk_size_ || pool_->alignment() % page_size() != 0)
+        {
+            ::close(fd);
+            pool_.reset();
+            error = std::make_error_code(std::errc::invalid_argument);
+            return;
+        }
+
+        file_handle_ = fd;
+        workers_ = &workers;
+        size_ = static_cast<size_type>(file_size);
+        position_ = next_offset_ = 0;
+        const unsigned depth = std::max(options.depth, 2u);
+        for(unsigned i = 0; i < depth && next_offset_ < size_; ++i)
+        {
+            issue(pool_->acquire());
+        }
+#endif
+    }
+
+    /** Waits for reads in flight, returns all buffers to the pool and closes the file. */
+    void close()
+    {
+        for(auto& slot : slots_) { slot.result.wait(); }
+        slots_.clear();
+        current_ = slot();
+#ifndef _WIN32
+        if(file_handle_ != invalid_handle) { ::close(file_handle_); }
+#endif
+        file_handle_ = invalid_handle;
+        workers_ = nullptr;
+        pool_.reset();
+        size_ = position_ = next_offset_ = 0;
+        is_direct_ = false;
+        error_.clear();
+    }
+
+    bool is_open() const noexcept { return file_handle_ != invalid_handle; }
+
+    /** Returns whether the file is read with `O_DIRECT`, as opposed to the fallback. */
+    bool is_direct() const noexcept { return is_direct_; }
+
+    handle_type file_handle() const noexcept { return file_handle_; }
+
+    /**
+     * Sets `chunk` to the next chunk and returns true, or returns false at the end of
+     * the file or if reading failed, in which case `error` is set. The previously
+     * returned chunk is invalidated.
+     */
+    bool next(span_type& chunk, std::error_code& error)
+    {
+        error.clear();
+        if(!is_open())
+        {
+            error = std::make_error_code(std::errc::bad_file_descriptor);
+            return false;
+        }
+        if(error_) { error = error_; return false; }
+
+        // The previous chunk has been consumed, so its buffer can be refilled.
+        if(current_.buffer)
+        {
+#ifndef _WIN32
+            if(!is_direct_)
+            {
+                ::posix_fadvise(file_handle_, current_.offset, chunk_size_, POSIX_FADV_DONTNEED);
+            }
+#endif
+            if(next_offset_ < size_) { issue(std::move(current_.buffer)); }
+            current_ = slot();
+        }
+
+        if(slots_.empty()) { return false; }
+
+        current_ = std::move(slots_.front());
+        slots_.pop_front();
+        const auto result = current_.result.get();
+        if(result.second)
+        {
+            error_ = error = result.second;
+            return false;
+        }
+        if(result.first == 0) { return false; }
+
+        chunk = span_type(current_.buffer.data(), result.first);
+        position_ += result.first;
+        return true;
+    }
+
+    iterator begin() { return iterator(*this); }
+    iterator end() { return iterator(); }
+
+    /** Returns the size of the file. */
+    size_type size() const noexcept { return size_; }
+
+    /** Returns the number of bytes yielded so far. */
+    size_type position() const noexcept { return position_; }
+
+    size_type chunk_size() const noexcept { return chunk_size_; }
+
+    /** Returns the error that stopped reading, if any. */
+    std::error_code error() const noexcept { return error_; }
+
+private:
+    using read_result = std::pair<size_type, std::error_code>;
+
+    struct slot
+    {
+        buffer_pool::buffer buffer;
+        int64_t offset = 0;
+        std::shared_future<read_result> result;
+    };
+
+    void issue(buffer_pool::buffer buffer)
+    {
+        slot s;
+        s.offset = static_cast<int64_t>(next_offset_);
+        next_offset_ += chunk_size_;
+
+        auto promise = std::make_shared<std::promise<read_result>>();
+        s.result = promise->get_future().share();
+        const handle_type fd = file_handle_;
+        char* data = buffer.data();
+        const size_type length = chunk_size_;
+        const int64_t offset = s.offset;
+        s.buffer = std::move(buffer);
+        slots_.push_back(std::move(s));
+
+        workers_->post([promise, fd, data, length, offset]
+        {
+            read_result result(0, std::error_code());
+#ifndef _WIN32
+            while(result.first < length)
+            {
+                const ssize_t n = ::pread(fd, data + result.first,
+                    length - result.first, offset + result.first);
+                if(n < 0)
+                {
+                    if(errno == EINTR) { continue; }
+                    result.second = detail::last_error();
+                    break;
+                }
+                if(n == 0) { break; }
+                result.first += static_cast<size_type>(n);
+                // A short read with O_DIRECT means the end of file was reached, and
+                // the next read would not be aligned.
+                if(result.first % page_size() != 0) { break; }
+            }
+#endif
+            promise->set_value(result);
+        });
+    }
+
+    handle_type file_handle_ = invalid_handle;
+    thread_pool* workers_ = nullptr;
+    std::shared_ptr<buffer_pool> pool_;
+    // Reads in flight or completed but not yet consumed, in file order.
+    std::deque<slot> slots_;
+    // The slot of the chunk last returned by `next`.
+    slot current_;
+    size_type size_ = 0;
+    size_type chunk_size_ = 0;
+    size_type position_ = 0;
+    size_type next_offset_ = 0;
+    bool is_direct_ = false;
+    std::error_code error_;
+};
+
+} // namespace mio
+
+#endif // MIO_DIRECT_READER_HEADER
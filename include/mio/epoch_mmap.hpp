@@ -0,0 +1,351 @@
+#ifndef MIO_EPOCH_MMAP_HEADER
+#define MIO_EPOCH_MMAP_HEADER
+
+#include "mio/mmap.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#ifndef _WIN32
+# include <unistd.h>
+#endif
+
+namespace mio {
+namespace detail {
+
+// A reader count on a cache line of its own, also when in an array.
+struct alignas(64) epoch_counter
+{
+    std::atomic<int64_t> readers{0};
+};
+
+/** Returns the calling thread's shard, so that threads mostly use distinct counters. */
+inline size_t epoch_shard() noexcept
+{
+    static thread_local const size_t shard = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return shard;
+}
+
+/**
+ * Tracks readers of a pointer that a writer replaces, so that the writer knows when
+ * the previous target is no longer read, in the manner of sleepable RCU.
+ *
+ * A reader brackets its loads of the pointer with `enter` and `leave`, which cost
+ * an atomic increment and decrement of a reader count. The counts are sharded by
+ * thread to keep readers off each other's cache lines, and split in two by epoch
+ * parity, so that new readers can't keep `synchronize` waiting indefinitely.
+ */
+class epoch_domain
+{
+public:
+    /** Counts the calling thread as a reader, until `leave` with the returned counter. */
+    epoch_counter* enter() const noexcept
+    {
+        epoch_counter& counter = counters_[epoch_.load() & 1][epoch_shard() % num_shards];
+        counter.readers.fetch_add(1);
+        return &counter;
+    }
+
+    static void leave(epoch_counter* counter) noexcept { counter->readers.fetch_sub(1); }
+
+    /**
+     * Waits for every reader that entered before the call to leave. Once the pointer
+     * is replaced, no reader can then still hold the previous target.
+     */
+    void synchronize() const
+    {
+        // A reader may have read the epoch before the flip and only then count itself
+        // against it, after it was found drained. Such a reader holds the new
+        // target, but the next call would only wait for the other parity, so wait
+        // for both, one after the other.
+        for(int i = 0; i < 2; ++i)
+        {
+            const unsigned parity = epoch_.fetch_add(1) & 1;
+            wait_for_readers(parity);
+        }
+    }
+
+private:
+    static constexpr size_t num_shards = 64;
+
+    void wait_for_readers(unsigned parity) const
+    {
+        for(unsigned spins = 0;; ++spins)
+        {
+            int64_t readers = 0;
+            for(const auto& counter : counters_[parity]) { readers += counter.readers.load(); }
+            if(readers == 0) { return; }
+            if(spins < 64) { std::this_thread::yield(); }
+            else { std::this_thread::sleep_for(std::chrono::microseconds(50)); }
+        }
+    }
+
+    mutable std::atomic<unsigned> epoch_{0};
+    mutable epoch_counter counters_[2][num_shards];
+};
+
+} // namespace detail
+
+/**
+ * A mapping that one thread may remap while others keep reading it.
+ *
+ * `basic_shared_mmap::remap` changes the mapping under the feet of any other thread
+ * using it. Here, a reader instead pins the current mapping with `pin`, and the
+ * returned guard's data remain valid for as long as it lives. `remap` maps the new
+ * region alongside the old one and publishes it, so that readers pinning from then
+ * on get the new one. It then waits for the readers still holding the old mapping
+ * to release it before unmapping it.
+ *
+ * Pinning costs an atomic increment of a reader count, and releasing a decrement;
+ * see `detail::epoch_domain`. New readers can't keep a remap waiting indefinitely.
+ *
+ * The file is opened once by `map` and kept open until `unmap`. Writable mappings
+ * are extended with the file when remapped past its end, which is only supported on
+ * POSIX systems. Guards must not outlive the object.
+ */
+template<access_mode AccessMode, typename ByteT>
+class basic_epoch_mmap
+{
+public:
+    using mmap_type = basic_mmap<AccessMode, ByteT>;
+    using value_type = typename mmap_type::value_type;
+    using size_type = typename mmap_type::size_type;
+    using pointer = typename mmap_type::pointer;
+    using const_pointer = typename mmap_type::const_pointer;
+    using handle_type = typename mmap_type::handle_type;
+
+    /** Keeps a generation of the mapping alive while it's being read. */
+    class guard
+    {
+    public:
+        using iterator = typename std::conditional<AccessMode == access_mode::write,
+            pointer, const_pointer>::type;
+
+        guard() = default;
+        guard(const guard&) = delete;
+        guard& operator=(const guard&) = delete;
+
+        guard(guard&& other) noexcept
+            : counter_(other.counter_)
+            , mmap_(other.mmap_)
+        {
+            other.counter_ = nullptr;
+            other.mmap_ = nullptr;
+        }
+
+        guard& operator=(guard&& other) noexcept
+        {
+            if(this != &other)
+            {
+                release();
+                counter_ = other.counter_;
+                mmap_ = other.mmap_;
+                other.counter_ = nullptr;
+                other.mmap_ = nullptr;
+            }
+            return *this;
+        }
+
+        ~guard() { release(); }
+
+        /** Unpins the generation before the guard is destroyed. */
+        void release() noexcept
+        {
+            if(counter_) { detail::epoch_domain::leave(counter_); }
+            counter_ = nullptr;
+            mmap_ = nullptr;
+        }
+
+        /** Returns the pinned mapping, or null if nothing was mapped. */
+        mmap_type* mmap() const noexcept { return mmap_; }
+
+        iterator data() const noexcept { return mmap_ ? mmap_->data() : nullptr; }
+        size_type size() const noexcept { return mmap_ ? mmap_->size() : 0; }
+        bool empty() const noexcept { return size() == 0; }
+        iterator begin() const noexcept { return data(); }
+        iterator end() const noexcept { return data() + size(); }
+        typename std::iterator_traits<iterator>::reference operator[](size_type i) const noexcept
+        {
+            return data()[i];
+        }
+
+    private:
+        friend class basic_epoch_mmap;
+
+        guard(detail::epoch_counter* counter, mmap_type* mmap) noexcept
+            : counter_(counter)
+            , mmap_(mmap)
+        {}
+
+        detail::epoch_counter* counter_ = nullptr;
+        mmap_type* mmap_ = nullptr;
+    };
+
+    basic_epoch_mmap() = default;
+    basic_epoch_mmap(const basic_epoch_mmap&) = delete;
+    basic_epoch_mmap& operator=(const basic_epoch_mmap&) = delete;
+
+#ifdef __cpp_exceptions
+    /**
+     * The same as invoking the `map` function, except any error that may occur while
+     * establishing the mapping is wrapped in a `std::system_error` and is thrown.
+     */
+    template<typename String>
+    basic_epoch_mmap(const String& path, const size_type offset = 0,
+            const size_type length = map_entire_file)
+    {
+        std::error_code error;
+        map(path, offset, length, error);
+        if(error) { throw std::system_error(error); }
+    }
+#endif // __cpp_exceptions
+
+    /** Unmaps and closes the file. No reader may still hold a guard. */
+    ~basic_epoch_mmap() { unmap(); }
+
+    /**
+     * Opens the file at `path` and maps `length` bytes from `offset`, replacing any
+     * previous mapping. Upon failure, `error` is set and nothing changes.
+     */
+    template<typename String>
+    void map(const String& path, const size_type offset, const size_type length,
+            std::error_code& error)
+    {
+        error.clear();
+        if(detail::empty(path))
+        {
+            error = std::make_error_code(std::errc::invalid_argument);
+            return;
+        }
+        const auto handle = detail::open_file(path, AccessMode, error);
+        if(error) { return; }
+        mmap_type* mmap = new mmap_type();
+        mmap->map(handle, offset, length, error);
+        if(error)
+        {
+            delete mmap;
+            detail::close_file(handle);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        const handle_type old_handle = file_handle_;
+        file_handle_ = handle;
+        publish(mmap);
+        if(old_handle != invalid_handle) { detail::close_file(old_handle); }
+    }
+
+    template<typename String>
+    void map(const String& path, std::error_code& error)
+    {
+        map(path, 0, map_entire_file, error);
+    }
+
+    /** Unmaps the file once readers have released it, then closes it. */
+    void unmap()
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        if(file_handle_ == invalid_handle) { return; }
+        publish(nullptr);
+        detail::close_file(file_handle_);
+        file_handle_ = invalid_handle;
+    }
+
+    bool is_open() const noexcept { return file_handle_ != invalid_handle; }
+    handle_type file_handle() const noexcept { return file_handle_; }
+
+    /**
+     * Maps `length` bytes from `offset` of the same file as a new generation, then
+     * waits for the readers of the previous one to release it and unmaps it. Upon
+     * failure, `error` is set and the current mapping remains.
+     */
+    void remap(const size_type offset, const size_type length, std::error_code& error)
+    {
+        error.clear();
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        if(file_handle_ == invalid_handle)
+        {
+            error = std::make_error_code(std::errc::bad_file_descriptor);
+            return;
+        }
+        if(AccessMode == access_mode::write && length != map_entire_file)
+        {
+            extend_file(offset + length, error);
+            if(error) { return; }
+        }
+        mmap_type* mmap = new mmap_type();
+        mmap->map(file_handle_, offset, length, error);
+        if(error)
+        {
+            delete mmap;
+            return;
+        }
+        publish(mmap);
+    }
+
+    /** Pins the current generation of the mapping until the guard is released. */
+    guard pin() const noexcept
+    {
+        detail::epoch_counter* counter = readers_.enter();
+        return guard(counter, current_.load());
+    }
+
+    /** Returns the number of generations published, including unmapping. */
+    uint64_t generation() const noexcept { return generation_.load(); }
+
+private:
+    /**
+     * Makes `mmap` the current generation, then waits for the previous one's readers
+     * and destroys it. Must be called with `writer_mutex_` held.
+     */
+    void publish(mmap_type* mmap)
+    {
+        mmap_type* old = current_.exchange(mmap);
+        generation_.fetch_add(1);
+        if(!old) { return; }
+        readers_.synchronize();
+
+        // The data are shared with the new generation, so skip the sync that
+        // destroying a writable mapping would do.
+        old->unmap();
+        delete old;
+    }
+
+    void extend_file(const size_type size, std::error_code& error)
+    {
+        const auto file_size = detail::query_file_size(file_handle_, error);
+        if(error || static_cast<int64_t>(size) <= file_size) { return; }
+#ifdef _WIN32
+        error = std::make_error_code(std::errc::not_supported);
+#else
+        if(::ftruncate(file_handle_, size) == -1) { error = detail::last_error(); }
+#endif
+    }
+
+    std::atomic<mmap_type*> current_{nullptr};
+    std::atomic<uint64_t> generation_{0};
+    detail::epoch_domain readers_;
+    std::mutex writer_mutex_;
+    handle_type file_handle_ = invalid_handle;
+};
+
+template<typename ByteT>
+using basic_epoch_mmap_source = basic_epoch_mmap<access_mode::read, ByteT>;
+
+template<typename ByteT>
+using basic_epoch_mmap_sink = basic_epoch_mmap<access_mode::write, ByteT>;
+
+using epoch_mmap_source = basic_epoch_mmap_source<char>;
+using epoch_ummap_source = basic_epoch_mmap_source<unsigned char>;
+
+using epoch_mmap_sink = basic_epoch_mmap_sink<char>;
+using epoch_ummap_sink = basic_epoch_mmap_sink<unsigned char>;
+
+} // namespace mio
+
+#endif // MIO_EPOCH_MMAP_HEADER
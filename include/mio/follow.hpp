@@ -0,0 +1,234 @@
+#ifndef MIO_FOLLOW_HEADER
+#define MIO_FOLLOW_HEADER
+
+#include "mio/mmap.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <system_error>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <poll.h>
+# include <unistd.h>
+# ifdef __linux__
+#  include <sys/inotify.h>
+# endif
+#endif
+
+namespace mio {
+
+struct follow_options
+{
+    // How often the file's size is checked while waiting for it to grow. Changes are
+    // noticed sooner on Linux, where inotify reports writes to local files; there,
+    // this only matters for files written over a network file system.
+    std::chrono::milliseconds poll_interval = std::chrono::milliseconds(100);
+
+    // How long to wait for the file to grow before giving up. 0 waits until `stop`.
+    std::chrono::milliseconds timeout = std::chrono::milliseconds(0);
+
+    // Address space reserved beyond the end of the file when following a mapping, so
+    // that it grows in place. See `basic_mmap::reserve`.
+    size_t capacity = 64 << 20;
+};
+
+/**
+ * Waits for a file that another process appends to to grow.
+ *
+ * `wait` returns as soon as the file is larger than the size the caller has seen.
+ * On Linux, the file is watched with inotify, so a waiting reader wakes up when the
+ * writer writes; elsewhere, and in addition, its size is polled every
+ * `poll_interval`. `stop` wakes up any waiting thread and makes further waits
+ * return immediately.
+ *
+ * The file handle must remain open while the follower is in use. This is only
+ * supported on POSIX systems.
+ */
+class file_follower
+{
+public:
+    using handle_type = file_handle_type;
+
+    file_follower() = default;
+    file_follower(const file_follower&) = delete;
+    file_follower& operator=(const file_follower&) = delete;
+
+#ifdef __cpp_exceptions
+    /**
+     * The same as invoking the `open` function, except any error that may occur is
+     * wrapped in a `std::system_error` and is thrown.
+     */
+    explicit file_follower(const handle_type handle,
+            follow_options options = follow_options())
+    {
+        std::error_code error;
+        open(handle, options, error);
+        if(error) { throw std::system_error(error); }
+    }
+#endif // __cpp_exceptions
+
+    ~file_follower() { close(); }
+
+    /** Starts following the file behind `handle`. Upon failure, `error` is set. */
+    void open(const handle_type handle, const follow_options& options, std::error_code& error)
+    {
+        close();
+        error.clear();
+        if(handle == invalid_handle)
+        {
+            error = std::make_error_code(std::errc::bad_file_descriptor);
+            return;
+        }
+#ifdef _WIN32
+        (void)options;
+        error = std::make_error_code(std::errc::not_supported);
+#else
+        if(::pipe(stop_pipe_) != 0)
+        {
+            error = detail::last_error();
+            return;
+        }
+        for(const int fd : stop_pipe_) { ::fcntl(fd, F_SETFD, FD_CLOEXEC); }
+# ifdef __linux__
+        // inotify takes a path, which /proc resolves to the file whatever it's named.
+        // Without it, the size is only polled.
+        inotify_handle_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        const std::string path = "/proc/self/fd/" + std::to_string(handle);
+        if(inotify_handle_ != -1
+           && ::inotify_add_watch(inotify_handle_, path.c_str(), IN_MODIFY) == -1)
+        {
+            ::close(inotify_handle_);
+            inotify_handle_ = -1;
+        }
+# endif
+        file_handle_ = handle;
+        options_ = options;
+        is_stopped_ = false;
+#endif
+    }
+
+    /** Stops following the file. No thread may be waiting. */
+    void close()
+    {
+        if(!is_open()) { return; }
+#ifndef _WIN32
+        ::close(stop_pipe_[0]);
+        ::close(stop_pipe_[1]);
+# ifdef __linux__
+        if(inotify_handle_ != -1) { ::close(inotify_handle_); }
+        inotify_handle_ = -1;
+# endif
+#endif
+        file_handle_ = invalid_handle;
+    }
+
+    bool is_open() const noexcept { return file_handle_ != invalid_handle; }
+    bool is_stopped() const noexcept { return is_stopped_; }
+    const follow_options& options() const noexcept { return options_; }
+
+    /**
+     * Blocks until the file is larger than `size` bytes, `timeout` elapses or `stop`
+     * is called, and returns its size, which is thus not larger than `size` unless
+     * it grew. Upon failure, `error` is set.
+     */
+    int64_t wait(const int64_t size, std::error_code& error)
+    {
+        error.clear();
+        if(!is_open())
+        {
+            error = std::make_error_code(std::errc::bad_file_descriptor);
+            return 0;
+        }
+#ifdef _WIN32
+        (void)size;
+        return 0;
+#else
+        using clock = std::chrono::steady_clock;
+        const bool has_deadline = options_.timeout.count() > 0;
+        const auto deadline = clock::now() + options_.timeout;
+        for(;;)
+        {
+            const int64_t file_size = detail::query_file_size(file_handle_, error);
+            if(error || file_size > size || is_stopped_) { return file_size; }
+
+            auto delay = options_.poll_interval;
+            if(has_deadline)
+            {
+                const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - clock::now());
+                if(left.count() <= 0) { return file_size; }
+                delay = std::min(delay, left);
+            }
+
+            pollfd fds[2] = { { stop_pipe_[0], POLLIN, 0 }, { -1, POLLIN, 0 } };
+# ifdef __linux__
+            fds[1].fd = inotify_handle_;
+# endif
+            if(::poll(fds, 2, static_cast<int>(std::max<int64_t>(delay.count(), 1))) == -1
+               && errno != EINTR)
+            {
+                error = detail::last_error();
+                return file_size;
+            }
+# ifdef __linux__
+            if(fds[1].revents != 0)
+            {
+                char buffer[4096];
+                while(::read(inotify_handle_, buffer, sizeof(buffer)) > 0) {}
+            }
+# endif
+        }
+#endif
+    }
+
+    /** Wakes up any waiting thread and makes further waits return immediately. */
+    void stop()
+    {
+        if(!is_open() || is_stopped_.exchange(true)) { return; }
+#ifndef _WIN32
+        // The byte is never read, so the pipe stays readable for every waiter.
+        const char byte = 0;
+        while(::write(stop_pipe_[1], &byte, 1) == -1 && errno == EINTR) {}
+#endif
+    }
+
+private:
+    handle_type file_handle_ = invalid_handle;
+    follow_options options_;
+    std::atomic<bool> is_stopped_{false};
+#ifndef _WIN32
+    int stop_pipe_[2] = { -1, -1 };
+# ifdef __linux__
+    int inotify_handle_ = -1;
+# endif
+#endif
+};
+
+/**
+ * Waits with `follower` for the file mapped by `mmap` to grow past the end of the
+ * mapping, then extends the mapping to the new end of the file. Returns whether the
+ * mapping grew, which it doesn't if the follower timed out or was stopped.
+ */
+template<access_mode AccessMode, typename ByteT>
+bool follow(basic_mmap<AccessMode, ByteT>& mmap, file_follower& follower,
+        std::error_code& error)
+{
+    const auto end = mmap.size();
+    mmap.extend_to_file(error);
+    if(error) { return false; }
+    if(mmap.size() == end)
+    {
+        follower.wait(static_cast<int64_t>(mmap.file_offset() + end), error);
+        if(error) { return false; }
+        mmap.extend_to_file(error);
+    }
+    return !error && mmap.size() > end;
+}
+
+} // namespace mio
+
+#endif // MIO_FOLLOW_HEADER
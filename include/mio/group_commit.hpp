@@ -0,0 +1,248 @@
+#ifndef MIO_GROUP_COMMIT_HEADER
+#define MIO_GROUP_COMMIT_HEADER
+
+#include "mio/mmap.hpp"
+#include "mio/page.hpp"
+#include "mio/detail/sync.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mio {
+
+/**
+ * Makes ranges of a writable mapping durable on behalf of many concurrent writers
+ * with as few flushes as possible.
+ *
+ * Rather than each writer calling `sync`, which flushes the whole mapping every time,
+ * writers register the range they modified with `commit`. A background thread takes
+ * all requests registered within a batch window, merges their ranges, flushes them
+ * once with `msync(MS_SYNC)` and then completes the whole batch together. Requests
+ * registered while a batch is being flushed form the next batch.
+ *
+ * The mapping must outlive this object and must not be remapped while it's in use.
+ * Pending requests are flushed on destruction.
+ */
+class group_commit
+{
+public:
+    using size_type = size_t;
+    using duration = std::chrono::microseconds;
+    using completion = std::function<void(const std::error_code&)>;
+
+    struct statistics
+    {
+        // Number of ranges committed.
+        uint64_t requests = 0;
+        // Number of batches flushed.
+        uint64_t batches = 0;
+        // Number of `msync` calls made, one per disjoint run of pages in a batch.
+        uint64_t flushes = 0;
+        // The largest number of requests completed by a single batch.
+        uint64_t max_batch = 0;
+
+        double average_batch() const noexcept
+        {
+            return batches == 0 ? 0 : double(requests) / batches;
+        }
+    };
+
+    /**
+     * Starts committing ranges of `mmap`, waiting up to `window` after the first
+     * request of a batch for others to join it. A zero window flushes as soon as a
+     * request arrives, so batches only form while a flush is in progress.
+     */
+    template<typename MMap>
+    explicit group_commit(const MMap& mmap, duration window = duration(100))
+        : mapping_start_(reinterpret_cast<const char*>(mmap.data()) - mmap.mapping_offset())
+        , mapped_length_(mmap.mapped_length())
+        , mapping_offset_(mmap.mapping_offset())
+        , size_(mmap.size())
+        , file_handle_(mmap.file_handle())
+        , window_(window)
+        , thread_([this] { run(); })
+    {}
+
+    group_commit(const group_commit&) = delete;
+    group_commit& operator=(const group_commit&) = delete;
+
+    ~group_commit()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    /**
+     * Registers the `length` bytes at `offset`, relative to the mapping's `data`, and
+     * returns immediately. `done` is invoked on the committing thread once they are
+     * durable or flushing them failed. It must not throw nor block for long, as it
+     * delays the rest of the batch.
+     */
+    void commit(size_type offset, size_type length, completion done)
+    {
+        if(offset > size_ || length > size_ - offset)
+        {
+            done(std::make_error_code(std::errc::invalid_argument));
+            return;
+        }
+        enqueue(request{ offset, length, std::move(done), nullptr });
+    }
+
+    /**
+     * Registers the `length` bytes at `offset` and blocks until they are durable.
+     * Upon failure, `error` is set to the error that the flush ran into.
+     */
+    void commit(size_type offset, size_type length, std::error_code& error)
+    {
+        error.clear();
+        if(offset > size_ || length > size_ - offset)
+        {
+            error = std::make_error_code(std::errc::invalid_argument);
+            return;
+        }
+        waiter w;
+        std::unique_lock<std::mutex> lock(mutex_);
+        queue_.push_back(request{ offset, length, completion(), &w });
+        cv_.notify_one();
+        done_cv_.wait(lock, [&w] { return w.done; });
+        error = w.error;
+    }
+
+    statistics stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    struct waiter
+    {
+        std::error_code error;
+        bool done = false;
+    };
+
+    struct request
+    {
+        size_type offset;
+        size_type length;
+        completion done;
+        waiter* w;
+    };
+
+    void enqueue(request r)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(std::move(r));
+        }
+        cv_.notify_one();
+    }
+
+    void run()
+    {
+        std::vector<request> batch;
+        std::vector<std::pair<size_type, size_type>> runs;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for(;;)
+        {
+            cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if(queue_.empty()) { return; }
+            if(window_.count() > 0 && !stop_)
+            {
+                cv_.wait_for(lock, window_, [this] { return stop_; });
+            }
+            batch.swap(queue_);
+            lock.unlock();
+
+            std::error_code error;
+            const uint64_t flushes = flush(batch, runs, error);
+            for(auto& r : batch)
+            {
+                if(r.done) { r.done(error); }
+            }
+
+            lock.lock();
+            for(auto& r : batch)
+            {
+                if(r.w)
+                {
+                    r.w->error = error;
+                    r.w->done = true;
+                }
+            }
+            stats_.requests += batch.size();
+            stats_.batches += 1;
+            stats_.flushes += flushes;
+            stats_.max_batch = std::max<uint64_t>(stats_.max_batch, batch.size());
+            batch.clear();
+            // Wake all blocked writers of the batch at once.
+            done_cv_.notify_all();
+        }
+    }
+
+    /** Flushes the union of the batch's ranges and returns the number of runs flushed. */
+    uint64_t flush(const std::vector<request>& batch,
+            std::vector<std::pair<size_type, size_type>>& runs, std::error_code& error)
+    {
+        // Convert the ranges to page aligned offsets into the mapping, then merge
+        // those that overlap or touch.
+        const size_type page = page_size();
+        runs.clear();
+        for(const auto& r : batch)
+        {
+            if(r.length == 0) { continue; }
+            const size_type begin = make_offset_page_aligned(mapping_offset_ + r.offset);
+            const size_type end = std::min(
+                make_offset_page_aligned(mapping_offset_ + r.offset + r.length + page - 1),
+                mapped_length_);
+            runs.emplace_back(begin, end);
+        }
+        std::sort(runs.begin(), runs.end());
+
+        uint64_t flushes = 0;
+        for(size_t i = 0; i < runs.size() && !error;)
+        {
+            size_type begin = runs[i].first;
+            size_type end = runs[i].second;
+            for(++i; i < runs.size() && runs[i].first <= end; ++i)
+            {
+                end = std::max(end, runs[i].second);
+            }
+            detail::sync_range(mapping_start_, mapped_length_, begin, end - begin,
+                file_handle_, true, error);
+            ++flushes;
+        }
+        return flushes;
+    }
+
+    const char* mapping_start_;
+    size_type mapped_length_;
+    size_type mapping_offset_;
+    size_type size_;
+    file_handle_type file_handle_;
+    duration window_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable done_cv_;
+    std::vector<request> queue_;
+    statistics stats_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+} // namespace mio
+
+#endif // MIO_GROUP_COMMIT_HEADER
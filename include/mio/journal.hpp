@@ -0,0 +1,420 @@
+#ifndef MIO_JOURNAL_HEADER
+#define MIO_JOURNAL_HEADER
+
+#include "mio/mmap.hpp"
+#include "mio/page.hpp"
+#include "mio/detail/hash.hpp"
+#include "mio/detail/sync.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+#include <vector>
+
+namespace mio {
+
+struct journal_options
+{
+    // Size of the log file. Committing a transaction that doesn't fit in what's left
+    // of the log first checkpoints, which syncs the whole data file.
+    size_t log_capacity = 16 << 20;
+
+    // Whether to leave committed transactions in the log until `apply` or the next
+    // checkpoint, rather than copying them to the data file's mapping on `commit`.
+    // Modifying the data file's pages updates its timestamps, which the file system
+    // may then have to journal on the log's next flush, so applying lazily keeps
+    // commits from stalling.
+    bool lazy_apply = true;
+};
+
+/**
+ * Makes small updates to a mapped file durable without syncing the whole file, by
+ * recording them in a write-ahead log.
+ *
+ * A transaction's writes are appended to a mapped log file as one checksummed
+ * record, and only that range of the log is synced on `commit`. The writes are
+ * applied to the data file's mapping later, by `apply` or a checkpoint, unless
+ * `lazy_apply` is disabled. The data file is left for the kernel to write back: it
+ * is only synced on `checkpoint`, when the log fills up and on `close`, after which
+ * the log starts over.
+ *
+ * When opened, records left in the log by a crash are replayed onto the data file,
+ * so a committed transaction is never lost and one that was being committed is either
+ * applied whole or not at all. Since records describe the bytes written, replaying
+ * a record more than once is harmless.
+ *
+ * A journal is not thread-safe.
+ */
+class journal
+{
+public:
+    using size_type = size_t;
+
+    /** A set of writes to the data file, committed atomically. */
+    class transaction
+    {
+    public:
+        /** Records a write of `length` bytes at `data` to `offset` in the data file. */
+        void write(size_type offset, const void* data, size_type length)
+        {
+            append_u64(offset);
+            append_u64(length);
+            const auto p = static_cast<const char*>(data);
+            payload_.insert(payload_.end(), p, p + length);
+            payload_.resize(align(payload_.size()), 0);
+        }
+
+        bool empty() const noexcept { return payload_.empty(); }
+        void clear() noexcept { payload_.clear(); }
+
+        /** Returns the size of the transaction's writes as encoded in the log. */
+        size_type size() const noexcept { return payload_.size(); }
+
+    private:
+        friend class journal;
+
+        void append_u64(uint64_t value)
+        {
+            const auto p = reinterpret_cast<const char*>(&value);
+            payload_.insert(payload_.end(), p, p + sizeof(value));
+        }
+
+        std::vector<char> payload_;
+    };
+
+    journal() = default;
+    journal(const journal&) = delete;
+    journal& operator=(const journal&) = delete;
+
+#ifdef __cpp_exceptions
+    /**
+     * The same as invoking the `open` function, except any error that may occur
+     * while opening the journal is wrapped in a `std::system_error` and is thrown.
+     */
+    template<typename String, typename LogString>
+    journal(const String& path, const LogString& log_path,
+            const journal_options& options = journal_options())
+    {
+        std::error_code error;
+        open(path, log_path, options, error);
+        if(error) { throw std::system_error(error); }
+    }
+#endif // __cpp_exceptions
+
+    /** Checkpoints and closes the journal, ignoring errors. */
+    ~journal()
+    {
+        std::error_code error;
+        close(error);
+    }
+
+    /**
+     * Maps the data file at `path` and the log at `log_path`, which is created if
+     * needed, then replays the committed transactions found in the log.
+     * Upon failure, `error` is set to indicate the reason and the journal remains
+     * closed.
+     */
+    template<typename String, typename LogString>
+    void open(const String& path, const LogString& log_path,
+            const journal_options& options, std::error_code& error)
+    {
+        close(error);
+        data_.map(path, error);
+        if(error) { return; }
+        // The log is only resized once its records are replayed and checkpointed, as
+        // shrinking it first would cut off committed transactions.
+        log_.map(log_path, error);
+        if(error)
+        {
+            data_.unmap();
+            return;
+        }
+
+        // A log without a valid header is new, or its header was torn or corrupted.
+        // Its generation is then recovered from its records, so that the new one
+        // can't be mistaken for an earlier generation whose records are left over.
+        log_header header;
+        std::memcpy(&header, log_.data(), sizeof(header));
+        if(std::memcmp(header.magic, log_magic(), sizeof(header.magic)) != 0
+           || header.checksum != header_checksum(header))
+        {
+            header.generation = find_generation();
+        }
+        generation_ = header.generation;
+        is_lazy_ = options.lazy_apply;
+        replayed_ = replay();
+
+        // Start a new generation, so that nothing left in the log is mistaken for a
+        // record of the new one.
+        checkpoint(error);
+        if(!error)
+        {
+            resize_log(std::max<size_type>(options.log_capacity, 2 * page_size()), error);
+        }
+        if(error)
+        {
+            data_.unmap();
+            log_.unmap();
+        }
+    }
+
+    /** Checkpoints, then unmaps the data file and the log. */
+    void close(std::error_code& error)
+    {
+        error.clear();
+        if(!is_open()) { return; }
+        checkpoint(error);
+        data_.unmap();
+        log_.unmap();
+        tail_ = applied_ = 0;
+        sequence_ = 0;
+    }
+
+    bool is_open() const noexcept { return data_.is_open(); }
+
+    /**
+     * Returns the contents of the data file, which include the committed transactions
+     * that were applied.
+     */
+    const char* data() const noexcept { return data_.data(); }
+    size_type size() const noexcept { return data_.size(); }
+
+    /** Returns the number of bytes of the log in use since the last checkpoint. */
+    size_type log_size() const noexcept { return tail_; }
+    size_type log_capacity() const noexcept { return log_.size(); }
+
+    /** Returns the number of transactions replayed when the journal was opened. */
+    size_type replayed() const noexcept { return replayed_; }
+
+    transaction begin() const { return transaction(); }
+
+    /**
+     * Writes `t` to the log and waits for it to be durable. Upon failure, `error` is
+     * set and the transaction is discarded.
+     */
+    void commit(const transaction& t, std::error_code& error)
+    {
+        error.clear();
+        if(!is_open())
+        {
+            error = std::make_error_code(std::errc::bad_file_descriptor);
+            return;
+        }
+        if(t.empty()) { return; }
+        if(!is_valid(t.payload_.data(), t.size()))
+        {
+            error = std::make_error_code(std::errc::invalid_argument);
+            return;
+        }
+
+        const size_type record_size = sizeof(record_header) + t.size();
+        if(tail_ + record_size > log_.size())
+        {
+            if(header_size + record_size > log_.size())
+            {
+                error = std::make_error_code(std::errc::no_buffer_space);
+                return;
+            }
+            checkpoint(error);
+            if(error) { return; }
+        }
+
+        record_header header;
+        header.magic = record_magic;
+        header.reserved = 0;
+        header.generation = generation_;
+        header.sequence = sequence_;
+        header.length = t.size();
+        header.checksum = record_checksum(header, t.payload_.data());
+        char* record = log_.data() + tail_;
+        std::memcpy(record, &header, sizeof(header));
+        std::memcpy(record + sizeof(header), t.payload_.data(), t.size());
+
+        detail::sync_range(log_.data(), log_.mapped_length(), tail_, record_size,
+            log_.file_handle(), true, error);
+        if(error) { return; }
+
+        tail_ += record_size;
+        ++sequence_;
+        if(!is_lazy_) { apply(); }
+    }
+
+    /** Applies the committed transactions to the data file's mapping. */
+    void apply() noexcept
+    {
+        while(applied_ < tail_)
+        {
+            record_header header;
+            std::memcpy(&header, log_.data() + applied_, sizeof(header));
+            apply_writes(log_.data() + applied_ + sizeof(header), header.length);
+            applied_ += sizeof(header) + header.length;
+        }
+    }
+
+    /**
+     * Applies the committed transactions and syncs the data file, after which the
+     * log's records are no longer needed, and starts the log over.
+     */
+    void checkpoint(std::error_code& error)
+    {
+        error.clear();
+        if(!is_open()) { return; }
+        apply();
+        data_.sync(error);
+        if(error) { return; }
+
+        log_header header;
+        std::memcpy(header.magic, log_magic(), sizeof(header.magic));
+        header.generation = generation_ + 1;
+        header.checksum = header_checksum(header);
+        std::memcpy(log_.data(), &header, sizeof(header));
+        detail::sync_range(log_.data(), log_.mapped_length(), 0, sizeof(header),
+            log_.file_handle(), true, error);
+        if(error) { return; }
+
+        generation_ = header.generation;
+        tail_ = applied_ = header_size;
+        sequence_ = 0;
+    }
+
+private:
+    static constexpr uint32_t record_magic = 0x4d494f52;
+    // Records start after the header, on an 8 byte boundary like all records.
+    static constexpr size_type header_size = 64;
+
+    static const char* log_magic() noexcept { return "MIOJRNL1"; }
+
+    struct log_header
+    {
+        char magic[8];
+        uint64_t generation;
+        uint64_t checksum;
+    };
+
+    struct record_header
+    {
+        uint32_t magic;
+        uint32_t reserved;
+        uint64_t generation;
+        uint64_t sequence;
+        uint64_t length;
+        uint64_t checksum;
+    };
+
+    static size_type align(size_type n) noexcept { return (n + 7) & ~size_type(7); }
+
+    static uint64_t header_checksum(const log_header& header) noexcept
+    {
+        const uint64_t hash = detail::fnv1a(header.magic, sizeof(header.magic));
+        return detail::fnv1a(&header.generation, sizeof(header.generation), hash);
+    }
+
+    static uint64_t record_checksum(const record_header& header, const char* payload) noexcept
+    {
+        uint64_t hash = detail::fnv1a(&header.generation, sizeof(header.generation));
+        hash = detail::fnv1a(&header.sequence, sizeof(header.sequence), hash);
+        hash = detail::fnv1a(&header.length, sizeof(header.length), hash);
+        return detail::fnv1a(payload, header.length, hash);
+    }
+
+    /** Returns whether all writes encoded in `payload` fall within the data file. */
+    bool is_valid(const char* payload, size_type length) const noexcept
+    {
+        for(size_type pos = 0; pos < length;)
+        {
+            if(length - pos < 16) { return false; }
+            uint64_t offset, n;
+            std::memcpy(&offset, payload + pos, 8);
+            std::memcpy(&n, payload + pos + 8, 8);
+            pos += 16;
+            if(offset > size() || n > size() - offset || n > length - pos) { return false; }
+            pos = align(pos + n);
+        }
+        return true;
+    }
+
+    void apply_writes(const char* payload, size_type length) noexcept
+    {
+        for(size_type pos = 0; pos < length;)
+        {
+            uint64_t offset, n;
+            std::memcpy(&offset, payload + pos, 8);
+            std::memcpy(&n, payload + pos + 8, 8);
+            std::memcpy(data_.data() + offset, payload + pos + 16, n);
+            pos = align(pos + 16 + n);
+        }
+    }
+
+    /** Resizes the log, which must hold no records, to `capacity` bytes. */
+    void resize_log(size_type capacity, std::error_code& error)
+    {
+        if(log_.size() == capacity) { return; }
+        // Write the whole log once, so that commits don't have to allocate blocks.
+        const size_type old_size = log_.size();
+        log_.truncate(capacity, error);
+        if(!error && capacity > old_size)
+        {
+            std::memset(log_.data() + old_size, 0, capacity - old_size);
+            log_.sync(error);
+        }
+    }
+
+    /** Returns the highest generation of any valid record in the log, or 0. */
+    uint64_t find_generation() const noexcept
+    {
+        uint64_t generation = 0;
+        // Records of older generations may be left at any record boundary.
+        for(size_type pos = header_size; pos + sizeof(record_header) <= log_.size(); pos += 8)
+        {
+            record_header header;
+            std::memcpy(&header, log_.data() + pos, sizeof(header));
+            if(header.magic == record_magic && header.generation > generation
+               && header.length <= log_.size() - pos - sizeof(header)
+               && header.checksum == record_checksum(header, log_.data() + pos + sizeof(header)))
+            {
+                generation = header.generation;
+            }
+        }
+        return generation;
+    }
+
+    /** Applies the log's valid records of the current generation, in order. */
+    size_type replay() noexcept
+    {
+        if(generation_ == 0) { return 0; }
+        size_type count = 0;
+        size_type pos = header_size;
+        for(uint64_t sequence = 0; pos + sizeof(record_header) <= log_.size(); ++sequence)
+        {
+            record_header header;
+            std::memcpy(&header, log_.data() + pos, sizeof(header));
+            const char* payload = log_.data() + pos + sizeof(header);
+            if(header.magic != record_magic || header.generation != generation_
+               || header.sequence != sequence
+               || header.length > log_.size() - pos - sizeof(header)
+               || header.checksum != record_checksum(header, payload)
+               || !is_valid(payload, header.length))
+            {
+                break;
+            }
+            apply_writes(payload, header.length);
+            pos += sizeof(header) + header.length;
+            ++count;
+        }
+        return count;
+    }
+
+    mmap_sink data_;
+    mmap_sink log_;
+    uint64_t generation_ = 0;
+    uint64_t sequence_ = 0;
+    size_type tail_ = 0;
+    size_type applied_ = 0;
+    size_type replayed_ = 0;
+    bool is_lazy_ = true;
+};
+
+} // namespace mio
+
+#endif // MIO_JOURNAL_HEADER
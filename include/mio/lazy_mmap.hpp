@@ -0,0 +1,251 @@
+#ifndef MIO_LAZY_MMAP_HEADER
+#define MIO_LAZY_MMAP_HEADER
+
+#include "mio/mmap.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <system_error>
+#include <type_traits>
+
+namespace mio {
+
+/**
+ * A mapping that is only established when its data are first accessed.
+ *
+ * `map` opens the file and checks the requested range against its size, but leaves
+ * the `mmap` call to the first `data`, `begin`, `end` or `operator[]`, or to an
+ * explicit `map_now`. Opening many files of which few are read thus costs no
+ * mappings for the others, neither the system calls nor the kernel's bookkeeping.
+ *
+ * The mapping is established once, even if several threads access the data at the
+ * same time. Once it's established, accessing the data costs an atomic load more
+ * than with `basic_mmap`. If establishing it fails, the data are null, `error` says
+ * why and the next access tries again.
+ *
+ * Apart from the data accessors, `map_now` and `error`, the object is not
+ * thread-safe.
+ */
+template<access_mode AccessMode, typename ByteT>
+class basic_lazy_mmap
+{
+public:
+    using mmap_type = basic_mmap<AccessMode, ByteT>;
+    using value_type = typename mmap_type::value_type;
+    using size_type = typename mmap_type::size_type;
+    using pointer = typename mmap_type::pointer;
+    using const_pointer = typename mmap_type::const_pointer;
+    using handle_type = typename mmap_type::handle_type;
+    using iterator = typename std::conditional<AccessMode == access_mode::write,
+        pointer, const_pointer>::type;
+    using const_iterator = const_pointer;
+
+    basic_lazy_mmap() = default;
+    basic_lazy_mmap(const basic_lazy_mmap&) = delete;
+    basic_lazy_mmap& operator=(const basic_lazy_mmap&) = delete;
+
+    /** Moving is not thread-safe: no other thread may access either object. */
+    basic_lazy_mmap(basic_lazy_mmap&& other) { *this = std::move(other); }
+
+    basic_lazy_mmap& operator=(basic_lazy_mmap&& other)
+    {
+        if(this != &other)
+        {
+            unmap();
+            mmap_ = std::move(other.mmap_);
+            data_.store(other.data_.load());
+            file_handle_ = other.file_handle_;
+            offset_ = other.offset_;
+            length_ = other.length_;
+            error_ = other.error_;
+            other.data_.store(nullptr);
+            other.file_handle_ = invalid_handle;
+            other.offset_ = other.length_ = 0;
+            other.error_.clear();
+        }
+        return *this;
+    }
+
+#ifdef __cpp_exceptions
+    /**
+     * The same as invoking the `map` function, except any error that may occur
+     * while opening the file is wrapped in a `std::system_error` and is thrown.
+     */
+    template<typename String>
+    basic_lazy_mmap(const String& path, const size_type offset = 0,
+            const size_type length = map_entire_file,
+            const open_options& options = open_options())
+    {
+        std::error_code error;
+        map(path, offset, length, options, error);
+        if(error) { throw std::system_error(error); }
+    }
+#endif // __cpp_exceptions
+
+    ~basic_lazy_mmap() { unmap(); }
+
+    /**
+     * Opens the file at `path` to map `length` bytes from `offset` on first access,
+     * replacing any previous mapping. Upon failure, `error` is set and the object
+     * remains unmapped.
+     */
+    template<typename String>
+    void map(const String& path, const size_type offset, const size_type length,
+            const open_options& options, std::error_code& error)
+    {
+        error.clear();
+        const auto handle = detail::open_file(path, AccessMode, options, error);
+        if(error) { return; }
+        const auto file_size = detail::query_file_size(handle, error);
+        if(!error && static_cast<int64_t>(offset + length) > file_size)
+        {
+            error = std::make_error_code(std::errc::invalid_argument);
+        }
+        if(error)
+        {
+            detail::close_file(handle);
+            return;
+        }
+
+        unmap();
+        file_handle_ = handle;
+        offset_ = offset;
+        length_ = length == map_entire_file ? static_cast<size_type>(file_size) - offset : length;
+    }
+
+    template<typename String>
+    void map(const String& path, std::error_code& error)
+    {
+        map(path, 0, map_entire_file, open_options(), error);
+    }
+
+    /**
+     * Unmaps the file if it was mapped, and closes it. Like `basic_mmap`'s
+     * destructor, this first writes a sink's data back to disk, ignoring errors.
+     */
+    void unmap()
+    {
+        if(!is_open()) { return; }
+        conditional_sync();
+        mmap_.unmap();
+        data_.store(nullptr);
+        detail::close_file(file_handle_);
+        file_handle_ = invalid_handle;
+        offset_ = length_ = 0;
+        error_.clear();
+    }
+
+    /** Returns whether a file was opened, whether or not it was mapped yet. */
+    bool is_open() const noexcept { return file_handle_ != invalid_handle; }
+
+    /** Returns whether the mapping was established. */
+    bool is_mapped() const noexcept { return data_.load() != nullptr; }
+
+    handle_type file_handle() const noexcept { return file_handle_; }
+    size_type file_offset() const noexcept { return offset_; }
+
+    /** The size is known without mapping the file. */
+    size_type size() const noexcept { return length_; }
+    size_type length() const noexcept { return length_; }
+    bool empty() const noexcept { return length_ == 0; }
+
+    /**
+     * Establishes the mapping unless it was already, e.g. to do so off the thread
+     * that is going to access the data. Upon failure, `error` is set.
+     */
+    void map_now(std::error_code& error)
+    {
+        error.clear();
+        if(is_mapped()) { return; }
+        establish();
+        error = this->error();
+    }
+
+    /** Returns the error that establishing the mapping last failed with, if any. */
+    std::error_code error() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return error_;
+    }
+
+    /** Returns the underlying mapping, establishing it first. */
+    const mmap_type& mmap() const noexcept
+    {
+        (void)data();
+        return mmap_;
+    }
+
+    iterator data() noexcept { return const_cast<iterator>(get()); }
+    const_pointer data() const noexcept { return get(); }
+
+    iterator begin() noexcept { return data(); }
+    const_iterator begin() const noexcept { return data(); }
+    const_iterator cbegin() const noexcept { return data(); }
+
+    // If mapping fails, `data()` is null and the range empty.
+    iterator end() noexcept { auto p = data(); return p ? p + length_ : p; }
+    const_iterator end() const noexcept { auto p = data(); return p ? p + length_ : p; }
+    const_iterator cend() const noexcept { return end(); }
+
+    typename std::iterator_traits<iterator>::reference operator[](const size_type i) noexcept
+    {
+        return data()[i];
+    }
+
+    const value_type& operator[](const size_type i) const noexcept { return data()[i]; }
+
+private:
+    template<access_mode A = AccessMode>
+    typename std::enable_if<A == access_mode::write, void>::type
+    conditional_sync()
+    {
+        if(!is_mapped()) { return; }
+        std::error_code error;
+        mmap_.sync(error);
+    }
+
+    template<access_mode A = AccessMode>
+    typename std::enable_if<A == access_mode::read, void>::type
+    conditional_sync() {}
+
+    const_pointer get() const noexcept
+    {
+        const_pointer data = data_.load(std::memory_order_acquire);
+        return data ? data : establish();
+    }
+
+    const_pointer establish() const noexcept
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const_pointer data = data_.load(std::memory_order_relaxed);
+        if(data || !is_open() || length_ == 0) { return data; }
+        mmap_.map(file_handle_, offset_, length_, error_);
+        if(error_) { return nullptr; }
+        data_.store(mmap_.data(), std::memory_order_release);
+        return mmap_.data();
+    }
+
+    mutable mmap_type mmap_;
+    mutable std::atomic<const_pointer> data_{nullptr};
+    mutable std::mutex mutex_;
+    mutable std::error_code error_;
+    handle_type file_handle_ = invalid_handle;
+    size_type offset_ = 0;
+    size_type length_ = 0;
+};
+
+template<typename ByteT>
+using basic_lazy_mmap_source = basic_lazy_mmap<access_mode::read, ByteT>;
+
+template<typename ByteT>
+using basic_lazy_mmap_sink = basic_lazy_mmap<access_mode::write, ByteT>;
+
+using lazy_mmap_source = basic_lazy_mmap_source<char>;
+using lazy_ummap_source = basic_lazy_mmap_source<unsigned char>;
+
+using lazy_mmap_sink = basic_lazy_mmap_sink<char>;
+using lazy_ummap_sink = basic_lazy_mmap_sink<unsigned char>;
+
+} // namespace mio
+
+#endif // MIO_LAZY_MMAP_HEADER
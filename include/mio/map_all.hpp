@@ -0,0 +1,115 @@
+#ifndef MIO_MAP_ALL_HEADER
+#define MIO_MAP_ALL_HEADER
+
+#include "mio/mmap.hpp"
+#include "mio/thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+namespace mio {
+
+struct batch_options
+{
+    // How each file is opened; see `open_options`.
+    open_options open;
+
+    // Number of files mapped by each task posted to the pool. Larger batches cost
+    // less synchronization, smaller ones balance the load better when some files
+    // are slow to open, e.g. on a network file system.
+    size_t batch_size = 64;
+};
+
+/** The outcome of `map_all`. */
+template<typename MMap>
+struct batch_mapping
+{
+    using duration = std::chrono::nanoseconds;
+
+    // The mappings and errors of the files, in the order of their paths. The mapping
+    // of a file that failed to map is left unmapped.
+    std::vector<MMap> mmaps;
+    std::vector<std::error_code> errors;
+
+    // Wall-clock time `map_all` took, and the time the workers spent mapping files,
+    // summed over all of them. Their ratio is the parallelism achieved.
+    duration elapsed = duration::zero();
+    duration busy_time = duration::zero();
+
+    size_t size() const noexcept { return mmaps.size(); }
+
+    size_t num_failed() const noexcept
+    {
+        return static_cast<size_t>(std::count_if(errors.begin(), errors.end(),
+            [](const std::error_code& error) { return static_cast<bool>(error); }));
+    }
+};
+
+/**
+ * Maps each of the files in `paths` entirely, in parallel on `pool`, and blocks
+ * until all of them are done.
+ *
+ * Opening, querying the size of and mapping a file are each a system call, which
+ * some file systems are slow to serve; mapping many files one after the other
+ * serializes them. Here, they are spread over the pool's workers in batches of
+ * `options.batch_size` files. A file failing to map doesn't affect the others.
+ *
+ * `MMap` is any mapping type with a `map(path, offset, length, options, error)`
+ * member, e.g. `mmap_source`, `shared_mmap_sink` or `lazy_mmap_source`. This must
+ * not be called from one of the pool's workers.
+ */
+template<typename MMap = mmap_source, typename String>
+batch_mapping<MMap> map_all(const std::vector<String>& paths,
+        const batch_options& options = batch_options(),
+        thread_pool& pool = default_thread_pool())
+{
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+
+    batch_mapping<MMap> result;
+    result.mmaps.resize(paths.size());
+    result.errors.resize(paths.size());
+
+    const size_t batch_size = std::max<size_t>(options.batch_size, 1);
+    const size_t num_batches = (paths.size() + batch_size - 1) / batch_size;
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t remaining = num_batches;
+    std::atomic<int64_t> busy_time{0};
+
+    for(size_t first = 0; first < paths.size(); first += batch_size)
+    {
+        const size_t last = std::min(first + batch_size, paths.size());
+        // Each task writes to its own elements of the vectors, so they need no lock.
+        pool.post([&, first, last]
+        {
+            const auto batch_start = clock::now();
+            for(size_t i = first; i < last; ++i)
+            {
+                result.mmaps[i].map(paths[i], 0, map_entire_file, options.open, result.errors[i]);
+            }
+            busy_time += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                clock::now() - batch_start).count();
+            std::lock_guard<std::mutex> lock(mutex);
+            if(--remaining == 0) { cv.notify_one(); }
+        });
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return remaining == 0; });
+    }
+    result.busy_time = std::chrono::nanoseconds(busy_time.load());
+    result.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+    return result;
+}
+
+} // namespace mio
+
+#endif // MIO_MAP_ALL_HEADER
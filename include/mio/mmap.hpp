@@ -27,6 +27,7 @@
 #include <string>
 #include <system_error>
 #include <cstdint>
+#include <vector>
 
 #ifdef _WIN32
 # ifndef WIN32_LEAN_AND_MEAN
@@ -53,6 +54,69 @@ using file_handle_type = int;
 // determine whether `basic_mmap::file_handle` is valid, for example.
 const static file_handle_type invalid_handle = INVALID_HANDLE_VALUE;
 
+/** How a file is going to be accessed. */
+enum class access_pattern
+{
+    // No particular pattern.
+    normal,
+    // A single front to back pass, which streaming reads serve best.
+    sequential,
+    // Scattered accesses, for which the kernel's readahead is disabled.
+    random
+};
+
+/** Whether opening a file by path may create it. */
+enum class creation_policy
+{
+    // Writable mappings create the file if it doesn't exist, read-only ones don't
+    // (except on Windows, where both do).
+    open_or_create,
+    // The file must exist.
+    open_existing,
+    // The file must not exist, and is created.
+    create_new
+};
+
+/** How `map` and `make_mmap` open a file given by path. */
+struct open_options
+{
+    creation_policy creation = creation_policy::open_or_create;
+
+    // Whether reads leave the file's access time alone (`O_NOATIME`), which saves a
+    // metadata write on file systems mounted without `noatime` or `relatime`. Only
+    // the file's owner may do so; for others this is ignored. Linux only.
+    bool no_atime = false;
+
+    // Whether the file handle is closed in child processes started with `exec`
+    // (`O_CLOEXEC`). Off by default, so that handles are inherited as they always
+    // were; multithreaded programs that spawn processes should turn it on. Handles
+    // are never inherited on Windows.
+    bool close_on_exec = false;
+
+    // The size an empty file is given when opened for writing, as it can't be mapped
+    // otherwise. 0 means a page.
+    size_t initial_size = 0;
+
+    // Whether the initial size is allocated on disk up front (`posix_fallocate`),
+    // rather than leaving a sparse file to be filled in as pages are written back.
+    bool preallocate = false;
+
+    // Handed to the kernel for the whole file with `posix_fadvise`, or as a
+    // `FILE_FLAG_SEQUENTIAL_SCAN` or `FILE_FLAG_RANDOM_ACCESS` flag on Windows.
+    access_pattern pattern = access_pattern::normal;
+
+    // Number of bytes from the start of the mapped range that the kernel is asked to
+    // read ahead right away (`POSIX_FADV_WILLNEED`). POSIX only.
+    size_t readahead = 0;
+};
+
+/** A range of a mapping, as an offset from its first byte and a length. */
+struct data_extent
+{
+    size_t offset;
+    size_t length;
+};
+
 template<access_mode AccessMode, typename ByteT>
 struct basic_mmap
 {
@@ -81,6 +145,15 @@ private:
     size_type length_ = 0;
     size_type mapped_length_ = 0;
 
+    // Offset--in bytes--of the first requested byte relative to the start of
+    // the file, as requested by user.
+    size_type file_offset_ = 0;
+
+    // Start and length of the address range reserved by `reserve`, in which the
+    // mapping grows and shrinks in place, or null and 0 if none was reserved.
+    pointer reservation_ = nullptr;
+    size_type reserved_length_ = 0;
+
     // Letting user map a file using both an existing file handle and a path
     // introcudes some complexity (see `is_handle_internal_`).
     // On POSIX, we only need a file handle to create a mapping, while on
@@ -121,6 +194,20 @@ public:
         if(error) { throw std::system_error(error); }
     }
 
+    /**
+     * The same as invoking the `map` function, except any error that may occur
+     * while establishing the mapping is wrapped in a `std::system_error` and is
+     * thrown.
+     */
+    template<typename String>
+    basic_mmap(const String& path, const size_type offset, const size_type length,
+            const open_options& options)
+    {
+        std::error_code error;
+        map(path, offset, length, options, error);
+        if(error) { throw std::system_error(error); }
+    }
+
     /**
      * The same as invoking the `map` function, except any error that may occur
      * while establishing the mapping is wrapped in a `std::system_error` and is
@@ -186,6 +273,22 @@ public:
         return mapped_length_ - length_;
     }
 
+    /**
+     * Returns the offset of the first requested byte relative to the start of
+     * the file, i.e. the `offset` that was passed to `map` or `remap`.
+     */
+    size_type file_offset() const noexcept { return file_offset_; }
+
+    /**
+     * Returns the number of bytes from `data` to which the mapping may grow without
+     * moving, which is its length unless address space was reserved with `reserve`.
+     */
+    size_type capacity() const noexcept
+    {
+        return reservation_ ? reserved_length_ - (file_offset_ - make_offset_page_aligned(file_offset_))
+            : length_;
+    }
+
     /**
      * Returns a pointer to the first requested byte, or `nullptr` if no memory mapping
      * exists.
@@ -275,7 +378,18 @@ public:
      */
     template<typename String>
     void map(const String& path, const size_type offset,
-            const size_type length, std::error_code& error);
+            const size_type length, std::error_code& error)
+    {
+        map(path, offset, length, open_options(), error);
+    }
+
+    /**
+     * The same as the above, except that the file is opened as described by
+     * `options`.
+     */
+    template<typename String>
+    void map(const String& path, const size_type offset, const size_type length,
+            const open_options& options, std::error_code& error);
 
     /**
      * Establishes a memory mapping with AccessMode. If the mapping is unsuccesful, the
@@ -362,10 +476,54 @@ public:
     typename std::enable_if<A == access_mode::write, void>::type
     sync(std::error_code& error);
 
+    /**
+     * Resizes the underlying file to `file_size` bytes and remaps the region
+     * from `file_offset` to the new end of file. If the new end of file does not
+     * lie beyond `file_offset`, the mapped region is released while the file
+     * handle is kept open, so a later `truncate` or `remap` may extend it again.
+     * Errors are reported via `error`.
+     */
     template<access_mode A = AccessMode>
     typename std::enable_if<A == access_mode::write, void>::type
     truncate(size_type file_size, std::error_code& error);
 
+    /**
+     * Reserves address space for the mapping to grow to `capacity` bytes from `data`.
+     * The range beyond the mapped length is inaccessible and takes up no memory.
+     *
+     * From then on, `remap`, `truncate` and `extend_to_file` calls that keep the file
+     * offset grow or shrink the mapping in place: `data`, and any pointer into the
+     * mapping, remain valid, and only the pages added are mapped, so those already
+     * mapped needn't be faulted in again. Growing beyond the capacity fails with
+     * `not_enough_memory` and leaves the mapping as it was.
+     *
+     * Like `std::vector::reserve`, this moves the mapping if it raises the capacity,
+     * which is the only way a reserved mapping moves.
+     * Remapping at a different file offset gives up the reservation. This is only
+     * supported on POSIX systems; errors are reported via `error`.
+     */
+    void reserve(size_type capacity, std::error_code& error);
+
+    /**
+     * Extends the mapping to the end of the file, which may have grown since it was
+     * mapped, e.g. by another process appending to it. The file itself is never
+     * resized. Within address space reserved with `reserve` the mapping grows in
+     * place, and fails with `not_enough_memory` if the file outgrew the capacity;
+     * otherwise the file is mapped anew and `data` changes. Nothing happens if the
+     * file didn't grow past the mapping. Errors are reported via `error`.
+     */
+    void extend_to_file(std::error_code& error);
+
+    /**
+     * Returns the ranges of the mapping that hold data in the file, in order, so
+     * that scans of sparse files may skip their holes, which only read as zeros.
+     * The ranges are found with `SEEK_DATA` and `SEEK_HOLE` at the file system's
+     * granularity; the file handle's offset is restored afterwards, but is moved
+     * meanwhile, so the handle mustn't be used concurrently. Where holes can't be
+     * found, the whole mapping is one range. Errors are reported via `error`.
+     */
+    std::vector<data_extent> data_extents(std::error_code& error) const;
+
     /**
      * All operators compare the address of the first byte and size of the two mapped
      * regions.
@@ -395,6 +553,9 @@ private:
     conditional_sync();
     template<access_mode A = AccessMode>
     typename std::enable_if<A == access_mode::read, void>::type conditional_sync();
+
+    /** Resizes the mapping within the reserved range, without moving it. */
+    void remap_in_place(size_type new_length, std::error_code& error);
 };
 
 template<access_mode AccessMode, typename ByteT>
@@ -460,6 +621,21 @@ template<
     return mmap;
 }
 
+/**
+ * The same as the above, except that a file given by path is opened as described
+ * by `options`.
+ */
+template<
+    typename MMap,
+    typename String
+> MMap make_mmap(const String& path, int64_t offset, int64_t length,
+        const open_options& options, std::error_code& error)
+{
+    MMap mmap;
+    mmap.map(path, offset, length, options, error);
+    return mmap;
+}
+
 /**
  * Convenience factory method.
  *
@@ -480,6 +656,13 @@ mmap_source make_mmap_source(const MappingToken& token, std::error_code& error)
     return make_mmap_source(token, 0, map_entire_file, error);
 }
 
+template<typename String>
+mmap_source make_mmap_source(const String& path, mmap_source::size_type offset,
+        mmap_source::size_type length, const open_options& options, std::error_code& error)
+{
+    return make_mmap<mmap_source>(path, offset, length, options, error);
+}
+
 /**
  * Convenience factory method.
  *
@@ -500,6 +683,13 @@ mmap_sink make_mmap_sink(const MappingToken& token, std::error_code& error)
     return make_mmap_sink(token, 0, map_entire_file, error);
 }
 
+template<typename String>
+mmap_sink make_mmap_sink(const String& path, mmap_sink::size_type offset,
+        mmap_sink::size_type length, const open_options& options, std::error_code& error)
+{
+    return make_mmap<mmap_sink>(path, offset, length, options, error);
+}
+
 } // namespace mio
 
 #include "detail/mmap.ipp"
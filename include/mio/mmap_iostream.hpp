@@ -17,6 +17,12 @@ public:
      : std::iostream(this)
      , mmap_iostreambuf(path, offset, length)
     {}
+
+    template<typename String>
+    mmap_iostream(const String& path, std::ios_base::openmode mode)
+     : std::iostream(this)
+     , mmap_iostreambuf(path, mode)
+    {}
 };
 
 class mmap_istream : public std::istream, public mmap_istreambuf
@@ -28,6 +34,12 @@ public:
      : std::istream(this)
      , mmap_istreambuf(path, offset, length)
     {}
+
+    template<typename String>
+    mmap_istream(const String& path, std::ios_base::openmode mode)
+     : std::istream(this)
+     , mmap_istreambuf(path, mode)
+    {}
 };
 
 class mmap_ostream : public std::ostream, public mmap_ostreambuf
@@ -39,6 +51,12 @@ public:
      : std::ostream(this)
      , mmap_ostreambuf(path, offset, length)
     {}
+
+    template<typename String>
+    mmap_ostream(const String& path, std::ios_base::openmode mode)
+     : std::ostream(this)
+     , mmap_ostreambuf(path, mode)
+    {}
 };
 
 } // namespace mio
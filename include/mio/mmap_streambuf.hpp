@@ -3,17 +3,20 @@
 
 #include <cassert>
 #include <algorithm>
+#include <ios>
+#include <limits>
+#include <memory>
 #include <streambuf>
+#include <system_error>
 
 #include "page.hpp"
 #include "mmap.hpp"
+#include "follow.hpp"
 
 namespace mio
 {
 
-// todo: support all std::ios_base::openmode flags. right now it truncates.
 // todo: mapped subranges?
-// todo: coroutines + check committed/avaliable pages
 
 template<access_mode AccessMode, typename ByteT = char>
 class mmap_streambuf : public std::basic_streambuf<ByteT>, public basic_mmap<AccessMode, ByteT>
@@ -54,6 +57,7 @@ public:
 	mmap_streambuf(mmap_type&& m)
     : mmap_type(std::move(m))
     {
+        state.base = this->file_offset();
         resetptrs();
     }
 
@@ -62,19 +66,76 @@ public:
     : mmap_streambuf(mmap_type(path, offset, length))
     {}
 
+    /**
+     * Opens the file at `path` with the semantics of `std::basic_filebuf::open`.
+     *
+     * A read-write stream opened with `trunc`, or with just `out`, discards the
+     * previous contents of the file. `app`, `ate` and `in | out` keep them, and
+     * the file is only ever truncated back to its logical end when the stream is
+     * destroyed. When `app` is given without `in`, only the last page of the file
+     * is mapped, so appending to a large file does not map all of it.
+     *
+     * Stream positions are always relative to the start of the file.
+     */
+    template<typename String>
+    mmap_streambuf(const String& path, std::ios_base::openmode mode)
+    {
+        std::error_code error;
+        open(path, mode, error);
+        if (error)
+            throw std::system_error(std::move(error));
+    }
+
     virtual ~mmap_streambuf()
     {
         if constexpr (AccessMode == access_mode::write)
         {
-            if (state.high_water > 0)
+            if (this->is_open() && static_cast<off_type>(size()) != state.high_water)
             {
                 std::error_code error;
-                truncate(state.high_water, error);
+                truncate(state.base + state.high_water, error);
                 assert(!error);
             }
         }
     }
 
+    /**
+     * Makes reads that reach the end of the file wait for another process to append
+     * to it, and then carry on with the new data, as `tail -f` does. The end of the
+     * file is only seen once `options.timeout` passes without it growing or
+     * `stop_following` is called. Address space is reserved for the mapping to grow
+     * into, so that the data already read isn't mapped again. Upon failure, `error`
+     * is set and reads stop at the end of the file as before.
+     */
+    template<access_mode A = AccessMode>
+    typename std::enable_if<A == access_mode::read, void>::type
+    follow(const follow_options& options, std::error_code& error)
+    {
+        auto follower = std::make_unique<file_follower>();
+        follower->open(this->file_handle(), options, error);
+        if (error)
+            return;
+
+        this->reserve(size() + options.capacity, error);
+        if (error)
+            return;
+
+        resetptrs();
+        follower_ = std::move(follower);
+    }
+
+    /**
+     * Wakes up a reader waiting for the file to grow, which then sees the end of the
+     * file. This may be called from any thread.
+     */
+    void stop_following()
+    {
+        if (follower_)
+            follower_->stop();
+    }
+
+    bool is_following() const noexcept { return follower_ && !follower_->is_stopped(); }
+
 protected:
 
     pos_type seekoff(off_type off, std::ios_base::seekdir dir,
@@ -87,13 +148,13 @@ protected:
 
         case std::ios_base::cur:
             if (which & std::ios_base::out)
-                off += static_cast<off_type>(pptr() - pbase());
+                off += state.base + static_cast<off_type>(pptr() - pbase());
             else
-                off += static_cast<off_type>(gptr() - eback());
+                off += state.base + static_cast<off_type>(gptr() - eback());
             break;
 
         case std::ios_base::end:
-            off = size() - off;
+            off += state.base + endoff();
             break;
 
         default:
@@ -109,7 +170,8 @@ protected:
     pos_type seekpos(pos_type pos,
         std::ios_base::openmode which = std::ios_base::in | std::ios_base::out) override
     {
-        if (pos < 0 || !seekptr(const_cast<char_type*>(data()) + static_cast<ptrdiff_t>(pos), which))
+        const off_type off = static_cast<off_type>(pos) - state.base;
+        if (off < 0 || !seekptr(const_cast<char_type*>(data()) + static_cast<ptrdiff_t>(off), which))
 		    return -1;
 
 	    return pos;
@@ -127,11 +189,14 @@ protected:
     {
         if constexpr (AccessMode == access_mode::write)
         {
+            if (state.mode & std::ios_base::app)
+                setpoff(state.high_water);
+
             if (epptr() - pptr() < n)
             {
                 std::error_code error;
                 off_type poffset = pptr() - pbase();
-                remap(std::max(2 * size(), page_size() + make_offset_page_aligned(static_cast<size_type>(poffset + n))), error);
+                remap(state.base, std::max(2 * size(), page_size() + make_offset_page_aligned(static_cast<size_type>(poffset + n))), error);
                 if (error)
                     throw std::system_error(std::move(error));
 
@@ -139,7 +204,7 @@ protected:
             }
 
             std::copy(s, s + n, pptr());
-            pbump(n);
+            pbumpn(n);
             phwset(pptr() - pbase());
 
             return n;
@@ -151,10 +216,17 @@ protected:
 	std::streamsize xsgetn(char_type* s, std::streamsize n) override
 	{
         // todo: generate underflow if subrange is mapped
-		std::ptrdiff_t count = std::min(egptr() - gptr(), n);
+		std::streamsize count = 0;
+        for (;;)
+        {
+            const std::streamsize chunk = std::min<std::streamsize>(egptr() - gptr(), n - count);
+            std::copy(gptr(), gptr() + chunk, s + count);
+            gbumpn(chunk);
+            count += chunk;
 
-		std::copy(gptr(), gptr() + count, s);
-        gbump(count);
+            if (count == n || !follow_file())
+                break;
+        }
 
 		return count;
 	}
@@ -165,11 +237,14 @@ protected:
         {
             if constexpr (AccessMode == access_mode::write)
             {
+                if (state.mode & std::ios_base::app)
+                    setpoff(state.high_water);
+
                 if (epptr() - pptr() < 1)
                 {
                     std::error_code error;
                     off_type poffset = pptr() - pbase();
-                    remap(std::max(2 * size(), page_size() + make_offset_page_aligned(static_cast<size_type>(poffset))), error);
+                    remap(state.base, std::max(2 * size(), page_size() + make_offset_page_aligned(static_cast<size_type>(poffset))), error);
                     if (error)
                         throw std::system_error(std::move(error));
 
@@ -192,7 +267,10 @@ protected:
     int_type underflow() override
     {
         // needs remap if subrange is mapped
-        return (gptr() >= egptr() || gptr() < eback() ? traits_type::eof() : traits_type::to_int_type(*gptr()));
+        if ((gptr() >= egptr() || gptr() < eback()) && !follow_file())
+            return traits_type::eof();
+
+        return traits_type::to_int_type(*gptr());
     }
 
     int_type pbackfail(int_type ch) override
@@ -217,20 +295,112 @@ protected:
 
 private:
 
+    template<typename String>
+    void open(const String& path, std::ios_base::openmode mode, std::error_code& error)
+    {
+        if constexpr (AccessMode == access_mode::write)
+        {
+            const bool preserve = !(mode & std::ios_base::trunc)
+                && (mode & (std::ios_base::in | std::ios_base::app | std::ios_base::ate));
+
+            // The end of the existing contents must be known before mapping, as
+            // opening an empty file for writing extends it to a page.
+            off_type end = 0;
+            if (preserve)
+            {
+                const auto handle = detail::open_file(path, access_mode::read, error);
+                if (!error)
+                {
+                    end = detail::query_file_size(handle, error);
+                    detail::close_file(handle);
+                }
+                if (error == std::errc::no_such_file_or_directory)
+                    error.clear();
+                if (error)
+                    return;
+            }
+
+            size_type offset = 0;
+            size_type length = map_entire_file;
+            if ((mode & std::ios_base::app) && !(mode & std::ios_base::in) && end > 0)
+            {
+                // Map only the page holding the last byte, which is all that
+                // appending needs, and grow from there.
+                offset = make_offset_page_aligned(static_cast<size_type>(end - 1));
+                length = static_cast<size_type>(end) - offset;
+            }
+
+            this->map(path, offset, length, error);
+            if (error)
+                return;
+
+            state.mode = mode;
+            state.base = this->file_offset();
+            state.high_water = end - state.base;
+            resetptrs();
+
+            if (mode & (std::ios_base::app | std::ios_base::ate))
+            {
+                setpoff(state.high_water);
+                setgoff(state.high_water);
+            }
+        }
+        else
+        {
+            this->map(path, error);
+            if (error)
+                return;
+
+            state.base = this->file_offset();
+            resetptrs();
+
+            if (mode & std::ios_base::ate)
+                setgoff(size());
+        }
+    }
+
+    // Waits for the file to grow past the end of the stream when following it, and
+    // extends the get area to the new end. Returns whether there is more to read.
+    bool follow_file()
+    {
+        if constexpr (AccessMode == access_mode::read)
+        {
+            if (!follower_ || gptr() < eback())
+                return false;
+
+            std::error_code error;
+            mio::follow(static_cast<mmap_type&>(*this), *follower_, error);
+            // The stream resets its pointers after growing, so it may move the mapping
+            // once the file outgrows the address space reserved for it.
+            while (error == std::errc::not_enough_memory)
+            {
+                this->reserve(std::max(2 * this->capacity(), page_size()), error);
+                if (!error)
+                    this->extend_to_file(error);
+            }
+            resetptrs();
+            return !error && gptr() < egptr();
+        }
+        else
+        {
+            return false;
+        }
+    }
+
     void resetptrs()
     {
         if constexpr (AccessMode == access_mode::write)
         {
             off_type poffset = pptr() - pbase();
             setp(data(), data() + size());
-            pbump(poffset);
+            pbumpn(poffset);
             phwset(poffset);
 
             off_type goffset = gptr() - eback();
             setg(const_cast<char_type*>(data()),
                 const_cast<char_type*>(data()),
                 const_cast<char_type*>(data()) + state.high_water);
-            gbump(goffset);
+            gbumpn(goffset);
         }
         else
         {
@@ -238,10 +408,46 @@ private:
             setg(const_cast<char_type*>(data()),
                 const_cast<char_type*>(data()),
                 const_cast<char_type*>(data()) + size());
-            gbump(goffset);
+            gbumpn(goffset);
         }
     }
 
+    // The logical end of the stream relative to `data()`.
+    off_type endoff() const
+    {
+        if constexpr (AccessMode == access_mode::write)
+            return state.high_water;
+        else
+            return static_cast<off_type>(size());
+    }
+
+    // `pbump` and `gbump` take an `int`, which does not cover large mappings.
+    void pbumpn(off_type n)
+    {
+        for (; n > std::numeric_limits<int>::max(); n -= std::numeric_limits<int>::max())
+            pbump(std::numeric_limits<int>::max());
+        pbump(static_cast<int>(n));
+    }
+
+    void gbumpn(off_type n)
+    {
+        for (; n > std::numeric_limits<int>::max(); n -= std::numeric_limits<int>::max())
+            gbump(std::numeric_limits<int>::max());
+        gbump(static_cast<int>(n));
+    }
+
+    void setpoff(off_type poffset)
+    {
+        setp(pbase(), epptr());
+        pbumpn(poffset);
+    }
+
+    void setgoff(off_type goffset)
+    {
+        setg(eback(), eback(), egptr());
+        gbumpn(goffset);
+    }
+
     bool seekptr(void* ptr_, std::ios_base::openmode which)
     {
         char* ptr = static_cast<char*>(ptr_);
@@ -253,8 +459,7 @@ private:
                 if (ptr >= pbase() && ptr < epptr())
                 {
                     off_type poffset = ptr - pbase();
-                    setp(pbase(), epptr());
-                    pbump(poffset);
+                    setpoff(poffset);
                     phwset(poffset);
                 }
                 else
@@ -283,9 +488,16 @@ private:
             state.high_water = poffset;
     }
 
-    struct ReadAccessState {};
-    struct WriteAccessState { off_type high_water = 0; };
+    // `base` is the file offset of `data()`, which lets positions be reported
+    // relative to the start of the file when only its tail is mapped.
+    struct ReadAccessState { off_type base = 0; };
+    struct WriteAccessState : ReadAccessState
+    {
+        off_type high_water = 0;
+        std::ios_base::openmode mode = std::ios_base::out | std::ios_base::trunc;
+    };
     std::conditional_t<AccessMode == access_mode::write, WriteAccessState, ReadAccessState> state;
+    std::unique_ptr<file_follower> follower_;
 };
 
 using mmap_istreambuf = mmap_streambuf<access_mode::read>;
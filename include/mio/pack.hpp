@@ -0,0 +1,452 @@
+#ifndef MIO_PACK_HEADER
+#define MIO_PACK_HEADER
+
+#include "mio/mmap.hpp"
+#include "mio/span.hpp"
+#include "mio/detail/growing_sink.hpp"
+#include "mio/detail/hash.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace mio {
+
+namespace detail {
+
+/**
+ * The on-disk layout shared by `pack_writer` and `pack_reader`, in the byte order
+ * of the machine that wrote it:
+ *
+ *   header | entry data, each aligned | slots | names
+ *
+ * The slots form an open-addressing hash table of a power of two size, at most half
+ * full, probed linearly from the slot the hash of the name selects.
+ */
+namespace pack_format {
+
+struct header
+{
+    char magic[8];
+    uint64_t count;
+    uint64_t slot_count;
+    uint64_t slots_offset;
+    uint64_t names_offset;
+    uint64_t names_size;
+    uint64_t alignment;
+    uint64_t checksum;
+};
+
+struct slot
+{
+    uint64_t hash;
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint64_t name_offset;
+    uint32_t name_length;
+    uint32_t used;
+};
+
+constexpr size_t header_size = 64;
+
+inline const char* magic() noexcept { return "MIOPACK1"; }
+
+inline uint64_t header_checksum(const header& h) noexcept
+{
+    return fnv1a(&h, offsetof(header, checksum));
+}
+
+inline size_t align(size_t n, size_t alignment) noexcept
+{
+    return (n + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace pack_format
+} // namespace detail
+
+struct pack_options
+{
+    // Entries start at a multiple of this many bytes, a power of two, so that their
+    // contents may be accessed in place as arrays of suitably aligned types.
+    size_t alignment = 16;
+
+    // Initial size of the archive file, which doubles whenever it fills up.
+    size_t initial_capacity = 1 << 20;
+};
+
+/**
+ * Writes many small files into a single archive, to be mapped at once by
+ * `pack_reader`.
+ *
+ * Mapping each of many small files separately costs a mapping, and a partly used
+ * page, per file, as well as the system calls to open and map it. An archive costs
+ * one of each, and looking up an entry by name is a probe into a hash table.
+ *
+ * Entries are written through a growing `mmap_sink` as they are added, while their
+ * names are kept in memory until `close` appends the directory. Names must be
+ * unique; duplicates are only detected on `close`. A writer is not thread-safe.
+ */
+class pack_writer
+{
+public:
+    using size_type = size_t;
+
+    pack_writer() = default;
+    pack_writer(const pack_writer&) = delete;
+    pack_writer& operator=(const pack_writer&) = delete;
+
+#ifdef __cpp_exceptions
+    /**
+     * The same as invoking the `open` function, except any error that may occur
+     * while creating the archive is wrapped in a `std::system_error` and is thrown.
+     */
+    template<typename String>
+    explicit pack_writer(const String& path, const pack_options& options = pack_options())
+    {
+        std::error_code error;
+        open(path, options, error);
+        if(error) { throw std::system_error(error); }
+    }
+#endif // __cpp_exceptions
+
+    /** Writes the directory and closes the archive, ignoring errors. */
+    ~pack_writer()
+    {
+        std::error_code error;
+        close(error);
+    }
+
+    /**
+     * Creates the archive at `path`, replacing any file there. Upon failure, `error`
+     * is set and the writer remains closed.
+     */
+    template<typename String>
+    void open(const String& path, const pack_options& options, std::error_code& error)
+    {
+        close(error);
+        if(error) { return; }
+        const size_type alignment = options.alignment;
+        if(alignment == 0 || (alignment & (alignment - 1)) != 0)
+        {
+            error = std::make_error_code(std::errc::invalid_argument);
+            return;
+        }
+        file_.open(path, detail::pack_format::header_size, options.initial_capacity, error);
+        if(error) { return; }
+        alignment_ = alignment;
+        end_ = detail::pack_format::header_size;
+    }
+
+    /** Adds an entry named `name` holding the `size` bytes at `data`. */
+    void add(const std::string& name, const void* data, size_type size, std::error_code& error)
+    {
+        error.clear();
+        if(!is_open())
+        {
+            error = std::make_error_code(std::errc::bad_file_descriptor);
+            return;
+        }
+        if(name.size() > UINT32_MAX)
+        {
+            error = std::make_error_code(std::errc::filename_too_long);
+            return;
+        }
+        const size_type offset = detail::pack_format::align(end_, alignment_);
+        file_.reserve(offset + size, error);
+        if(error) { return; }
+        std::memset(file_.data() + end_, 0, offset - end_);
+        if(size > 0) { std::memcpy(file_.data() + offset, data, size); }
+
+        entry e;
+        e.hash = detail::fnv1a(name.data(), name.size());
+        e.data_offset = offset;
+        e.data_size = size;
+        e.name_offset = names_.size();
+        e.name_length = static_cast<uint32_t>(name.size());
+        entries_.push_back(e);
+        names_ += name;
+        end_ = offset + size;
+    }
+
+    /** Adds an entry named `name` holding the contents of the file at `path`. */
+    template<typename String>
+    void add_file(const std::string& name, const String& path, std::error_code& error)
+    {
+        error.clear();
+        const auto handle = detail::open_file(path, access_mode::read, error);
+        if(error) { return; }
+        const auto size = detail::query_file_size(handle, error);
+        mmap_source source;
+        if(!error && size > 0) { source.map(handle, 0, map_entire_file, error); }
+        if(!error) { add(name, source.data(), source.size(), error); }
+        source.unmap();
+        detail::close_file(handle);
+    }
+
+    /**
+     * Writes the directory and the header, shrinks the file to its contents and
+     * syncs it, then closes it. Fails with `file_exists` if two entries have the
+     * same name, in which case the archive is left without a valid header.
+     */
+    void close(std::error_code& error)
+    {
+        error.clear();
+        if(!is_open()) { return; }
+        write_directory(error);
+        file_.close();
+        clear();
+    }
+
+    bool is_open() const noexcept { return file_.is_open(); }
+
+    /** Returns the number of entries added. */
+    size_type size() const noexcept { return entries_.size(); }
+
+    /** Returns the number of bytes written so far, not counting the directory. */
+    size_type data_size() const noexcept { return end_; }
+
+private:
+    struct entry
+    {
+        uint64_t hash;
+        uint64_t data_offset;
+        uint64_t data_size;
+        uint64_t name_offset;
+        uint32_t name_length;
+    };
+
+    void write_directory(std::error_code& error)
+    {
+        namespace format = detail::pack_format;
+        size_type slot_count = 2;
+        while(slot_count < 2 * entries_.size()) { slot_count *= 2; }
+        const size_type slots_offset = format::align(end_, alignof(format::slot));
+        const size_type names_offset = slots_offset + slot_count * sizeof(format::slot);
+        const size_type total_size = names_offset + names_.size();
+        file_.reserve(total_size, error);
+        if(error) { return; }
+
+        char* const base = file_.data();
+        std::memset(base + end_, 0, names_offset - end_);
+        auto* const slots = reinterpret_cast<format::slot*>(base + slots_offset);
+        for(const entry& e : entries_)
+        {
+            size_type i = e.hash & (slot_count - 1);
+            for(; slots[i].used; i = (i + 1) & (slot_count - 1))
+            {
+                if(slots[i].hash == e.hash && slots[i].name_length == e.name_length
+                   && names_.compare(slots[i].name_offset, e.name_length,
+                        names_, e.name_offset, e.name_length) == 0)
+                {
+                    error = std::make_error_code(std::errc::file_exists);
+                    return;
+                }
+            }
+            slots[i].hash = e.hash;
+            slots[i].data_offset = e.data_offset;
+            slots[i].data_size = e.data_size;
+            slots[i].name_offset = e.name_offset;
+            slots[i].name_length = e.name_length;
+            slots[i].used = 1;
+        }
+        std::memcpy(base + names_offset, names_.data(), names_.size());
+
+        format::header header;
+        std::memcpy(header.magic, format::magic(), sizeof(header.magic));
+        header.count = entries_.size();
+        header.slot_count = slot_count;
+        header.slots_offset = slots_offset;
+        header.names_offset = names_offset;
+        header.names_size = names_.size();
+        header.alignment = alignment_;
+        header.checksum = format::header_checksum(header);
+        file_.finish(&header, sizeof(header), total_size, error);
+    }
+
+    void clear()
+    {
+        entries_.clear();
+        names_.clear();
+        end_ = 0;
+    }
+
+    detail::growing_sink file_;
+    std::vector<entry> entries_;
+    std::string names_;
+    size_type alignment_ = 1;
+    size_type end_ = 0;
+};
+
+/**
+ * Maps an archive written by `pack_writer` and looks up its entries by name.
+ *
+ * The archive is mapped once; the spans returned point into the mapping, so they
+ * remain valid until the reader is closed. Only the header is checked when the
+ * archive is opened; entries that point outside of the file are treated as missing.
+ * Lookups may be made from any number of threads.
+ */
+class pack_reader
+{
+public:
+    using size_type = size_t;
+    using span_type = span<const char>;
+
+    pack_reader() = default;
+
+#ifdef __cpp_exceptions
+    /**
+     * The same as invoking the `open` function, except any error that may occur
+     * while opening the archive is wrapped in a `std::system_error` and is thrown.
+     */
+    template<typename String>
+    explicit pack_reader(const String& path, const open_options& options = open_options())
+    {
+        std::error_code error;
+        open(path, options, error);
+        if(error) { throw std::system_error(error); }
+    }
+#endif // __cpp_exceptions
+
+    /**
+     * Maps the archive at `path`. Fails with `invalid_argument` if it isn't a valid
+     * archive, in which case the reader remains closed.
+     */
+    template<typename String>
+    void open(const String& path, const open_options& options, std::error_code& error)
+    {
+        close();
+        file_.map(path, 0, map_entire_file, options, error);
+        if(error) { return; }
+        if(!read_header())
+        {
+            close();
+            error = std::make_error_code(std::errc::invalid_argument);
+        }
+    }
+
+    template<typename String>
+    void open(const String& path, std::error_code& error)
+    {
+        open(path, open_options(), error);
+    }
+
+    void close()
+    {
+        file_.unmap();
+        slots_ = nullptr;
+        names_ = nullptr;
+        count_ = slot_count_ = names_size_ = 0;
+    }
+
+    bool is_open() const noexcept { return file_.is_open(); }
+
+    /** Returns the number of entries in the archive. */
+    size_type size() const noexcept { return count_; }
+    bool empty() const noexcept { return count_ == 0; }
+
+    const mmap_source& mmap() const noexcept { return file_; }
+
+    /**
+     * Returns the contents of the entry named by the `length` bytes at `name`, or an
+     * empty span with a null `data` if there is none.
+     */
+    span_type find(const char* name, size_type length) const noexcept
+    {
+        if(slot_count_ == 0) { return span_type(); }
+        const uint64_t hash = detail::fnv1a(name, length);
+        // The probes are bounded in case a damaged archive has no free slot left.
+        size_type i = hash & (slot_count_ - 1);
+        for(size_type probes = 0; probes < slot_count_ && slots_[i].used;
+            ++probes, i = (i + 1) & (slot_count_ - 1))
+        {
+            const auto& slot = slots_[i];
+            if(slot.hash == hash && slot.name_length == length && length <= names_size_
+               && slot.name_offset <= names_size_ - length
+               && std::memcmp(names_ + slot.name_offset, name, length) == 0)
+            {
+                return entry_data(slot);
+            }
+        }
+        return span_type();
+    }
+
+    span_type find(const std::string& name) const noexcept
+    {
+        return find(name.data(), name.size());
+    }
+
+    bool contains(const std::string& name) const noexcept
+    {
+        return find(name).data() != nullptr;
+    }
+
+    /** Invokes `f` with the name and the contents of each entry, in no given order. */
+    template<typename F>
+    void for_each(F f) const
+    {
+        for(size_type i = 0; i < slot_count_; ++i)
+        {
+            const auto& slot = slots_[i];
+            if(!slot.used || slot.name_offset > names_size_
+               || slot.name_length > names_size_ - slot.name_offset)
+            {
+                continue;
+            }
+            const span_type data = entry_data(slot);
+            if(data.data()) { f(span_type(names_ + slot.name_offset, slot.name_length), data); }
+        }
+    }
+
+private:
+    bool read_header() noexcept
+    {
+        namespace format = detail::pack_format;
+        const size_type file_size = file_.size();
+        format::header header;
+        if(file_size < format::header_size) { return false; }
+        std::memcpy(&header, file_.data(), sizeof(header));
+        if(std::memcmp(header.magic, format::magic(), sizeof(header.magic)) != 0
+           || header.checksum != format::header_checksum(header)
+           || header.slot_count == 0 || (header.slot_count & (header.slot_count - 1)) != 0
+           || header.count > header.slot_count / 2
+           || header.slots_offset % alignof(format::slot) != 0
+           || header.slots_offset > file_size
+           || header.slot_count > (file_size - header.slots_offset) / sizeof(format::slot)
+           || header.names_offset < header.slots_offset + header.slot_count * sizeof(format::slot)
+           || header.names_offset > file_size
+           || header.names_size > file_size - header.names_offset)
+        {
+            return false;
+        }
+        slots_ = reinterpret_cast<const format::slot*>(file_.data() + header.slots_offset);
+        names_ = file_.data() + header.names_offset;
+        count_ = header.count;
+        slot_count_ = header.slot_count;
+        names_size_ = header.names_size;
+        return true;
+    }
+
+    span_type entry_data(const detail::pack_format::slot& slot) const noexcept
+    {
+        const size_type file_size = file_.size();
+        if(slot.data_offset > file_size || slot.data_size > file_size - slot.data_offset)
+        {
+            return span_type();
+        }
+        return span_type(file_.data() + slot.data_offset, slot.data_size);
+    }
+
+    mmap_source file_;
+    const detail::pack_format::slot* slots_ = nullptr;
+    const char* names_ = nullptr;
+    size_type count_ = 0;
+    size_type slot_count_ = 0;
+    size_type names_size_ = 0;
+};
+
+} // namespace mio
+
+#endif // MIO_PACK_HEADER
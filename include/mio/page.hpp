@@ -21,10 +21,13 @@
 #ifndef MIO_PAGE_HEADER
 #define MIO_PAGE_HEADER
 
+#include <cstddef>
+
 #ifdef _WIN32
 # include <windows.h>
 #else
 # include <unistd.h>
+# include <sys/mman.h>
 #endif
 
 namespace mio {
@@ -73,6 +76,65 @@ inline size_t make_offset_page_aligned(size_t offset) noexcept
     return offset / page_size_ * page_size_;
 }
 
+/**
+ * Returns whether all pages overlapping the `length` bytes at `address`, which must
+ * lie within a memory mapping, are resident in memory, i.e. whether accessing them
+ * won't incur a major page fault. This is a snapshot; pages may be evicted at any
+ * time after the call.
+ *
+ * Residency cannot be queried on Windows, where all pages are reported resident.
+ */
+inline bool is_resident(const void* address, size_t length) noexcept
+{
+#ifdef _WIN32
+    (void)address;
+    (void)length;
+    return true;
+#else
+    if(length == 0) { return true; }
+    const size_t page_size_ = page_size();
+    const size_t start = make_offset_page_aligned(reinterpret_cast<size_t>(address));
+    const size_t end = reinterpret_cast<size_t>(address) + length;
+    // Query in fixed size batches so as not to allocate.
+    unsigned char vec[64];
+    for(size_t pos = start; pos < end; pos += sizeof(vec) * page_size_)
+    {
+        const size_t batch = end - pos < sizeof(vec) * page_size_
+            ? end - pos : sizeof(vec) * page_size_;
+        if(::mincore(reinterpret_cast<void*>(pos), batch, vec) != 0) { return false; }
+        const size_t num_pages = (batch + page_size_ - 1) / page_size_;
+        for(size_t i = 0; i < num_pages; ++i)
+        {
+            if(!(vec[i] & 1)) { return false; }
+        }
+    }
+    return true;
+#endif
+}
+
+/**
+ * Populates the pages overlapping the `length` bytes at `address`, which must lie
+ * within a memory mapping, by hinting the kernel to read them ahead and then
+ * touching each of them. This blocks until all pages are resident, and is meant to
+ * be run off the thread that is going to access the data.
+ */
+inline void prefault(const void* address, size_t length) noexcept
+{
+    if(length == 0) { return; }
+    const size_t page_size_ = page_size();
+    const size_t start = make_offset_page_aligned(reinterpret_cast<size_t>(address));
+    const size_t end = reinterpret_cast<size_t>(address) + length;
+#ifndef _WIN32
+    ::madvise(reinterpret_cast<void*>(start), end - start, MADV_WILLNEED);
+#endif
+    for(size_t pos = start; pos < end; pos += page_size_)
+    {
+        // The first page may start before `address`, but it is still part of the
+        // same mapping, as mappings are page aligned.
+        (void)*reinterpret_cast<const volatile char*>(pos);
+    }
+}
+
 } // namespace mio
 
 #endif // MIO_PAGE_HEADER
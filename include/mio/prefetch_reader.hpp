@@ -0,0 +1,267 @@
+#ifndef MIO_PREFETCH_READER_HEADER
+#define MIO_PREFETCH_READER_HEADER
+
+#include "mio/chunk_reader.hpp"
+#include "mio/mmap.hpp"
+#include "mio/page.hpp"
+#include "mio/span.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#ifndef _WIN32
+# include <sys/mman.h>
+#endif
+
+namespace mio {
+
+struct prefetch_options
+{
+    size_t chunk_size = 256 << 10;
+
+    // How far ahead of the current chunk pages are requested with `MADV_WILLNEED`.
+    // The distance starts at `distance`, grows, up to `max_distance`, with the time
+    // the consumer stalls on page faults, and shrinks by a chunk, down to
+    // `min_distance`, after a whole distance's worth of chunks found resident.
+    size_t distance = 4 << 20;
+    size_t min_distance = 1 << 20;
+    size_t max_distance = 64 << 20;
+
+    // A stall grows the distance by a chunk for every `stall_threshold` it lasted,
+    // at most doubling it, so stalls shorter than this, such as faulting in the
+    // few pages of a chunk that readahead missed, leave it as it is.
+    std::chrono::nanoseconds stall_threshold = std::chrono::microseconds(50);
+
+    // Whether a helper thread touches the pages ahead of the consumer, so that they
+    // are not only cached but also mapped by the time it gets there.
+    bool use_helper_thread = false;
+
+    // Number of cache lines at the start of each chunk prefetched into the CPU cache.
+    size_t cache_lines = 8;
+};
+
+/**
+ * Reads a mapping in consecutive chunks, like `basic_mmap_chunk_reader`, while
+ * keeping the pages ahead of the consumer on their way into memory, so that it
+ * doesn't stall on page faults where the kernel's readahead falls short.
+ *
+ * Before a chunk is returned, its residency is checked: a resident chunk counts as
+ * a hit. A chunk that isn't is a miss, and is faulted in right away, the time it
+ * takes counting as stall time; the prefetch distance is then increased in
+ * proportion to that time, so that it only grows when prefetching fell behind.
+ *
+ * The reader does not own the mapping, which must outlive it. It is not
+ * thread-safe, apart from its helper thread.
+ */
+template<typename ByteT>
+class basic_mmap_prefetch_reader
+{
+public:
+    using value_type = ByteT;
+    using size_type = size_t;
+    using span_type = span<const ByteT>;
+    using iterator = chunk_iterator<basic_mmap_prefetch_reader>;
+    using duration = std::chrono::nanoseconds;
+
+    struct statistics
+    {
+        // Number of chunks that were and weren't resident when returned.
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        // Time spent faulting in chunks that weren't resident.
+        duration stall_time = duration::zero();
+        // Number of bytes advised with `MADV_WILLNEED` and touched by the helper.
+        uint64_t bytes_advised = 0;
+        uint64_t bytes_touched = 0;
+        // The prefetch distance currently in use.
+        size_t distance = 0;
+
+        uint64_t chunks() const noexcept { return hits + misses; }
+
+        double hit_rate() const noexcept
+        {
+            return chunks() == 0 ? 0.0 : static_cast<double>(hits) / chunks();
+        }
+    };
+
+    template<typename MMap>
+    basic_mmap_prefetch_reader(const MMap& mmap, prefetch_options options = prefetch_options())
+        : data_(mmap.data())
+        , size_(mmap.size())
+        , options_(options)
+    {
+        options_.chunk_size = std::max<size_type>(options_.chunk_size, 1);
+        options_.min_distance = std::max(options_.min_distance, options_.chunk_size);
+        options_.max_distance = std::max(options_.max_distance, options_.min_distance);
+        options_.stall_threshold = std::max(options_.stall_threshold, duration(1));
+        distance_ = std::min(std::max(options_.distance, options_.min_distance),
+            options_.max_distance);
+        if(options_.use_helper_thread) { helper_ = std::thread([this] { run(); }); }
+    }
+
+    basic_mmap_prefetch_reader(const basic_mmap_prefetch_reader&) = delete;
+    basic_mmap_prefetch_reader& operator=(const basic_mmap_prefetch_reader&) = delete;
+
+    ~basic_mmap_prefetch_reader()
+    {
+        if(!helper_.joinable()) { return; }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        helper_.join();
+    }
+
+    /**
+     * Sets `chunk` to the next chunk and returns true, or returns false at the end
+     * of the mapping. Mappings can't fail to be read, so `error` is always cleared.
+     */
+    bool next(span_type& chunk, std::error_code& error)
+    {
+        error.clear();
+        if(position_ >= size_) { return false; }
+        chunk = span_type(data_, size_).subspan(position_, options_.chunk_size);
+
+        if(is_resident(chunk.data(), chunk.size()))
+        {
+            ++stats_.hits;
+            if(++hits_in_row_ * options_.chunk_size >= distance_)
+            {
+                hits_in_row_ = 0;
+                distance_ = std::max(distance_ - std::min(distance_, options_.chunk_size),
+                    options_.min_distance);
+            }
+        }
+        else
+        {
+            ++stats_.misses;
+            hits_in_row_ = 0;
+            const auto start = std::chrono::steady_clock::now();
+            prefault(chunk.data(), chunk.size());
+            const duration stall = std::chrono::steady_clock::now() - start;
+            stats_.stall_time += stall;
+            grow_distance(stall);
+        }
+
+        position_ += chunk.size();
+        prefetch_ahead();
+        prefetch_cache_lines(chunk);
+        return true;
+    }
+
+    iterator begin() { return iterator(*this); }
+    iterator end() { return iterator(); }
+
+    size_type size() const noexcept { return size_; }
+    size_type position() const noexcept { return position_; }
+    size_type chunk_size() const noexcept { return options_.chunk_size; }
+    std::error_code error() const noexcept { return std::error_code(); }
+
+    statistics stats() const
+    {
+        statistics stats = stats_;
+        stats.bytes_touched = bytes_touched_.load();
+        stats.distance = distance_;
+        return stats;
+    }
+
+private:
+    /** Grows the distance by a chunk for every `stall_threshold` of `stall`. */
+    void grow_distance(duration stall) noexcept
+    {
+        const uint64_t chunks = stall / options_.stall_threshold;
+        if(chunks == 0) { return; }
+        const size_type growth = chunks >= distance_ / options_.chunk_size
+            ? distance_ : static_cast<size_type>(chunks) * options_.chunk_size;
+        distance_ = std::min(distance_ + growth, options_.max_distance);
+    }
+
+    /** Advises the range up to `distance_` ahead of the position, in batches. */
+    void prefetch_ahead()
+    {
+        const size_type target = std::min(size_, position_ + distance_);
+        advised_ = std::max(advised_, position_);
+        // Advising half a distance at a time keeps the number of calls down.
+        if(target > advised_ && (target - advised_ >= distance_ / 2 || target == size_))
+        {
+#ifndef _WIN32
+            const size_t start = make_offset_page_aligned(reinterpret_cast<size_t>(data_ + advised_));
+            const size_t end = reinterpret_cast<size_t>(data_ + target);
+            ::madvise(reinterpret_cast<void*>(start), end - start, MADV_WILLNEED);
+#endif
+            stats_.bytes_advised += target - advised_;
+            advised_ = target;
+        }
+
+        if(helper_.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                consumer_position_ = position_;
+                if(target <= helper_target_) { return; }
+                helper_target_ = target;
+            }
+            cv_.notify_one();
+        }
+    }
+
+    void prefetch_cache_lines(const span_type& chunk) const noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        const size_type length = std::min(chunk.size(), options_.cache_lines * 64);
+        for(size_type i = 0; i < length; i += 64) { __builtin_prefetch(chunk.data() + i); }
+#else
+        (void)chunk;
+#endif
+    }
+
+    /** Touches the pages between the consumer and the target, a chunk at a time. */
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        size_type touched = 0;
+        for(;;)
+        {
+            cv_.wait(lock, [&] { return stop_ || std::max(touched, consumer_position_) < helper_target_; });
+            if(stop_) { return; }
+            const size_type begin = std::max(touched, consumer_position_);
+            const size_type end = std::min(helper_target_, begin + options_.chunk_size);
+            lock.unlock();
+            prefault(data_ + begin, end - begin);
+            bytes_touched_ += end - begin;
+            lock.lock();
+            touched = end;
+        }
+    }
+
+    const ByteT* data_;
+    size_type size_;
+    prefetch_options options_;
+    size_type position_ = 0;
+    size_type distance_;
+    size_type advised_ = 0;
+    size_type hits_in_row_ = 0;
+    statistics stats_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    size_type consumer_position_ = 0;
+    size_type helper_target_ = 0;
+    bool stop_ = false;
+    std::atomic<uint64_t> bytes_touched_{0};
+    std::thread helper_;
+};
+
+using mmap_prefetch_reader = basic_mmap_prefetch_reader<char>;
+using ummap_prefetch_reader = basic_mmap_prefetch_reader<unsigned char>;
+
+} // namespace mio
+
+#endif // MIO_PREFETCH_READER_HEADER
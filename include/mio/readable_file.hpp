@@ -0,0 +1,434 @@
+#ifndef MIO_READABLE_FILE_HEADER
+#define MIO_READABLE_FILE_HEADER
+
+#include "mio/mmap.hpp"
+#include "mio/page.hpp"
+#include "mio/span.hpp"
+#include "mio/buffer_pool.hpp"
+#include "mio/chunk_reader.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <system_error>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+namespace mio {
+
+/** The way a `readable_file` reads its file. */
+enum class read_backend
+{
+    none,
+    // The file is memory mapped.
+    mmap,
+    // The whole file was read into a pooled buffer with a single `pread`.
+    pread,
+    // The file is read chunk by chunk into a pooled buffer as it's accessed.
+    stream
+};
+
+/**
+ * Returns the pool used by `readable_file`s unless another is given. Its buffers are
+ * large enough to hold small files and to stream chunks of reasonable size.
+ */
+inline const std::shared_ptr<buffer_pool>& default_read_buffer_pool()
+{
+    static const std::shared_ptr<buffer_pool> pool = std::make_shared<buffer_pool>(128 * 1024);
+    return pool;
+}
+
+struct readable_file_options
+{
+    access_pattern pattern = access_pattern::normal;
+
+    // Regular files of at most this size are read with a single `pread` instead of
+    // being mapped, which saves a `mmap` and `munmap` pair. It is capped by the
+    // pool's buffer size. 0 disables this.
+    size_t small_file_size = 64 * 1024;
+
+    // The pool providing the buffers for small files and streaming reads, whose
+    // buffer size is also the size of streamed chunks. If empty, the default pool
+    // is used.
+    std::shared_ptr<buffer_pool> pool;
+};
+
+/**
+ * A read-only file accessed through spans, whatever way it is actually read.
+ *
+ * On opening, the backend is chosen from the kind of file, its size and the
+ * declared access pattern:
+ *
+ * - pipes, sockets, character devices and regular files reporting a size of zero
+ *   (as many `/proc` and FUSE files do), none of which can be mapped, are streamed;
+ * - small regular files are read whole into a pooled buffer with one `pread`;
+ * - regular files accessed sequentially are streamed;
+ * - other regular files are mapped, and streamed if mapping them fails.
+ *
+ * Whatever the backend, `next` yields consecutive chunks of the file, and `read`
+ * returns the span at a given offset. Spans of mapped and small files remain valid
+ * until the file is closed, while those of streamed files are only valid until the
+ * next call to `read` or `next`, and are limited to the pool's buffer size.
+ *
+ * On Windows, files are always mapped.
+ */
+class readable_file
+{
+public:
+    using value_type = char;
+    using size_type = size_t;
+    using span_type = span<const char>;
+    using iterator = chunk_iterator<readable_file>;
+    using handle_type = file_handle_type;
+
+    readable_file() = default;
+    readable_file(const readable_file&) = delete;
+    readable_file& operator=(const readable_file&) = delete;
+
+    readable_file(readable_file&& other) { swap(other); }
+
+    readable_file& operator=(readable_file&& other)
+    {
+        if(this != &other)
+        {
+            close();
+            swap(other);
+        }
+        return *this;
+    }
+
+#ifdef __cpp_exceptions
+    /**
+     * The same as invoking the `open` function, except any error that may occur
+     * while opening the file is wrapped in a `std::system_error` and is thrown.
+     */
+    template<typename String>
+    explicit readable_file(const String& path,
+            readable_file_options options = readable_file_options())
+    {
+        std::error_code error;
+        open(path, std::move(options), error);
+        if(error) { throw std::system_error(error); }
+    }
+#endif // __cpp_exceptions
+
+    ~readable_file() { close(); }
+
+    /**
+     * Opens the file at `path`, which is closed again by `close` or on destruction.
+     * Upon failure, `error` is set to indicate the reason and the object remains
+     * closed.
+     */
+    template<typename String>
+    void open(const String& path, readable_file_options options, std::error_code& error)
+    {
+        const auto handle = detail::open_file(path, access_mode::read, error);
+        if(error) { return; }
+        open(handle, std::move(options), error);
+        if(error) { detail::close_file(handle); }
+        else { is_handle_internal_ = true; }
+    }
+
+    /**
+     * Reads the file behind `handle`, from its current position if it is not
+     * seekable. The handle is not closed by this object.
+     */
+    void open(handle_type handle, readable_file_options options, std::error_code& error)
+    {
+        error.clear();
+        close();
+        if(handle == invalid_handle)
+        {
+            error = std::make_error_code(std::errc::bad_file_descriptor);
+            return;
+        }
+
+        pool_ = options.pool ? std::move(options.pool) : default_read_buffer_pool();
+        file_handle_ = handle;
+        is_handle_internal_ = false;
+
+#ifdef _WIN32
+        (void)options;
+        open_mmap(access_pattern::normal, error);
+#else
+        struct stat sbuf;
+        if(::fstat(handle, &sbuf) == -1)
+        {
+            error = detail::last_error();
+        }
+        else if(!S_ISREG(sbuf.st_mode) || sbuf.st_size == 0)
+        {
+            open_stream(S_ISREG(sbuf.st_mode));
+        }
+        else if(static_cast<size_type>(sbuf.st_size)
+                <= std::min(options.small_file_size, pool_->buffer_size()))
+        {
+            open_pread(static_cast<size_type>(sbuf.st_size), error);
+        }
+        else if(options.pattern == access_pattern::sequential)
+        {
+            open_stream(true);
+            size_ = static_cast<size_type>(sbuf.st_size);
+        }
+        else
+        {
+            open_mmap(options.pattern, error);
+            if(error)
+            {
+                error.clear();
+                open_stream(true);
+                size_ = static_cast<size_type>(sbuf.st_size);
+            }
+        }
+#endif
+        if(error)
+        {
+            is_handle_internal_ = false;
+            close();
+        }
+    }
+
+    /** Releases the mapping or buffer and closes the file if it was opened by path. */
+    void close()
+    {
+        mmap_.unmap();
+        buffer_.release();
+        pool_.reset();
+        if(is_handle_internal_) { detail::close_file(file_handle_); }
+        file_handle_ = invalid_handle;
+        is_handle_internal_ = false;
+        backend_ = read_backend::none;
+        data_ = nullptr;
+        size_ = position_ = buffered_ = 0;
+        is_seekable_ = false;
+        error_.clear();
+    }
+
+    bool is_open() const noexcept { return backend_ != read_backend::none; }
+    read_backend backend() const noexcept { return backend_; }
+    handle_type file_handle() const noexcept { return file_handle_; }
+
+    /**
+     * Returns the size of the file, or 0 for streamed files whose size isn't known
+     * up front (see `is_size_known`).
+     */
+    size_type size() const noexcept { return size_; }
+
+    /** Returns whether the size of the file was known when it was opened. */
+    bool is_size_known() const noexcept
+    {
+        return backend_ != read_backend::stream || size_ > 0;
+    }
+
+    /** Returns the number of bytes yielded by `next` so far. */
+    size_type position() const noexcept { return position_; }
+
+    /** Returns the maximum number of bytes yielded by `next` at a time. */
+    size_type chunk_size() const noexcept
+    {
+        return backend_ == read_backend::pread ? size_ : (pool_ ? pool_->buffer_size() : 0);
+    }
+
+    /** Returns the error that stopped `next`, if any. */
+    std::error_code error() const noexcept { return error_; }
+
+    /**
+     * Returns the span of up to `length` bytes at `offset`, which is shorter at the
+     * end of the file and, for streamed files, limited to the buffer size.
+     *
+     * Files that aren't seekable, such as pipes, can only be read forward: `offset`
+     * must not be before the end of the previous read, and the bytes skipped over
+     * are discarded. Otherwise `error` is set to `invalid_seek`.
+     */
+    span_type read(size_type offset, size_type length, std::error_code& error)
+    {
+        error.clear();
+        switch(backend_)
+        {
+        case read_backend::mmap:
+        case read_backend::pread:
+            return span_type(data_, size_).subspan(offset, length);
+        case read_backend::stream:
+            return read_stream(offset, length, error);
+        default:
+            error = std::make_error_code(std::errc::bad_file_descriptor);
+            return span_type();
+        }
+    }
+
+    /**
+     * Sets `chunk` to the next chunk and returns true, or returns false at the end of
+     * the file or if reading failed, in which case `error` is set.
+     */
+    bool next(span_type& chunk, std::error_code& error)
+    {
+        if(error_) { error = error_; return false; }
+        chunk = read(position_, chunk_size(), error);
+        if(error) { error_ = error; return false; }
+        position_ += chunk.size();
+        return !chunk.empty();
+    }
+
+    iterator begin() { return iterator(*this); }
+    iterator end() { return iterator(); }
+
+    void swap(readable_file& other)
+    {
+        using std::swap;
+        swap(mmap_, other.mmap_);
+        swap(buffer_, other.buffer_);
+        swap(pool_, other.pool_);
+        swap(file_handle_, other.file_handle_);
+        swap(is_handle_internal_, other.is_handle_internal_);
+        swap(backend_, other.backend_);
+        swap(data_, other.data_);
+        swap(size_, other.size_);
+        swap(position_, other.position_);
+        swap(stream_offset_, other.stream_offset_);
+        swap(buffered_, other.buffered_);
+        swap(is_seekable_, other.is_seekable_);
+        swap(error_, other.error_);
+    }
+
+private:
+    void open_mmap(access_pattern pattern, std::error_code& error)
+    {
+        mmap_.map(file_handle_, error);
+        if(error) { return; }
+#ifndef _WIN32
+        if(pattern == access_pattern::random)
+        {
+            ::madvise(const_cast<char*>(mmap_.data() - mmap_.mapping_offset()),
+                mmap_.mapped_length(), MADV_RANDOM);
+        }
+#else
+        (void)pattern;
+#endif
+        backend_ = read_backend::mmap;
+        data_ = mmap_.data();
+        size_ = mmap_.size();
+    }
+
+#ifndef _WIN32
+    void open_pread(size_type file_size, std::error_code& error)
+    {
+        buffer_ = pool_->acquire();
+        size_type n = 0;
+        while(n < file_size)
+        {
+            const ssize_t ret = ::pread(file_handle_, buffer_.data() + n, file_size - n,
+                static_cast<off_t>(n));
+            if(ret < 0)
+            {
+                if(errno == EINTR) { continue; }
+                error = detail::last_error();
+                return;
+            }
+            if(ret == 0) { break; }
+            n += static_cast<size_type>(ret);
+        }
+        backend_ = read_backend::pread;
+        data_ = buffer_.data();
+        size_ = n;
+    }
+
+    void open_stream(bool is_seekable)
+    {
+        buffer_ = pool_->acquire();
+        backend_ = read_backend::stream;
+        is_seekable_ = is_seekable;
+        stream_offset_ = 0;
+        buffered_ = 0;
+    }
+
+    span_type read_stream(size_type offset, size_type length, std::error_code& error)
+    {
+        length = std::min(length, buffer_.size());
+        if(is_seekable_)
+        {
+            const ssize_t n = pread_retry(buffer_.data(), length, offset);
+            if(n < 0) { error = detail::last_error(); return span_type(); }
+            return span_type(buffer_.data(), static_cast<size_type>(n));
+        }
+
+        // `stream_offset_` is the file offset of the buffer's first byte, of which
+        // `buffered_` are valid. Bytes still in the buffer can be returned again.
+        if(offset < stream_offset_)
+        {
+            error = std::make_error_code(std::errc::invalid_seek);
+            return span_type();
+        }
+        if(offset + length > stream_offset_ + buffered_)
+        {
+            // Drop the bytes before `offset`, then fill the rest of the buffer, still
+            // discarding what comes before `offset` if it lies beyond the buffer.
+            discard(std::min(offset - stream_offset_, buffered_));
+            while(stream_offset_ + buffered_ < offset + length)
+            {
+                const ssize_t n = read_retry(buffer_.data() + buffered_,
+                    buffer_.size() - buffered_);
+                if(n < 0) { error = detail::last_error(); return span_type(); }
+                if(n == 0) { break; }
+                buffered_ += static_cast<size_type>(n);
+                discard(std::min(offset - stream_offset_, buffered_));
+            }
+        }
+        if(offset >= stream_offset_ + buffered_) { return span_type(); }
+        return span_type(buffer_.data() + (offset - stream_offset_),
+            std::min(length, stream_offset_ + buffered_ - offset));
+    }
+
+    void discard(size_type n) noexcept
+    {
+        if(n == 0) { return; }
+        std::copy(buffer_.data() + n, buffer_.data() + buffered_, buffer_.data());
+        buffered_ -= n;
+        stream_offset_ += n;
+    }
+
+    ssize_t pread_retry(char* buf, size_type length, size_type offset) noexcept
+    {
+        ssize_t n;
+        do { n = ::pread(file_handle_, buf, length, static_cast<off_t>(offset)); }
+        while(n < 0 && errno == EINTR);
+        return n;
+    }
+
+    ssize_t read_retry(char* buf, size_type length) noexcept
+    {
+        ssize_t n;
+        do { n = ::read(file_handle_, buf, length); }
+        while(n < 0 && errno == EINTR);
+        return n;
+    }
+#else
+    span_type read_stream(size_type, size_type, std::error_code& error)
+    {
+        error = std::make_error_code(std::errc::not_supported);
+        return span_type();
+    }
+#endif
+
+    mmap_source mmap_;
+    buffer_pool::buffer buffer_;
+    std::shared_ptr<buffer_pool> pool_;
+    handle_type file_handle_ = invalid_handle;
+    bool is_handle_internal_ = false;
+    read_backend backend_ = read_backend::none;
+    const char* data_ = nullptr;
+    size_type size_ = 0;
+    size_type position_ = 0;
+    size_type stream_offset_ = 0;
+    size_type buffered_ = 0;
+    bool is_seekable_ = false;
+    std::error_code error_;
+};
+
+} // namespace mio
+
+#endif // MIO_READABLE_FILE_HEADER
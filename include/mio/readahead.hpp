@@ -0,0 +1,349 @@
+#ifndef MIO_READAHEAD_HEADER
+#define MIO_READAHEAD_HEADER
+
+#include "mio/mmap.hpp"
+#include "mio/page.hpp"
+#include "mio/detail/io_uring.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+#ifndef _WIN32
+# include <fcntl.h>
+#endif
+
+namespace mio {
+
+/**
+ * Populates the page cache ahead of accesses to a mapping, so that the page faults
+ * of a cold scan don't serialize its I/O one fault at a time.
+ *
+ * Ranges passed to `prefetch` are split into `chunk_size` reads, of which up to
+ * `queue_depth` are kept in flight through io_uring. The reads go to scratch
+ * buffers that are never looked at; their only purpose is to bring the file's pages
+ * into the cache, after which the mapping can access them without blocking.
+ *
+ * If io_uring is unavailable, either at compile time or because the kernel refuses
+ * it, or if `backend::syscall` is requested, each chunk is instead handed to the
+ * kernel's own readahead (`readahead(2)` on Linux, `posix_fadvise` elsewhere), which
+ * is synchronous with regards to the submission of the I/O. The engine also falls
+ * back to it for good if a read through the ring fails with `EINVAL` or
+ * `EOPNOTSUPP`, as on kernels that predate `IORING_OP_READ`.
+ *
+ * The engine makes progress only when one of its functions is called; it is meant
+ * to be driven from the thread doing the scan and is not thread-safe.
+ */
+class readahead_engine
+{
+public:
+    using size_type = size_t;
+
+    enum class backend
+    {
+        io_uring,
+        syscall
+    };
+
+    struct statistics
+    {
+        // Number of chunk reads issued and completed.
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        // Number of bytes read ahead.
+        uint64_t bytes = 0;
+        // The number of reads in flight, sampled after each submission.
+        uint64_t queue_depth_sum = 0;
+        uint64_t queue_depth_samples = 0;
+        uint64_t max_queue_depth = 0;
+
+        double average_queue_depth() const noexcept
+        {
+            return queue_depth_samples == 0 ? 0.0
+                : static_cast<double>(queue_depth_sum) / queue_depth_samples;
+        }
+    };
+
+    explicit readahead_engine(unsigned queue_depth = 32,
+            size_type chunk_size = 128 * 1024, backend preferred = backend::io_uring)
+        : queue_depth_(std::max(queue_depth, 1u))
+        , chunk_size_(std::max(make_offset_page_aligned(chunk_size), page_size()))
+    {
+#ifdef MIO_HAS_IO_URING
+        if(preferred == backend::io_uring)
+        {
+            std::error_code error;
+            ring_.open(queue_depth_, error);
+            if(!error)
+            {
+                buffers_.reset(new char[queue_depth_ * chunk_size_]);
+                slot_requests_.resize(queue_depth_);
+                for(unsigned i = 0; i < queue_depth_; ++i) { free_slots_.push_back(i); }
+            }
+        }
+#else
+        (void)preferred;
+#endif
+    }
+
+    readahead_engine(const readahead_engine&) = delete;
+    readahead_engine& operator=(const readahead_engine&) = delete;
+
+    /** Waits for all reads in flight, as their buffers are owned by the engine. */
+    ~readahead_engine()
+    {
+        std::error_code error;
+        wait(error);
+    }
+
+    backend active_backend() const noexcept
+    {
+#ifdef MIO_HAS_IO_URING
+        if(ring_.is_open()) { return backend::io_uring; }
+#endif
+        return backend::syscall;
+    }
+
+    /**
+     * Reads ahead the `length` bytes at `offset` relative to the first byte of
+     * `mmap` (as returned by `data`). The range is clamped to the mapping.
+     */
+    template<typename MMap>
+    void prefetch(const MMap& mmap, size_type offset, size_type length,
+            std::error_code& error)
+    {
+        error.clear();
+        if(offset >= mmap.size()) { return; }
+        length = std::min(length, mmap.size() - offset);
+        prefetch(mmap.file_handle(), static_cast<int64_t>(mmap.file_offset() + offset),
+            static_cast<int64_t>(length), error);
+    }
+
+    /** Reads ahead the `length` bytes at `offset` of the file behind `handle`. */
+    void prefetch(file_handle_type handle, int64_t offset, int64_t length,
+            std::error_code& error)
+    {
+        error.clear();
+        if(handle == invalid_handle)
+        {
+            error = std::make_error_code(std::errc::bad_file_descriptor);
+            return;
+        }
+
+        while(length > 0)
+        {
+            const int64_t n = std::min<int64_t>(length, chunk_size_);
+#ifdef MIO_HAS_IO_URING
+            if(ring_.is_open())
+            {
+                pending_.push_back({ handle, offset, static_cast<unsigned>(n) });
+            }
+            else
+#endif
+            {
+                readahead_syscall(handle, offset, n, error);
+                if(error) { return; }
+            }
+            offset += n;
+            length -= n;
+        }
+        poll(error);
+    }
+
+    /**
+     * Reaps completed reads and submits queued ones, without blocking. Read errors
+     * are reported here (or by `prefetch` and `wait`), but do not stop the engine.
+     */
+    void poll(std::error_code& error)
+    {
+        error.clear();
+#ifdef MIO_HAS_IO_URING
+        if(ring_.is_open()) { progress(0, error); }
+#endif
+    }
+
+    /** Blocks until all ranges passed to `prefetch` have been read. */
+    void wait(std::error_code& error)
+    {
+        error.clear();
+#ifdef MIO_HAS_IO_URING
+        while(ring_.is_open() && (!pending_.empty() || in_flight_ > 0))
+        {
+            const uint64_t before = stats_.submitted + stats_.completed;
+            std::error_code ec;
+            progress(1, ec);
+            if(ec && !error) { error = ec; }
+            // Bail out rather than spin if the ring itself stopped working.
+            if(ec && stats_.submitted + stats_.completed == before) { break; }
+        }
+#endif
+    }
+
+    /** Returns the number of reads submitted to the kernel that haven't completed. */
+    size_type in_flight() const noexcept { return in_flight_; }
+
+    /** Returns the number of reads queued up but not yet submitted. */
+    size_type pending() const noexcept { return pending_.size(); }
+
+    const statistics& stats() const noexcept { return stats_; }
+    void reset_stats() noexcept { stats_ = statistics(); }
+
+private:
+    struct request
+    {
+        file_handle_type handle;
+        int64_t offset;
+        unsigned length;
+    };
+
+    void readahead_syscall(file_handle_type handle, int64_t offset, int64_t length,
+            std::error_code& error)
+    {
+#if defined(__linux__)
+        if(::readahead(handle, offset, static_cast<size_t>(length)) != 0)
+        {
+            error.assign(errno, std::system_category());
+            return;
+        }
+#elif !defined(_WIN32)
+        const int ret = ::posix_fadvise(handle, offset, length, POSIX_FADV_WILLNEED);
+        if(ret != 0)
+        {
+            error.assign(ret, std::system_category());
+            return;
+        }
+#else
+        (void)handle;
+        (void)offset;
+        error = std::make_error_code(std::errc::not_supported);
+        return;
+#endif
+        ++stats_.submitted;
+        ++stats_.completed;
+        stats_.bytes += static_cast<uint64_t>(length);
+    }
+
+#ifdef MIO_HAS_IO_URING
+    void progress(unsigned wait_nr, std::error_code& error)
+    {
+        std::error_code ec;
+        reap(ec);
+        if(ec) { error = ec; }
+        if(!ring_.is_open()) { return; }
+
+        bool queued = false;
+        while(!pending_.empty() && !free_slots_.empty())
+        {
+            io_uring_sqe* sqe = ring_.get_sqe();
+            if(!sqe) { break; }
+            const request& r = pending_.front();
+            const unsigned slot = free_slots_.back();
+            free_slots_.pop_back();
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = r.handle;
+            sqe->off = static_cast<uint64_t>(r.offset);
+            sqe->addr = reinterpret_cast<uint64_t>(buffers_.get() + slot * chunk_size_);
+            sqe->len = r.length;
+            sqe->user_data = slot;
+            slot_requests_[slot] = r;
+            pending_.pop_front();
+            ++in_flight_;
+            ++stats_.submitted;
+            queued = true;
+        }
+
+        if(queued)
+        {
+            stats_.queue_depth_sum += in_flight_;
+            ++stats_.queue_depth_samples;
+            stats_.max_queue_depth = std::max<uint64_t>(stats_.max_queue_depth, in_flight_);
+        }
+
+        if(queued || (wait_nr > 0 && in_flight_ > 0))
+        {
+            ring_.submit(in_flight_ > 0 ? wait_nr : 0, ec);
+            if(ec) { error = ec; }
+            reap(ec);
+            if(ec) { error = ec; }
+        }
+    }
+
+    void reap(std::error_code& error)
+    {
+        std::vector<request> unsupported;
+        reap(unsupported, error);
+        if(!unsupported.empty()) { fall_back(unsupported, error); }
+    }
+
+    /** Reaps completed reads, collecting those the kernel can't do in `unsupported`. */
+    void reap(std::vector<request>& unsupported, std::error_code& error)
+    {
+        ring_.for_each_cqe([this, &unsupported, &error](const io_uring_cqe& cqe)
+        {
+            const unsigned slot = static_cast<unsigned>(cqe.user_data);
+            free_slots_.push_back(slot);
+            --in_flight_;
+            if(cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP)
+            {
+                // Counted again once issued through the syscall.
+                --stats_.submitted;
+                unsupported.push_back(slot_requests_[slot]);
+                return;
+            }
+            ++stats_.completed;
+            if(cqe.res < 0) { error.assign(-cqe.res, std::system_category()); }
+            else { stats_.bytes += static_cast<uint64_t>(cqe.res); }
+        });
+    }
+
+    /**
+     * Closes the ring, once the reads still in flight have completed, and issues
+     * the `unsupported` reads and the queued ones through the syscall instead.
+     */
+    void fall_back(std::vector<request>& unsupported, std::error_code& error)
+    {
+        while(in_flight_ > 0)
+        {
+            std::error_code ec;
+            ring_.submit(1, ec);
+            if(!ec) { reap(unsupported, ec); }
+            if(ec)
+            {
+                error = ec;
+                break;
+            }
+        }
+        ring_.close();
+
+        unsupported.insert(unsupported.end(), pending_.begin(), pending_.end());
+        pending_.clear();
+        in_flight_ = 0;
+        for(const request& r : unsupported)
+        {
+            std::error_code ec;
+            readahead_syscall(r.handle, r.offset, r.length, ec);
+            if(ec) { error = ec; }
+        }
+    }
+
+    detail::io_uring ring_;
+    std::unique_ptr<char[]> buffers_;
+    std::vector<unsigned> free_slots_;
+    // The read each slot's buffer was last submitted for.
+    std::vector<request> slot_requests_;
+#endif
+
+    unsigned queue_depth_;
+    size_type chunk_size_;
+    std::deque<request> pending_;
+    size_type in_flight_ = 0;
+    statistics stats_;
+};
+
+} // namespace mio
+
+#endif // MIO_READAHEAD_HEADER
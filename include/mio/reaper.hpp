@@ -0,0 +1,250 @@
+#ifndef MIO_REAPER_HEADER
+#define MIO_REAPER_HEADER
+
+#include "mio/mmap.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mio {
+
+struct reaper_options
+{
+    // Number of mappings waiting to be released beyond which `release` releases
+    // them on the calling thread instead, so that address space and file handles
+    // don't pile up if the reaper falls behind.
+    size_t max_pending = 4096;
+};
+
+/**
+ * Releases mappings on a background thread.
+ *
+ * Destroying a mapping unmaps it, which for a large populated mapping means tearing
+ * down its page tables and shooting down other CPUs' TLB entries, closes its file
+ * handle and, for a sink, first syncs it. `release` instead hands the mapping over to
+ * the reaper's thread, which destroys the mappings released since it last woke up
+ * in one batch. `drain` waits for all mappings released so far to be destroyed.
+ *
+ * Errors syncing a sink are ignored, as they are by its destructor; call `sync`
+ * before releasing it to handle them. All members are thread-safe.
+ */
+class mmap_reaper
+{
+public:
+    struct statistics
+    {
+        // Number of mappings released, of those that were released on the calling
+        // thread because too many were pending, and of batches the thread reaped.
+        uint64_t released = 0;
+        uint64_t released_inline = 0;
+        uint64_t batches = 0;
+    };
+
+    explicit mmap_reaper(reaper_options options = reaper_options())
+        : options_(options)
+        , thread_([this] { run(); })
+    {}
+
+    mmap_reaper(const mmap_reaper&) = delete;
+    mmap_reaper& operator=(const mmap_reaper&) = delete;
+
+    /** Releases all pending mappings, then stops the thread. */
+    ~mmap_reaper()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    /** Takes over `mmap` to release it on the reaper's thread. */
+    template<typename MMap>
+    void release(MMap&& mmap)
+    {
+        using mmap_type = typename std::decay<MMap>::type;
+        static_assert(!std::is_lvalue_reference<MMap>::value,
+            "release takes ownership of the mapping, which must be moved in");
+        if(!mmap.is_open()) { return; }
+        std::unique_ptr<entry> e(new (std::nothrow) holder<mmap_type>(std::move(mmap)));
+        if(!e)
+        {
+            // Out of memory: the mapping, which wasn't moved, is released right here.
+            mmap_type released(std::move(mmap));
+            return;
+        }
+        bool was_empty = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++stats_.released;
+            if(pending_ >= options_.max_pending)
+            {
+                ++stats_.released_inline;
+            }
+            else
+            {
+                was_empty = queue_.empty();
+                queue_.push_back(std::move(e));
+                ++pending_;
+            }
+        }
+        // Released past the limit, or queued for the thread, which is only woken up
+        // by the first of a batch.
+        if(e) { e.reset(); }
+        else if(was_empty) { cv_.notify_one(); }
+    }
+
+    /** Blocks until all mappings released so far have been destroyed. */
+    void drain()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        drained_cv_.wait(lock, [this] { return pending_ == 0; });
+    }
+
+    /** Returns the number of mappings released but not yet destroyed. */
+    size_t pending() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pending_;
+    }
+
+    statistics stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    struct entry
+    {
+        virtual ~entry() = default;
+    };
+
+    template<typename MMap>
+    struct holder : entry
+    {
+        explicit holder(MMap&& mmap) : mmap(std::move(mmap)) {}
+        MMap mmap;
+    };
+
+    void run()
+    {
+        std::vector<std::unique_ptr<entry>> batch;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for(;;)
+        {
+            cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if(queue_.empty()) { return; }
+            batch.swap(queue_);
+            ++stats_.batches;
+            const size_t reaped = batch.size();
+            lock.unlock();
+            batch.clear();
+            lock.lock();
+            pending_ -= reaped;
+            if(pending_ == 0) { drained_cv_.notify_all(); }
+        }
+    }
+
+    reaper_options options_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable drained_cv_;
+    std::vector<std::unique_ptr<entry>> queue_;
+    size_t pending_ = 0;
+    statistics stats_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+/**
+ * Returns the reaper used by deferred mappings unless told otherwise. It is created
+ * on first use.
+ */
+inline mmap_reaper& default_reaper()
+{
+    static mmap_reaper reaper;
+    return reaper;
+}
+
+/**
+ * A `basic_mmap` that is released by a `mmap_reaper` when it is destroyed or
+ * assigned to, rather than on the calling thread. Explicit calls to `unmap`,
+ * `map` and `remap` still act immediately.
+ *
+ * The reaper must outlive the mapping. Mappings released to `default_reaper`
+ * during static destruction, after it was destroyed, are not supported.
+ */
+template<access_mode AccessMode, typename ByteT>
+class basic_deferred_mmap : public basic_mmap<AccessMode, ByteT>
+{
+public:
+    using mmap_type = basic_mmap<AccessMode, ByteT>;
+
+    using mmap_type::mmap_type;
+
+    basic_deferred_mmap() = default;
+
+    /** Takes over `mmap`, to be released by `reaper`. */
+    explicit basic_deferred_mmap(mmap_type&& mmap, mmap_reaper& reaper = default_reaper())
+        : mmap_type(std::move(mmap))
+        , reaper_(&reaper)
+    {}
+
+    // The casts keep the inherited constructor taking a path from being chosen over
+    // the base's move constructor.
+    basic_deferred_mmap(basic_deferred_mmap&& other)
+        : mmap_type(static_cast<mmap_type&&>(other))
+        , reaper_(other.reaper_)
+    {}
+
+    basic_deferred_mmap& operator=(basic_deferred_mmap&& other)
+    {
+        if(this != &other)
+        {
+            release();
+            mmap_type::operator=(static_cast<mmap_type&&>(other));
+            reaper_ = other.reaper_;
+        }
+        return *this;
+    }
+
+    ~basic_deferred_mmap() { release(); }
+
+    mmap_reaper& reaper() const noexcept { return *reaper_; }
+
+    /** Makes `reaper` release the mapping from now on. */
+    void set_reaper(mmap_reaper& reaper) noexcept { reaper_ = &reaper; }
+
+private:
+    void release()
+    {
+        if(this->is_open()) { reaper_->release(mmap_type(static_cast<mmap_type&&>(*this))); }
+    }
+
+    mmap_reaper* reaper_ = &default_reaper();
+};
+
+template<typename ByteT>
+using basic_deferred_mmap_source = basic_deferred_mmap<access_mode::read, ByteT>;
+
+template<typename ByteT>
+using basic_deferred_mmap_sink = basic_deferred_mmap<access_mode::write, ByteT>;
+
+using deferred_mmap_source = basic_deferred_mmap_source<char>;
+using deferred_ummap_source = basic_deferred_mmap_source<unsigned char>;
+
+using deferred_mmap_sink = basic_deferred_mmap_sink<char>;
+using deferred_ummap_sink = basic_deferred_mmap_sink<unsigned char>;
+
+} // namespace mio
+
+#endif // MIO_REAPER_HEADER
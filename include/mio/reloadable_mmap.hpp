@@ -0,0 +1,457 @@
+#ifndef MIO_RELOADABLE_MMAP_HEADER
+#define MIO_RELOADABLE_MMAP_HEADER
+
+#include "mio/epoch_mmap.hpp"
+#include "mio/mmap.hpp"
+#include "mio/shared_mmap.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <poll.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# ifdef __linux__
+#  include <sys/eventfd.h>
+#  include <sys/inotify.h>
+# endif
+#endif
+
+namespace mio {
+namespace detail {
+
+/** Returns the directory part of `path`, or "." if it has none. */
+inline std::string directory_of(const std::string& path)
+{
+    const auto slash = path.find_last_of('/');
+    if(slash == std::string::npos) { return "."; }
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+/** Returns the part of `path` after its last slash. */
+inline std::string filename_of(const std::string& path)
+{
+    const auto slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+} // namespace detail
+
+/**
+ * Builds a new version of a file in a temporary next to it and atomically renames
+ * it into place, so that readers opening the path see either the old or the new
+ * version in full.
+ *
+ * `open` creates the temporary with the requested size and maps it for writing.
+ * `commit` syncs the data, renames the temporary over the destination and syncs the
+ * directory, after which the new version survives a crash. A file that is closed or
+ * destroyed without being committed is removed.
+ *
+ * This is only supported on POSIX systems.
+ */
+template<typename ByteT>
+class basic_staged_file
+{
+public:
+    using mmap_type = basic_mmap_sink<ByteT>;
+    using value_type = typename mmap_type::value_type;
+    using size_type = typename mmap_type::size_type;
+    using pointer = typename mmap_type::pointer;
+
+    basic_staged_file() = default;
+    basic_staged_file(const basic_staged_file&) = delete;
+    basic_staged_file& operator=(const basic_staged_file&) = delete;
+
+#ifdef __cpp_exceptions
+    /**
+     * The same as invoking the `open` function, except any error that may occur
+     * while creating the file is wrapped in a `std::system_error` and is thrown.
+     */
+    basic_staged_file(const std::string& path, const size_type size)
+    {
+        std::error_code error;
+        open(path, size, error);
+        if(error) { throw std::system_error(error); }
+    }
+#endif // __cpp_exceptions
+
+    /** Removes the temporary unless it was committed. */
+    ~basic_staged_file() { discard(); }
+
+    /**
+     * Creates a temporary file of `size` bytes in the directory of `path` and maps
+     * it, discarding any file staged before. Upon failure, `error` is set and
+     * nothing is staged.
+     */
+    void open(const std::string& path, const size_type size, std::error_code& error)
+    {
+        discard();
+        error.clear();
+        if(path.empty())
+        {
+            error = std::make_error_code(std::errc::invalid_argument);
+            return;
+        }
+#ifdef _WIN32
+        (void)size;
+        error = std::make_error_code(std::errc::not_supported);
+#else
+        std::string temp_path = path + ".XXXXXX";
+        const int fd = ::mkstemp(&temp_path[0]);
+        if(fd == -1) { error = detail::last_error(); return; }
+        // mkstemp creates the file readable by its owner only.
+        if(::fchmod(fd, 0644) != 0 || ::ftruncate(fd, static_cast<off_t>(size)) != 0)
+        {
+            error = detail::last_error();
+            ::close(fd);
+            ::unlink(temp_path.c_str());
+            return;
+        }
+        if(size > 0)
+        {
+            mmap_.map(fd, 0, size, error);
+            if(error)
+            {
+                ::close(fd);
+                ::unlink(temp_path.c_str());
+                return;
+            }
+        }
+        file_handle_ = fd;
+        path_ = path;
+        temp_path_ = std::move(temp_path);
+#endif
+    }
+
+    bool is_open() const noexcept { return file_handle_ != invalid_handle; }
+
+    /** Returns the path of the temporary, which is empty unless a file is staged. */
+    const std::string& temp_path() const noexcept { return temp_path_; }
+
+    /** Returns the mapping of the temporary, to be filled in before `commit`. */
+    mmap_type& mmap() noexcept { return mmap_; }
+
+    pointer data() noexcept { return mmap_.data(); }
+    size_type size() const noexcept { return mmap_.size(); }
+
+    /**
+     * Writes the staged file back to disk and renames it over the destination. Upon
+     * failure, `error` is set and the file stays staged, so that the commit may be
+     * retried or the file discarded.
+     */
+    void commit(std::error_code& error)
+    {
+        error.clear();
+        if(!is_open())
+        {
+            error = std::make_error_code(std::errc::bad_file_descriptor);
+            return;
+        }
+#ifndef _WIN32
+        if(mmap_.is_mapped())
+        {
+            mmap_.sync(error);
+            if(error) { return; }
+        }
+        // The mapping doesn't cover the file's size, which fsync does.
+        if(::fsync(file_handle_) != 0
+           || ::rename(temp_path_.c_str(), path_.c_str()) != 0)
+        {
+            error = detail::last_error();
+            return;
+        }
+        sync_directory(error);
+        mmap_.unmap();
+        ::close(file_handle_);
+        file_handle_ = invalid_handle;
+        path_.clear();
+        temp_path_.clear();
+#endif
+    }
+
+    /** Unmaps and removes the staged file, if any. */
+    void discard()
+    {
+        if(!is_open()) { return; }
+        mmap_.unmap();
+#ifndef _WIN32
+        ::close(file_handle_);
+        ::unlink(temp_path_.c_str());
+#endif
+        file_handle_ = invalid_handle;
+        path_.clear();
+        temp_path_.clear();
+    }
+
+private:
+    void sync_directory(std::error_code& error)
+    {
+#ifndef _WIN32
+        const int fd = ::open(detail::directory_of(path_).c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd == -1) { error = detail::last_error(); return; }
+        if(::fsync(fd) != 0) { error = detail::last_error(); }
+        ::close(fd);
+#endif
+    }
+
+    mmap_type mmap_;
+    file_handle_type file_handle_ = invalid_handle;
+    std::string path_;
+    std::string temp_path_;
+};
+
+/**
+ * A read-only mapping of a file that is replaced with new versions while in use, as
+ * `basic_staged_file` does.
+ *
+ * `get` returns the current version as a `basic_shared_mmap`, which keeps that
+ * version mapped for as long as the reader holds it. `reload` maps whatever file is
+ * at the path now and publishes it by exchanging a raw pointer, so readers never
+ * wait for a mapping to be established and those still holding the previous version
+ * finish on it. `get` takes no lock: it loads the pointer and copies the
+ * `std::shared_ptr` it points to under the protection of a `detail::epoch_domain`,
+ * and `reload` waits for such copies to finish before freeing the pointer it
+ * replaced. The old version is unmapped when its last holder lets go of it.
+ *
+ * On Linux, `open` also starts a thread that watches the file's directory with
+ * inotify and reloads whenever a file is renamed onto the path. Elsewhere, `reload`
+ * must be called explicitly. A new version must be moved into place with a rename:
+ * a file that is rewritten in place changes under the readers' feet. If a reload
+ * in the background fails, the current version stays and the error is kept for
+ * `last_error`.
+ *
+ * `get`, `reload`, `generation` and `last_error` may be called concurrently.
+ */
+template<typename ByteT>
+class basic_reloadable_mmap
+{
+public:
+    using mmap_type = basic_shared_mmap_source<ByteT>;
+    using value_type = typename mmap_type::value_type;
+    using size_type = typename mmap_type::size_type;
+
+    basic_reloadable_mmap() = default;
+    basic_reloadable_mmap(const basic_reloadable_mmap&) = delete;
+    basic_reloadable_mmap& operator=(const basic_reloadable_mmap&) = delete;
+
+#ifdef __cpp_exceptions
+    /**
+     * The same as invoking the `open` function, except any error that may occur
+     * while mapping the file is wrapped in a `std::system_error` and is thrown.
+     */
+    explicit basic_reloadable_mmap(const std::string& path)
+    {
+        std::error_code error;
+        open(path, error);
+        if(error) { throw std::system_error(error); }
+    }
+#endif // __cpp_exceptions
+
+    /** Stops watching the file and releases this object's hold on the mapping. */
+    ~basic_reloadable_mmap() { close(); }
+
+    /**
+     * Maps the file at `path` and starts watching it for new versions, closing any
+     * file opened before. Upon failure, `error` is set and nothing is open.
+     */
+    void open(const std::string& path, std::error_code& error)
+    {
+        close();
+        error.clear();
+        if(path.empty())
+        {
+            error = std::make_error_code(std::errc::invalid_argument);
+            return;
+        }
+        path_ = path;
+        // Watch first, so that a version renamed into place before the initial
+        // mapping is picked up by one or the other.
+        watch(error);
+        if(!error) { reload(error); }
+        if(error) { close(); }
+    }
+
+    /** Stops watching the file and drops the current version. */
+    void close()
+    {
+        stop_watching();
+        std::lock_guard<std::mutex> lock(reload_mutex_);
+        publish(nullptr);
+        path_.clear();
+    }
+
+    bool is_open() const noexcept { return !path_.empty(); }
+
+    /** Returns whether new versions are picked up without calling `reload`. */
+    bool is_watching() const noexcept { return watcher_.joinable(); }
+
+    /** Returns the current version, which stays mapped for as long as it's held. */
+    mmap_type get() const
+    {
+        detail::epoch_counter* counter = readers_.enter();
+        const mmap_ptr* current = current_.load();
+        mmap_ptr mmap = current ? *current : mmap_ptr();
+        detail::epoch_domain::leave(counter);
+        return mmap_type(std::move(mmap));
+    }
+
+    /**
+     * Maps the file now at the path and makes it the current version. Upon failure,
+     * `error` is set and the current version remains.
+     */
+    void reload(std::error_code& error)
+    {
+        error.clear();
+        std::lock_guard<std::mutex> lock(reload_mutex_);
+        if(path_.empty())
+        {
+            error = std::make_error_code(std::errc::bad_file_descriptor);
+            return;
+        }
+        auto mmap = std::make_shared<typename mmap_type::mmap_type>();
+        mmap->map(path_, 0, map_entire_file, error);
+        if(error) { return; }
+        publish(new mmap_ptr(std::move(mmap)));
+        generation_.fetch_add(1);
+    }
+
+    /** Returns the number of versions mapped since the object was created. */
+    uint64_t generation() const noexcept { return generation_.load(); }
+
+    /** Returns the error of the last reload that failed in the background, if any. */
+    std::error_code last_error() const
+    {
+        std::lock_guard<std::mutex> lock(reload_mutex_);
+        return last_error_;
+    }
+
+private:
+    using mmap_ptr = std::shared_ptr<typename mmap_type::mmap_type>;
+
+    /**
+     * Makes `mmap` the current version, then frees the previous pointer once no
+     * `get` may still be copying it. Must be called with `reload_mutex_` held.
+     */
+    void publish(mmap_ptr* mmap)
+    {
+        mmap_ptr* old = current_.exchange(mmap);
+        if(!old) { return; }
+        readers_.synchronize();
+        delete old;
+    }
+
+    void watch(std::error_code& error)
+    {
+#ifdef __linux__
+        inotify_handle_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(inotify_handle_ == -1) { error = detail::last_error(); return; }
+        stop_handle_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(stop_handle_ == -1
+           || ::inotify_add_watch(inotify_handle_, detail::directory_of(path_).c_str(),
+                IN_MOVED_TO | IN_ONLYDIR) == -1)
+        {
+            error = detail::last_error();
+            close_watch_handles();
+            return;
+        }
+        watcher_ = std::thread(&basic_reloadable_mmap::run, this, detail::filename_of(path_));
+#else
+        (void)error;
+#endif
+    }
+
+    void stop_watching()
+    {
+#ifdef __linux__
+        if(!watcher_.joinable()) { return; }
+        const uint64_t one = 1;
+        while(::write(stop_handle_, &one, sizeof(one)) == -1 && errno == EINTR) {}
+        watcher_.join();
+        close_watch_handles();
+#endif
+    }
+
+#ifdef __linux__
+    void run(const std::string& name)
+    {
+        alignas(inotify_event) char buffer[4096];
+        pollfd fds[2] = { { inotify_handle_, POLLIN, 0 }, { stop_handle_, POLLIN, 0 } };
+        for(;;)
+        {
+            if(::poll(fds, 2, -1) == -1)
+            {
+                if(errno == EINTR) { continue; }
+                set_last_error(detail::last_error());
+                return;
+            }
+            if(fds[1].revents != 0) { return; }
+
+            bool is_replaced = false;
+            ssize_t n;
+            while((n = ::read(inotify_handle_, buffer, sizeof(buffer))) > 0)
+            {
+                for(const char* p = buffer; p < buffer + n;)
+                {
+                    const auto* event = reinterpret_cast<const inotify_event*>(p);
+                    // Events may have been dropped, the file among them.
+                    if((event->mask & IN_Q_OVERFLOW)
+                       || (event->len > 0 && name == event->name))
+                    {
+                        is_replaced = true;
+                    }
+                    p += sizeof(inotify_event) + event->len;
+                }
+            }
+            if(is_replaced)
+            {
+                std::error_code error;
+                reload(error);
+                if(error) { set_last_error(error); }
+            }
+        }
+    }
+
+    void close_watch_handles()
+    {
+        if(inotify_handle_ != -1) { ::close(inotify_handle_); }
+        if(stop_handle_ != -1) { ::close(stop_handle_); }
+        inotify_handle_ = -1;
+        stop_handle_ = -1;
+    }
+#endif
+
+    void set_last_error(const std::error_code& error)
+    {
+        std::lock_guard<std::mutex> lock(reload_mutex_);
+        last_error_ = error;
+    }
+
+    std::atomic<mmap_ptr*> current_{nullptr};
+    detail::epoch_domain readers_;
+    std::atomic<uint64_t> generation_{0};
+    mutable std::mutex reload_mutex_;
+    std::error_code last_error_;
+    std::string path_;
+#ifdef __linux__
+    int inotify_handle_ = -1;
+    int stop_handle_ = -1;
+#endif
+    std::thread watcher_;
+};
+
+using staged_file = basic_staged_file<char>;
+using ustaged_file = basic_staged_file<unsigned char>;
+
+using reloadable_mmap = basic_reloadable_mmap<char>;
+using reloadable_ummap = basic_reloadable_mmap<unsigned char>;
+
+} // namespace mio
+
+#endif // MIO_RELOADABLE_MMAP_HEADER
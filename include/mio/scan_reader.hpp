@@ -0,0 +1,165 @@
+#ifndef MIO_SCAN_READER_HEADER
+#define MIO_SCAN_READER_HEADER
+
+#include "mio/chunk_reader.hpp"
+#include "mio/mmap.hpp"
+#include "mio/page.hpp"
+#include "mio/span.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <system_error>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+#endif
+
+namespace mio {
+
+struct scan_options
+{
+    size_t chunk_size = 1 << 20;
+
+    // Pages are only dropped once the start of the current chunk is this many bytes
+    // past them, so that data just read may still be looked back at.
+    size_t lag = 8 << 20;
+
+    // Consumed pages are dropped in ranges of at least this many bytes, to keep the
+    // number of system calls down. A scan thus keeps at most `lag + drop_batch +
+    // chunk_size` bytes of the file mapped in, plus the kernel's readahead.
+    size_t drop_batch = 4 << 20;
+
+    // Whether to also evict the dropped pages from the page cache. Otherwise they are
+    // only unmapped from this process and, where `MADV_COLD` is available, marked to
+    // be reclaimed first, so they are still cached if another process needs them.
+    // Dirty pages are never evicted.
+    bool drop_page_cache = true;
+};
+
+/**
+ * Scans a mapping in consecutive chunks, like `basic_mmap_chunk_reader`, while
+ * dropping the pages behind the cursor, so that scanning a file much larger than
+ * memory doesn't grow the resident set or push the rest of the working set out of
+ * the page cache.
+ *
+ * Pages more than `lag` bytes behind the current chunk are released with
+ * `MADV_DONTNEED` and, with `drop_page_cache`, evicted with `POSIX_FADV_DONTNEED`.
+ * Reading them again through the mapping faults them back in, from the disk if
+ * they were evicted.
+ *
+ * Pages are only dropped on POSIX systems; elsewhere this is a plain chunk reader.
+ * The reader does not own the mapping, which must outlive it.
+ */
+template<typename ByteT>
+class basic_mmap_scan_reader
+{
+public:
+    using value_type = ByteT;
+    using size_type = size_t;
+    using span_type = span<const ByteT>;
+    using iterator = chunk_iterator<basic_mmap_scan_reader>;
+
+    template<typename MMap>
+    basic_mmap_scan_reader(const MMap& mmap, scan_options options = scan_options())
+        : data_(mmap.data())
+        , size_(mmap.size())
+        , file_offset_(mmap.file_offset())
+        , file_handle_(mmap.file_handle())
+        , options_(options)
+    {
+        options_.chunk_size = std::max<size_type>(options_.chunk_size, 1);
+        options_.drop_batch = std::max<size_type>(options_.drop_batch, page_size());
+    }
+
+    /**
+     * Sets `chunk` to the next chunk and returns true, or returns false at the end
+     * of the mapping. Failing to drop pages is reported via `error` but doesn't
+     * stop the scan.
+     */
+    bool next(span_type& chunk, std::error_code& error)
+    {
+        error.clear();
+        if(position_ >= size_) { return false; }
+        if(position_ > options_.lag) { drop_before(position_ - options_.lag, error); }
+        chunk = span_type(data_, size_).subspan(position_, options_.chunk_size);
+        position_ += chunk.size();
+        return true;
+    }
+
+    iterator begin() { return iterator(*this); }
+    iterator end() { return iterator(); }
+
+    size_type size() const noexcept { return size_; }
+    size_type position() const noexcept { return position_; }
+    size_type chunk_size() const noexcept { return options_.chunk_size; }
+    std::error_code error() const noexcept { return error_; }
+
+    /** Returns the number of bytes whose pages have been dropped. */
+    size_type dropped() const noexcept { return dropped_; }
+
+    /** Drops the pages of everything consumed so far, e.g. at the end of a scan. */
+    void drop_consumed(std::error_code& error)
+    {
+        error.clear();
+        drop(position_, error);
+    }
+
+private:
+    void drop_before(size_type end, std::error_code& error)
+    {
+        if(end >= dropped_ + options_.drop_batch) { drop(end, error); }
+    }
+
+    /** Drops the pages from the last dropped one up to those wholly before `end`. */
+    void drop(size_type end, std::error_code& error)
+    {
+        // Offsets are relative to `data_`, which needn't be page aligned, so work in
+        // file offsets to find the page boundaries. The pages holding the start and
+        // the end of the mapping are part of it even where they stick out of it.
+        const size_type begin_page = make_offset_page_aligned(file_offset_ + dropped_);
+        const size_type end_page = end == size_
+            ? make_offset_page_aligned(file_offset_ + end + page_size() - 1)
+            : make_offset_page_aligned(file_offset_ + end);
+        if(end_page <= begin_page) { return; }
+#ifndef _WIN32
+        const char* base = reinterpret_cast<const char*>(data_);
+        void* address = const_cast<char*>(begin_page >= file_offset_
+            ? base + (begin_page - file_offset_) : base - (file_offset_ - begin_page));
+        const size_type length = end_page - begin_page;
+        if(!options_.drop_page_cache)
+        {
+# ifdef MADV_COLD
+            ::madvise(address, length, MADV_COLD);
+# endif
+        }
+        if(::madvise(address, length, MADV_DONTNEED) != 0) { error = detail::last_error(); }
+# ifdef POSIX_FADV_DONTNEED
+        if(!error && options_.drop_page_cache)
+        {
+            const int ret = ::posix_fadvise(file_handle_, static_cast<off_t>(begin_page),
+                static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+            if(ret != 0) { error = std::error_code(ret, std::system_category()); }
+        }
+# endif
+#endif
+        if(error) { error_ = error; }
+        dropped_ = std::min(end_page - file_offset_, size_);
+    }
+
+    const ByteT* data_;
+    size_type size_;
+    size_type file_offset_;
+    file_handle_type file_handle_;
+    scan_options options_;
+    size_type position_ = 0;
+    size_type dropped_ = 0;
+    std::error_code error_;
+};
+
+using mmap_scan_reader = basic_mmap_scan_reader<char>;
+using ummap_scan_reader = basic_mmap_scan_reader<unsigned char>;
+
+} // namespace mio
+
+#endif // MIO_SCAN_READER_HEADER
@@ -0,0 +1,195 @@
+#ifndef MIO_SEND_RANGE_HEADER
+#define MIO_SEND_RANGE_HEADER
+
+#include "mio/mmap.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <system_error>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/stat.h>
+# include <sys/uio.h>
+# ifdef __linux__
+#  include <sys/sendfile.h>
+# endif
+#endif
+
+namespace mio {
+
+/** The primitive used by `send_range` to move bytes to the output. */
+enum class send_method
+{
+    // Picks one of the below depending on the kind of output.
+    automatic,
+    // `sendfile(2)` from the mapped file, chosen for sockets and other outputs.
+    sendfile,
+    // `splice(2)` from the mapped file, chosen for pipes.
+    splice,
+    // `vmsplice(2)` of the mapped memory, which the output must be a pipe for. The
+    // pipe references the pages rather than copying them, so the range must not be
+    // modified until the data has been consumed from the pipe.
+    vmsplice,
+    // `copy_file_range(2)` from the mapped file, chosen for regular files.
+    copy_file_range,
+    // Plain `write` from the mapped memory, used where nothing else is available.
+    write
+};
+
+namespace detail {
+
+inline send_method choose_send_method(file_handle_type out) noexcept
+{
+#ifdef __linux__
+    struct stat sbuf;
+    if(::fstat(out, &sbuf) == 0)
+    {
+        if(S_ISFIFO(sbuf.st_mode)) { return send_method::splice; }
+        if(S_ISREG(sbuf.st_mode)) { return send_method::copy_file_range; }
+    }
+    return send_method::sendfile;
+#else
+    (void)out;
+    return send_method::write;
+#endif
+}
+
+/**
+ * Whether a failure of a zero-copy primitive means that it doesn't support the
+ * given input and output, so falling back to writing is worth trying.
+ */
+inline bool is_unsupported_send(int err) noexcept
+{
+    return err == EINVAL || err == ENOSYS || err == EXDEV
+#ifdef EOPNOTSUPP
+        || err == EOPNOTSUPP
+#endif
+        || err == EBADF;
+}
+
+/**
+ * Moves up to `length` bytes once with `method`, from the file behind `in` at
+ * `file_offset` (whose contents are mapped at `data`) to `out`. Returns the number
+ * of bytes moved, or -1 with errno set.
+ */
+inline int64_t send_once(send_method method, file_handle_type in, int64_t file_offset,
+        const char* data, size_t length, file_handle_type out) noexcept
+{
+#ifdef _WIN32
+    (void)method;
+    (void)in;
+    (void)file_offset;
+    DWORD written = 0;
+    const DWORD n = static_cast<DWORD>(std::min<size_t>(length, 1u << 30));
+    if(::WriteFile(out, data, n, &written, nullptr) == 0) { return -1; }
+    return written;
+#else
+    // Keep each call within what the kernel moves at once anyway.
+    length = std::min<size_t>(length, 0x7ffff000);
+    switch(method)
+    {
+#ifdef __linux__
+    case send_method::sendfile:
+    {
+        off_t off = static_cast<off_t>(file_offset);
+        return ::sendfile(out, in, &off, length);
+    }
+    case send_method::splice:
+    {
+        loff_t off = static_cast<loff_t>(file_offset);
+        return ::splice(in, &off, out, nullptr, length, SPLICE_F_MOVE | SPLICE_F_MORE);
+    }
+    case send_method::vmsplice:
+    {
+        iovec iov;
+        iov.iov_base = const_cast<char*>(data);
+        iov.iov_len = length;
+        return ::vmsplice(out, &iov, 1, 0);
+    }
+    case send_method::copy_file_range:
+    {
+        loff_t off = static_cast<loff_t>(file_offset);
+        return ::copy_file_range(in, &off, out, nullptr, length, 0);
+    }
+#endif
+    default:
+        (void)in;
+        (void)file_offset;
+        return ::write(out, data, length);
+    }
+#endif
+}
+
+} // namespace detail
+
+/**
+ * Sends the `length` bytes at `offset` relative to the first byte of `mmap` (as
+ * returned by `data`) to `out`, which may be a socket, a pipe, a regular file or
+ * any other writable file handle. The range is clamped to the mapping.
+ *
+ * Unless `method` says otherwise, the data is moved without copying it through
+ * user space where possible: with `sendfile` for sockets, `splice` for pipes and
+ * `copy_file_range` for regular files, all reading from `mmap.file_handle()`.
+ * Modifications made through a read-write mapping are visible to these, as they go
+ * through the same page cache. If the primitive doesn't support the pair of file
+ * handles, the data is written from the mapping instead.
+ *
+ * Returns the number of bytes sent. This is less than requested if an error
+ * occurred, which is reported via `error`, e.g. `resource_unavailable_try_again`
+ * for a non-blocking output that is full, in which case the call may be repeated
+ * for the rest of the range.
+ */
+template<typename MMap>
+size_t send_range(const MMap& mmap, size_t offset, size_t length,
+        file_handle_type out, std::error_code& error,
+        send_method method = send_method::automatic)
+{
+    error.clear();
+    if(!mmap.is_open() || out == invalid_handle)
+    {
+        error = std::make_error_code(std::errc::bad_file_descriptor);
+        return 0;
+    }
+    if(offset > mmap.size())
+    {
+        error = std::make_error_code(std::errc::invalid_argument);
+        return 0;
+    }
+    length = std::min(length, mmap.size() - offset);
+
+    const bool automatic = method == send_method::automatic;
+    if(automatic) { method = detail::choose_send_method(out); }
+
+    const char* data = reinterpret_cast<const char*>(mmap.data()) + offset;
+    const int64_t file_offset = static_cast<int64_t>(mmap.file_offset() + offset);
+    size_t sent = 0;
+    while(sent < length)
+    {
+        const int64_t n = detail::send_once(method, mmap.file_handle(),
+            file_offset + static_cast<int64_t>(sent), data + sent, length - sent, out);
+        if(n < 0)
+        {
+#ifndef _WIN32
+            if(errno == EINTR) { continue; }
+            if(automatic && sent == 0 && method != send_method::write
+                    && detail::is_unsupported_send(errno))
+            {
+                method = send_method::write;
+                continue;
+            }
+#endif
+            error = detail::last_error();
+            break;
+        }
+        // The file was truncated beneath the mapping.
+        if(n == 0) { break; }
+        sent += static_cast<size_t>(n);
+    }
+    return sent;
+}
+
+} // namespace mio
+
+#endif // MIO_SEND_RANGE_HEADER
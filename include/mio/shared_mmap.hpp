@@ -162,6 +162,9 @@ public:
         return pimpl_ ? pimpl_->mapped_length() : 0;
     }
 
+    /** See `basic_mmap::capacity`. */
+    size_type capacity() const noexcept { return pimpl_ ? pimpl_->capacity() : 0; }
+
     /**
      * Returns a pointer to the first requested byte, or `nullptr` if no memory mapping
      * exists.
@@ -249,6 +252,26 @@ public:
         map_impl(path, offset, length, error);
     }
 
+    /**
+     * The same as the above, except that the file is opened as described by
+     * `options`.
+     */
+    template<typename String>
+    void map(const String& path, const size_type offset, const size_type length,
+        const open_options& options, std::error_code& error)
+    {
+        if(!pimpl_)
+        {
+            mmap_type mmap = make_mmap<mmap_type>(path, offset, length, options, error);
+            if(error) { return; }
+            pimpl_ = std::make_shared<mmap_type>(std::move(mmap));
+        }
+        else
+        {
+            pimpl_->map(path, offset, length, options, error);
+        }
+    }
+
     /**
      * Establishes a memory mapping with AccessMode. If the mapping is unsuccesful, the
      * reason is reported via `error` and the object remains in a state as if this
@@ -346,6 +369,20 @@ public:
         typename = typename std::enable_if<A == access_mode::write>::type
     > void truncate(size_type file_size, std::error_code& error) { if(pimpl_) pimpl_->truncate(file_size, error); }
 
+    /** See `basic_mmap::reserve`. */
+    void reserve(size_type capacity, std::error_code& error) { if(pimpl_) pimpl_->reserve(capacity, error); }
+
+    /** See `basic_mmap::extend_to_file`. */
+    void extend_to_file(std::error_code& error) { if(pimpl_) pimpl_->extend_to_file(error); }
+
+    /** See `basic_mmap::data_extents`. */
+    std::vector<data_extent> data_extents(std::error_code& error) const
+    {
+        if(pimpl_) { return pimpl_->data_extents(error); }
+        error = std::make_error_code(std::errc::bad_file_descriptor);
+        return std::vector<data_extent>();
+    }
+
     /** All operators compare the underlying `basic_mmap`'s addresses. */
 
     friend bool operator==(const basic_shared_mmap& a, const basic_shared_mmap& b)
@@ -0,0 +1,70 @@
+#ifndef MIO_SPAN_HEADER
+#define MIO_SPAN_HEADER
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+namespace mio {
+
+/**
+ * A non-owning view of a contiguous range of bytes, such as a region of a
+ * mapping or of a read buffer. It has the same Container-like accessors as
+ * `basic_mmap`, so code iterating over chunks does not need to know where they
+ * came from.
+ */
+template<typename T>
+class span
+{
+public:
+    using element_type = T;
+    using value_type = typename std::remove_cv<T>::type;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using reference = T&;
+    using iterator = pointer;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+
+    span() = default;
+    span(pointer data, size_type size) noexcept : data_(data), size_(size) {}
+
+    /** Allows implicit conversion from `span<T>` to `span<const T>`. */
+    template<
+        typename U,
+        typename = typename std::enable_if<
+            std::is_convertible<U(*)[], T(*)[]>::value
+        >::type
+    > span(const span<U>& other) noexcept : data_(other.data()), size_(other.size()) {}
+
+    pointer data() const noexcept { return data_; }
+    size_type size() const noexcept { return size_; }
+    size_type length() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    iterator begin() const noexcept { return data_; }
+    iterator end() const noexcept { return data_ + size_; }
+    reverse_iterator rbegin() const noexcept { return reverse_iterator(end()); }
+    reverse_iterator rend() const noexcept { return reverse_iterator(begin()); }
+
+    reference operator[](const size_type i) const noexcept { return data_[i]; }
+
+    /**
+     * Returns the view of `count` elements starting at `offset`, clamped to the
+     * end of this span.
+     */
+    span subspan(size_type offset, size_type count = size_type(-1)) const noexcept
+    {
+        if(offset > size_) { offset = size_; }
+        if(count > size_ - offset) { count = size_ - offset; }
+        return span(data_ + offset, count);
+    }
+
+private:
+    pointer data_ = nullptr;
+    size_type size_ = 0;
+};
+
+} // namespace mio
+
+#endif // MIO_SPAN_HEADER
@@ -0,0 +1,169 @@
+#ifndef MIO_SPARSE_READER_HEADER
+#define MIO_SPARSE_READER_HEADER
+
+#include "mio/chunk_reader.hpp"
+#include "mio/mmap.hpp"
+#include "mio/page.hpp"
+#include "mio/span.hpp"
+
+#include <algorithm>
+#include <system_error>
+#include <vector>
+
+namespace mio {
+
+/**
+ * Reads the data of a mapped sparse file in chunks, like `basic_mmap_chunk_reader`,
+ * skipping its holes. Reading a hole through a mapping faults in a zero page for
+ * each of its pages, so scanning a mostly empty file otherwise costs as much as
+ * scanning a full one.
+ *
+ * Chunks never span two extents; `offset_of` tells where in the mapping a chunk
+ * starts. The extents are those of `basic_mmap::data_extents` unless given. If they
+ * can't be queried, the whole mapping is read, and `error` reports why.
+ *
+ * To scan in parallel, split the extents with `split_extents` and give each thread
+ * a reader of its own part. The reader does not own the mapping, which must outlive
+ * it.
+ */
+template<typename ByteT>
+class basic_mmap_sparse_reader
+{
+public:
+    using value_type = ByteT;
+    using size_type = size_t;
+    using span_type = span<const ByteT>;
+    using iterator = chunk_iterator<basic_mmap_sparse_reader>;
+
+    template<typename MMap>
+    basic_mmap_sparse_reader(const MMap& mmap, size_type chunk_size)
+        : data_(mmap.data())
+        , chunk_size_(std::max<size_type>(chunk_size, 1))
+    {
+        extents_ = mmap.data_extents(error_);
+        if(error_ && mmap.size() > 0) { extents_.assign(1, data_extent{ 0, mmap.size() }); }
+        init(mmap.size());
+    }
+
+    /** Reads only the given extents of the mapping, e.g. one part of a split. */
+    template<typename MMap>
+    basic_mmap_sparse_reader(const MMap& mmap, std::vector<data_extent> extents,
+            size_type chunk_size)
+        : data_(mmap.data())
+        , chunk_size_(std::max<size_type>(chunk_size, 1))
+        , extents_(std::move(extents))
+    {
+        init(mmap.size());
+    }
+
+    /**
+     * Sets `chunk` to the next chunk of data and returns true, or returns false once
+     * all extents were read. `error` is always cleared.
+     */
+    bool next(span_type& chunk, std::error_code& error) noexcept
+    {
+        error.clear();
+        while(extent_ < extents_.size() && position_in_extent_ >= extents_[extent_].length)
+        {
+            ++extent_;
+            position_in_extent_ = 0;
+        }
+        if(extent_ >= extents_.size()) { return false; }
+        const data_extent& extent = extents_[extent_];
+        const size_type length = std::min(chunk_size_, extent.length - position_in_extent_);
+        chunk = span_type(data_ + extent.offset + position_in_extent_, length);
+        position_in_extent_ += length;
+        position_ += length;
+        return true;
+    }
+
+    iterator begin() { return iterator(*this); }
+    iterator end() { return iterator(); }
+
+    /** Returns the number of bytes of data to be read, holes excluded. */
+    size_type size() const noexcept { return size_; }
+    size_type position() const noexcept { return position_; }
+    size_type chunk_size() const noexcept { return chunk_size_; }
+    std::error_code error() const noexcept { return error_; }
+
+    const std::vector<data_extent>& extents() const noexcept { return extents_; }
+
+    /** Returns the offset of `chunk` from the start of the mapping. */
+    size_type offset_of(const span_type& chunk) const noexcept
+    {
+        return static_cast<size_type>(chunk.data() - data_);
+    }
+
+private:
+    /** Clips the extents to the mapping, which may have shrunk since. */
+    void init(size_type mapping_size) noexcept
+    {
+        for(auto& extent : extents_)
+        {
+            extent.offset = std::min(extent.offset, mapping_size);
+            extent.length = std::min(extent.length, mapping_size - extent.offset);
+            size_ += extent.length;
+        }
+    }
+
+    const ByteT* data_;
+    size_type chunk_size_;
+    std::vector<data_extent> extents_;
+    std::error_code error_;
+    size_type size_ = 0;
+    size_type position_ = 0;
+    size_type extent_ = 0;
+    size_type position_in_extent_ = 0;
+};
+
+using mmap_sparse_reader = basic_mmap_sparse_reader<char>;
+using ummap_sparse_reader = basic_mmap_sparse_reader<unsigned char>;
+
+/**
+ * Splits `extents` into at most `parts` consecutive parts holding about the same
+ * number of bytes, for as many threads to scan. Extents are split where needed, at
+ * multiples of `alignment` bytes so that no two parts share a page.
+ */
+inline std::vector<std::vector<data_extent>> split_extents(
+        const std::vector<data_extent>& extents, size_t parts,
+        size_t alignment = page_size())
+{
+    std::vector<std::vector<data_extent>> result;
+    size_t total = 0;
+    for(const auto& extent : extents) { total += extent.length; }
+    if(total == 0) { return result; }
+    parts = std::max<size_t>(std::min(parts, total), 1);
+    alignment = std::max<size_t>(alignment, 1);
+    const size_t target = (total + parts - 1) / parts;
+
+    result.emplace_back();
+    size_t in_part = 0;
+    for(data_extent extent : extents)
+    {
+        while(extent.length > 0)
+        {
+            if(in_part >= target && result.size() < parts)
+            {
+                result.emplace_back();
+                in_part = 0;
+            }
+            size_t length = extent.length;
+            if(result.size() < parts && in_part + length > target)
+            {
+                // End the part at the first aligned offset past the target.
+                const size_t end = (extent.offset + target - in_part + alignment - 1)
+                    / alignment * alignment;
+                length = std::min(extent.length, std::max<size_t>(end - extent.offset, 1));
+            }
+            result.back().push_back(data_extent{ extent.offset, length });
+            in_part += length;
+            extent.offset += length;
+            extent.length -= length;
+        }
+    }
+    return result;
+}
+
+} // namespace mio
+
+#endif // MIO_SPARSE_READER_HEADER
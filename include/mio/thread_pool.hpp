@@ -0,0 +1,96 @@
+#ifndef MIO_THREAD_POOL_HEADER
+#define MIO_THREAD_POOL_HEADER
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mio {
+
+/**
+ * A fixed-size pool of worker threads executing tasks in FIFO order.
+ *
+ * mio's asynchronous operations run their blocking system calls here rather than
+ * on the calling thread. Unless one is explicitly provided, they all share the
+ * pool returned by `default_thread_pool`.
+ */
+class thread_pool
+{
+public:
+    /** Starts `num_threads` workers (at least one). */
+    explicit thread_pool(size_t num_threads = std::thread::hardware_concurrency())
+    {
+        if(num_threads == 0) { num_threads = 1; }
+        threads_.reserve(num_threads);
+        for(size_t i = 0; i < num_threads; ++i)
+        {
+            threads_.emplace_back([this] { run(); });
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    /** Runs all tasks posted so far, then joins the workers. */
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for(auto& thread : threads_) { thread.join(); }
+    }
+
+    /** Queues `task` to be run on one of the workers. */
+    void post(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+    size_t size() const noexcept { return threads_.size(); }
+
+private:
+    void run()
+    {
+        for(;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if(tasks_.empty()) { return; }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> threads_;
+    bool stopping_ = false;
+};
+
+/**
+ * Returns the pool shared by mio's asynchronous operations. It is created on first
+ * use, with one worker per hardware thread.
+ */
+inline thread_pool& default_thread_pool()
+{
+    static thread_pool pool;
+    return pool;
+}
+
+} // namespace mio
+
+#endif // MIO_THREAD_POOL_HEADER
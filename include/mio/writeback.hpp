@@ -0,0 +1,282 @@
+#ifndef MIO_WRITEBACK_HEADER
+#define MIO_WRITEBACK_HEADER
+
+#include "mio/mmap.hpp"
+#include "mio/page.hpp"
+#include "mio/detail/sync.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#ifdef __linux__
+# include <fcntl.h>
+#endif
+
+namespace mio {
+
+enum class writeback_method
+{
+    // `sync_file_range` on Linux, `async_msync` elsewhere.
+    automatic,
+    // Linux's `sync_file_range`, which starts writing a range back without waiting.
+    sync_file_range,
+    // `msync(MS_ASYNC)`. Note that Linux merely marks the pages for the kernel's
+    // periodic writeback with it, rather than starting to write them.
+    async_msync
+};
+
+struct writeback_options
+{
+    // Dirty ranges are flushed at least this often. 0 disables timed flushes.
+    std::chrono::milliseconds interval = std::chrono::milliseconds(1000);
+
+    // Dirty ranges are flushed as soon as this many bytes were reported written with
+    // `note_written`. Writers are held back once twice as much is waiting to be
+    // flushed. 0 disables this threshold.
+    size_t dirty_bytes_limit = 64 << 20;
+
+    writeback_method method = writeback_method::automatic;
+};
+
+/**
+ * Writes the dirty pages of a writable mapping back to the file in the background,
+ * so that they don't pile up until `sync`, the destructor or the kernel's writeback
+ * flush them all at once and stall writers in the process.
+ *
+ * Writers report what they modify with `note_written`. A background thread starts
+ * writing back the reported ranges whenever `dirty_bytes_limit` bytes have been
+ * reported or `interval` has elapsed. If nothing is ever reported, the whole mapping
+ * is flushed every `interval` instead.
+ *
+ * With `sync_file_range`, the previously flushed range is waited for after starting
+ * the next one, which bounds the amount of data under writeback to about two flushes'
+ * worth. This doesn't make anything durable: that still takes `sync`.
+ *
+ * The mapping must outlive this object and must not be remapped while it's in use.
+ */
+class writeback
+{
+public:
+    using size_type = size_t;
+    using duration = std::chrono::nanoseconds;
+
+    struct statistics
+    {
+        // Number of flushes started because of `interval` and `dirty_bytes_limit`.
+        uint64_t timed_flushes = 0;
+        uint64_t threshold_flushes = 0;
+        // Number of bytes in the flushed ranges, widened to page boundaries.
+        uint64_t bytes_flushed = 0;
+        // Time the background thread spent waiting for earlier flushes to complete.
+        duration flush_wait_time = duration::zero();
+        // Time writers spent held back in `note_written`.
+        duration writer_stall_time = duration::zero();
+        // Number of flushes that failed.
+        uint64_t errors = 0;
+
+        uint64_t flushes() const noexcept { return timed_flushes + threshold_flushes; }
+    };
+
+    template<typename MMap>
+    explicit writeback(const MMap& mmap, writeback_options options = writeback_options())
+        : mapping_start_(reinterpret_cast<const char*>(mmap.data()) - mmap.mapping_offset())
+        , mapped_length_(mmap.mapped_length())
+        , mapping_offset_(mmap.mapping_offset())
+        , mapping_file_offset_(mmap.file_offset() - mmap.mapping_offset())
+        , file_handle_(mmap.file_handle())
+        , options_(resolve(options))
+        , thread_([this] { run(); })
+    {}
+
+    writeback(const writeback&) = delete;
+    writeback& operator=(const writeback&) = delete;
+
+    /** Starts writing back what's still dirty, then stops the background thread. */
+    ~writeback()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    /**
+     * Reports that the `length` bytes at `offset`, relative to the mapping's `data`,
+     * were modified. This blocks while twice `dirty_bytes_limit` bytes are waiting to
+     * be flushed.
+     */
+    void note_written(size_type offset, size_type length)
+    {
+        if(length == 0) { return; }
+        const size_type begin = mapping_offset_ + offset;
+        const size_type end = std::min(begin + length, mapped_length_);
+        if(begin >= end) { return; }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        const size_type limit = options_.dirty_bytes_limit;
+        if(limit > 0 && dirty_bytes_ >= 2 * limit)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            flushed_cv_.wait(lock, [&] { return stop_ || dirty_bytes_ < 2 * limit; });
+            stats_.writer_stall_time += std::chrono::steady_clock::now() - start;
+        }
+        is_tracking_ = true;
+        dirty_begin_ = dirty_bytes_ == 0 ? begin : std::min(dirty_begin_, begin);
+        dirty_end_ = dirty_bytes_ == 0 ? end : std::max(dirty_end_, end);
+        dirty_bytes_ += end - begin;
+        if(limit > 0 && dirty_bytes_ >= limit) { cv_.notify_one(); }
+    }
+
+    /** Returns the number of bytes reported written but not flushed yet. */
+    size_type dirty_bytes() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dirty_bytes_;
+    }
+
+    statistics stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    static writeback_options resolve(writeback_options options) noexcept
+    {
+#ifdef __linux__
+        if(options.method == writeback_method::automatic)
+        {
+            options.method = writeback_method::sync_file_range;
+        }
+#else
+        options.method = writeback_method::async_msync;
+#endif
+        return options;
+    }
+
+    void run()
+    {
+        using clock = std::chrono::steady_clock;
+        const size_type limit = options_.dirty_bytes_limit;
+        auto deadline = clock::now() + options_.interval;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for(;;)
+        {
+            const auto over_limit = [&] { return stop_ || (limit > 0 && dirty_bytes_ >= limit); };
+            bool is_timed = false;
+            if(options_.interval.count() > 0)
+            {
+                is_timed = !cv_.wait_until(lock, deadline, over_limit);
+            }
+            else
+            {
+                cv_.wait(lock, over_limit);
+            }
+            if(is_timed || clock::now() >= deadline) { deadline = clock::now() + options_.interval; }
+
+            size_type begin = 0;
+            size_type end = mapped_length_;
+            if(is_tracking_)
+            {
+                begin = dirty_begin_;
+                end = dirty_end_;
+                if(dirty_bytes_ == 0) { begin = end = 0; }
+            }
+            dirty_bytes_ = 0;
+            const bool should_stop = stop_;
+            lock.unlock();
+            flushed_cv_.notify_all();
+
+            std::error_code error;
+            duration waited = duration::zero();
+            if(begin < end) { flush(begin, end, waited, error); }
+
+            lock.lock();
+            if(begin < end)
+            {
+                (is_timed ? stats_.timed_flushes : stats_.threshold_flushes) += 1;
+                stats_.bytes_flushed += make_offset_page_aligned(end + page_size() - 1)
+                    - make_offset_page_aligned(begin);
+            }
+            stats_.flush_wait_time += waited;
+            if(error) { ++stats_.errors; }
+            if(should_stop) { return; }
+        }
+    }
+
+    /** Starts writing back the mapping's `[begin, end)` range. */
+    void flush(size_type begin, size_type end, duration& waited, std::error_code& error)
+    {
+#ifdef __linux__
+        if(options_.method == writeback_method::sync_file_range)
+        {
+            begin = make_offset_page_aligned(begin);
+            const auto file_begin = static_cast<off64_t>(mapping_file_offset_ + begin);
+            const auto length = static_cast<off64_t>(end - begin);
+            if(::sync_file_range(file_handle_, file_begin, length, SYNC_FILE_RANGE_WRITE) != 0)
+            {
+                error = detail::last_error();
+                return;
+            }
+            // Wait for the previous range while the new one is being written.
+            finish(waited);
+            previous_begin_ = file_begin;
+            previous_length_ = length;
+            return;
+        }
+#endif
+        (void)waited;
+        detail::sync_range(mapping_start_, mapped_length_, begin, end - begin,
+            file_handle_, false, error);
+    }
+
+    /** Waits for the previously started range to be written. */
+    void finish(duration& waited)
+    {
+#ifdef __linux__
+        if(previous_length_ > 0)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            ::sync_file_range(file_handle_, previous_begin_, previous_length_,
+                SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+            waited += std::chrono::steady_clock::now() - start;
+            previous_length_ = 0;
+        }
+#else
+        (void)waited;
+#endif
+    }
+
+    const char* mapping_start_;
+    size_type mapped_length_;
+    size_type mapping_offset_;
+    size_type mapping_file_offset_;
+    file_handle_type file_handle_;
+    writeback_options options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable flushed_cv_;
+    size_type dirty_begin_ = 0;
+    size_type dirty_end_ = 0;
+    size_type dirty_bytes_ = 0;
+    bool is_tracking_ = false;
+    bool stop_ = false;
+    statistics stats_;
+#ifdef __linux__
+    off64_t previous_begin_ = 0;
+    off64_t previous_length_ = 0;
+#endif
+    std::thread thread_;
+};
+
+} // namespace mio
+
+#endif // MIO_WRITEBACK_HEADER
@@ -45,10 +45,13 @@
 #ifndef MIO_PAGE_HEADER
 #define MIO_PAGE_HEADER
 
+#include <cstddef>
+
 #ifdef _WIN32
 # include <windows.h>
 #else
 # include <unistd.h>
+# include <sys/mman.h>
 #endif
 
 namespace mio {
@@ -97,6 +100,65 @@ inline size_t make_offset_page_aligned(size_t offset) noexcept
     return offset / page_size_ * page_size_;
 }
 
+/**
+ * Returns whether all pages overlapping the `length` bytes at `address`, which must
+ * lie within a memory mapping, are resident in memory, i.e. whether accessing them
+ * won't incur a major page fault. This is a snapshot; pages may be evicted at any
+ * time after the call.
+ *
+ * Residency cannot be queried on Windows, where all pages are reported resident.
+ */
+inline bool is_resident(const void* address, size_t length) noexcept
+{
+#ifdef _WIN32
+    (void)address;
+    (void)length;
+    return true;
+#else
+    if(length == 0) { return true; }
+    const size_t page_size_ = page_size();
+    const size_t start = make_offset_page_aligned(reinterpret_cast<size_t>(address));
+    const size_t end = reinterpret_cast<size_t>(address) + length;
+    // Query in fixed size batches so as not to allocate.
+    unsigned char vec[64];
+    for(size_t pos = start; pos < end; pos += sizeof(vec) * page_size_)
+    {
+        const size_t batch = end - pos < sizeof(vec) * page_size_
+            ? end - pos : sizeof(vec) * page_size_;
+        if(::mincore(reinterpret_cast<void*>(pos), batch, vec) != 0) { return false; }
+        const size_t num_pages = (batch + page_size_ - 1) / page_size_;
+        for(size_t i = 0; i < num_pages; ++i)
+        {
+            if(!(vec[i] & 1)) { return false; }
+        }
+    }
+    return true;
+#endif
+}
+
+/**
+ * Populates the pages overlapping the `length` bytes at `address`, which must lie
+ * within a memory mapping, by hinting the kernel to read them ahead and then
+ * touching each of them. This blocks until all pages are resident, and is meant to
+ * be run off the thread that is going to access the data.
+ */
+inline void prefault(const void* address, size_t length) noexcept
+{
+    if(length == 0) { return; }
+    const size_t page_size_ = page_size();
+    const size_t start = make_offset_page_aligned(reinterpret_cast<size_t>(address));
+    const size_t end = reinterpret_cast<size_t>(address) + length;
+#ifndef _WIN32
+    ::madvise(reinterpret_cast<void*>(start), end - start, MADV_WILLNEED);
+#endif
+    for(size_t pos = start; pos < end; pos += page_size_)
+    {
+        // The first page may start before `address`, but it is still part of the
+        // same mapping, as mappings are page aligned.
+        (void)*reinterpret_cast<const volatile char*>(pos);
+    }
+}
+
 } // namespace mio
 
 #endif // MIO_PAGE_HEADER
@@ -106,6 +168,7 @@ inline size_t make_offset_page_aligned(size_t offset) noexcept
 #include <string>
 #include <system_error>
 #include <cstdint>
+#include <vector>
 
 #ifdef _WIN32
 # ifndef WIN32_LEAN_AND_MEAN
@@ -132,6 +195,69 @@ using file_handle_type = int;
 // determine whether `basic_mmap::file_handle` is valid, for example.
 const static file_handle_type invalid_handle = INVALID_HANDLE_VALUE;
 
+/** How a file is going to be accessed. */
+enum class access_pattern
+{
+    // No particular pattern.
+    normal,
+    // A single front to back pass, which streaming reads serve best.
+    sequential,
+    // Scattered accesses, for which the kernel's readahead is disabled.
+    random
+};
+
+/** Whether opening a file by path may create it. */
+enum class creation_policy
+{
+    // Writable mappings create the file if it doesn't exist, read-only ones don't
+    // (except on Windows, where both do).
+    open_or_create,
+    // The file must exist.
+    open_existing,
+    // The file must not exist, and is created.
+    create_new
+};
+
+/** How `map` and `make_mmap` open a file given by path. */
+struct open_options
+{
+    creation_policy creation = creation_policy::open_or_create;
+
+    // Whether reads leave the file's access time alone (`O_NOATIME`), which saves a
+    // metadata write on file systems mounted without `noatime` or `relatime`. Only
+    // the file's owner may do so; for others this is ignored. Linux only.
+    bool no_atime = false;
+
+    // Whether the file handle is closed in child processes started with `exec`
+    // (`O_CLOEXEC`). Off by default, so that handles are inherited as they always
+    // were; multithreaded programs that spawn processes should turn it on. Handles
+    // are never inherited on Windows.
+    bool close_on_exec = false;
+
+    // The size an empty file is given when opened for writing, as it can't be mapped
+    // otherwise. 0 means a page.
+    size_t initial_size = 0;
+
+    // Whether the initial size is allocated on disk up front (`posix_fallocate`),
+    // rather than leaving a sparse file to be filled in as pages are written back.
+    bool preallocate = false;
+
+    // Handed to the kernel for the whole file with `posix_fadvise`, or as a
+    // `FILE_FLAG_SEQUENTIAL_SCAN` or `FILE_FLAG_RANDOM_ACCESS` flag on Windows.
+    access_pattern pattern = access_pattern::normal;
+
+    // Number of bytes from the start of the mapped range that the kernel is asked to
+    // read ahead right away (`POSIX_FADV_WILLNEED`). POSIX only.
+    size_t readahead = 0;
+};
+
+/** A range of a mapping, as an offset from its first byte and a length. */
+struct data_extent
+{
+    size_t offset;
+    size_t length;
+};
+
 template<access_mode AccessMode, typename ByteT>
 struct basic_mmap
 {
@@ -160,6 +286,15 @@ private:
     size_type length_ = 0;
     size_type mapped_length_ = 0;
 
+    // Offset--in bytes--of the first requested byte relative to the start of
+    // the file, as requested by user.
+    size_type file_offset_ = 0;
+
+    // Start and length of the address range reserved by `reserve`, in which the
+    // mapping grows and shrinks in place, or null and 0 if none was reserved.
+    pointer reservation_ = nullptr;
+    size_type reserved_length_ = 0;
+
     // Letting user map a file using both an existing file handle and a path
     // introcudes some complexity (see `is_handle_internal_`).
     // On POSIX, we only need a file handle to create a mapping, while on
@@ -200,6 +335,20 @@ public:
         if(error) { throw std::system_error(error); }
     }
 
+    /**
+     * The same as invoking the `map` function, except any error that may occur
+     * while establishing the mapping is wrapped in a `std::system_error` and is
+     * thrown.
+     */
+    template<typename String>
+    basic_mmap(const String& path, const size_type offset, const size_type length,
+            const open_options& options)
+    {
+        std::error_code error;
+        map(path, offset, length, options, error);
+        if(error) { throw std::system_error(error); }
+    }
+
     /**
      * The same as invoking the `map` function, except any error that may occur
      * while establishing the mapping is wrapped in a `std::system_error` and is
@@ -265,6 +414,22 @@ public:
         return mapped_length_ - length_;
     }
 
+    /**
+     * Returns the offset of the first requested byte relative to the start of
+     * the file, i.e. the `offset` that was passed to `map` or `remap`.
+     */
+    size_type file_offset() const noexcept { return file_offset_; }
+
+    /**
+     * Returns the number of bytes from `data` to which the mapping may grow without
+     * moving, which is its length unless address space was reserved with `reserve`.
+     */
+    size_type capacity() const noexcept
+    {
+        return reservation_ ? reserved_length_ - (file_offset_ - make_offset_page_aligned(file_offset_))
+            : length_;
+    }
+
     /**
      * Returns a pointer to the first requested byte, or `nullptr` if no memory mapping
      * exists.
@@ -354,7 +519,18 @@ public:
      */
     template<typename String>
     void map(const String& path, const size_type offset,
-            const size_type length, std::error_code& error);
+            const size_type length, std::error_code& error)
+    {
+        map(path, offset, length, open_options(), error);
+    }
+
+    /**
+     * The same as the above, except that the file is opened as described by
+     * `options`.
+     */
+    template<typename String>
+    void map(const String& path, const size_type offset, const size_type length,
+            const open_options& options, std::error_code& error);
 
     /**
      * Establishes a memory mapping with AccessMode. If the mapping is unsuccesful, the
@@ -423,6 +599,17 @@ public:
      */
     void unmap();
 
+    template<access_mode A = AccessMode>
+    typename std::enable_if<A == access_mode::write, void>::type
+    remap(const size_type new_offset, size_type new_length, std::error_code& error);
+
+    template<access_mode A = AccessMode>
+    typename std::enable_if<A == access_mode::write, void>::type
+    remap(size_type new_length, std::error_code& error)
+    {
+        remap(0, new_length, error);
+    }
+
     void swap(basic_mmap& other);
 
     /** Flushes the memory mapped page to disk. Errors are reported via `error`. */
@@ -430,6 +617,54 @@ public:
     typename std::enable_if<A == access_mode::write, void>::type
     sync(std::error_code& error);
 
+    /**
+     * Resizes the underlying file to `file_size` bytes and remaps the region
+     * from `file_offset` to the new end of file. If the new end of file does not
+     * lie beyond `file_offset`, the mapped region is released while the file
+     * handle is kept open, so a later `truncate` or `remap` may extend it again.
+     * Errors are reported via `error`.
+     */
+    template<access_mode A = AccessMode>
+    typename std::enable_if<A == access_mode::write, void>::type
+    truncate(size_type file_size, std::error_code& error);
+
+    /**
+     * Reserves address space for the mapping to grow to `capacity` bytes from `data`.
+     * The range beyond the mapped length is inaccessible and takes up no memory.
+     *
+     * From then on, `remap`, `truncate` and `extend_to_file` calls that keep the file
+     * offset grow or shrink the mapping in place: `data`, and any pointer into the
+     * mapping, remain valid, and only the pages added are mapped, so those already
+     * mapped needn't be faulted in again. Growing beyond the capacity fails with
+     * `not_enough_memory` and leaves the mapping as it was.
+     *
+     * Like `std::vector::reserve`, this moves the mapping if it raises the capacity,
+     * which is the only way a reserved mapping moves.
+     * Remapping at a different file offset gives up the reservation. This is only
+     * supported on POSIX systems; errors are reported via `error`.
+     */
+    void reserve(size_type capacity, std::error_code& error);
+
+    /**
+     * Extends the mapping to the end of the file, which may have grown since it was
+     * mapped, e.g. by another process appending to it. The file itself is never
+     * resized. Within address space reserved with `reserve` the mapping grows in
+     * place, and fails with `not_enough_memory` if the file outgrew the capacity;
+     * otherwise the file is mapped anew and `data` changes. Nothing happens if the
+     * file didn't grow past the mapping. Errors are reported via `error`.
+     */
+    void extend_to_file(std::error_code& error);
+
+    /**
+     * Returns the ranges of the mapping that hold data in the file, in order, so
+     * that scans of sparse files may skip their holes, which only read as zeros.
+     * The ranges are found with `SEEK_DATA` and `SEEK_HOLE` at the file system's
+     * granularity; the file handle's offset is restored afterwards, but is moved
+     * meanwhile, so the handle mustn't be used concurrently. Where holes can't be
+     * found, the whole mapping is one range. Errors are reported via `error`.
+     */
+    std::vector<data_extent> data_extents(std::error_code& error) const;
+
     /**
      * All operators compare the address of the first byte and size of the two mapped
      * regions.
@@ -459,6 +694,9 @@ private:
     conditional_sync();
     template<access_mode A = AccessMode>
     typename std::enable_if<A == access_mode::read, void>::type conditional_sync();
+
+    /** Resizes the mapping within the reserved range, without moving it. */
+    void remap_in_place(size_type new_length, std::error_code& error);
 };
 
 template<access_mode AccessMode, typename ByteT>
@@ -524,6 +762,21 @@ template<
     return mmap;
 }
 
+/**
+ * The same as the above, except that a file given by path is opened as described
+ * by `options`.
+ */
+template<
+    typename MMap,
+    typename String
+> MMap make_mmap(const String& path, int64_t offset, int64_t length,
+        const open_options& options, std::error_code& error)
+{
+    MMap mmap;
+    mmap.map(path, offset, length, options, error);
+    return mmap;
+}
+
 /**
  * Convenience factory method.
  *
@@ -544,6 +797,13 @@ mmap_source make_mmap_source(const MappingToken& token, std::error_code& error)
     return make_mmap_source(token, 0, map_entire_file, error);
 }
 
+template<typename String>
+mmap_source make_mmap_source(const String& path, mmap_source::size_type offset,
+        mmap_source::size_type length, const open_options& options, std::error_code& error)
+{
+    return make_mmap<mmap_source>(path, offset, length, options, error);
+}
+
 /**
  * Convenience factory method.
  *
@@ -564,6 +824,13 @@ mmap_sink make_mmap_sink(const MappingToken& token, std::error_code& error)
     return make_mmap_sink(token, 0, map_entire_file, error);
 }
 
+template<typename String>
+mmap_sink make_mmap_sink(const String& path, mmap_sink::size_type offset,
+        mmap_sink::size_type length, const open_options& options, std::error_code& error)
+{
+    return make_mmap<mmap_sink>(path, offset, length, options, error);
+}
+
 } // namespace mio
 
 // #include "detail/mmap.ipp"
@@ -768,6 +1035,7 @@ template<
 
 
 #include <algorithm>
+#include <vector>
 
 #ifndef _WIN32
 # include <unistd.h>
@@ -807,19 +1075,40 @@ inline std::wstring s_2_ws(const std::string& s)
     return ret;
 }
 
+inline DWORD creation_disposition(const creation_policy creation) noexcept
+{
+    switch(creation)
+    {
+    case creation_policy::open_existing: return OPEN_EXISTING;
+    case creation_policy::create_new: return CREATE_NEW;
+    default: return OPEN_ALWAYS;
+    }
+}
+
+inline DWORD flags_and_attributes(const access_pattern pattern) noexcept
+{
+    switch(pattern)
+    {
+    case access_pattern::sequential: return FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN;
+    case access_pattern::random: return FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS;
+    default: return FILE_ATTRIBUTE_NORMAL;
+    }
+}
+
 template<
     typename String,
     typename = typename std::enable_if<
         std::is_same<typename char_type<String>::type, char>::value
     >::type
-> file_handle_type open_file_helper(const String& path, const access_mode mode)
+> file_handle_type open_file_helper(const String& path, const access_mode mode,
+        const open_options& options)
 {
-    return ::CreateFileW(s_2_ws(path).c_str(),
+    return ::CreateFileA(c_str(path),
             mode == access_mode::read ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
             FILE_SHARE_READ | FILE_SHARE_WRITE,
             0,
-            OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL,
+            creation_disposition(options.creation),
+            flags_and_attributes(options.pattern),
             0);
 }
 
@@ -827,14 +1116,15 @@ template<typename String>
 typename std::enable_if<
     std::is_same<typename char_type<String>::type, wchar_t>::value,
     file_handle_type
->::type open_file_helper(const String& path, const access_mode mode)
+>::type open_file_helper(const String& path, const access_mode mode,
+        const open_options& options)
 {
     return ::CreateFileW(c_str(path),
             mode == access_mode::read ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
             FILE_SHARE_READ | FILE_SHARE_WRITE,
             0,
-            OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL,
+            creation_disposition(options.creation),
+            flags_and_attributes(options.pattern),
             0);
 }
 
@@ -856,51 +1146,154 @@ inline std::error_code last_error() noexcept
     return error;
 }
 
-template<typename String>
-file_handle_type open_file(const String& path, const access_mode mode,
-        std::error_code& error)
+inline int64_t query_file_size(file_handle_type handle, std::error_code& error)
 {
     error.clear();
-    if(detail::empty(path))
+#ifdef _WIN32
+    LARGE_INTEGER file_size;
+    if(::GetFileSizeEx(handle, &file_size) == 0)
     {
-        error = std::make_error_code(std::errc::invalid_argument);
-        return invalid_handle;
+        error = detail::last_error();
+        return 0;
     }
-#ifdef _WIN32
-    const auto handle = win::open_file_helper(path, mode);
+	return static_cast<int64_t>(file_size.QuadPart);
 #else // POSIX
-    const auto handle = ::open(c_str(path),
-            mode == access_mode::read ? O_RDONLY : O_RDWR);
-#endif
-    if(handle == invalid_handle)
+    struct stat sbuf;
+    if(::fstat(handle, &sbuf) == -1)
     {
         error = detail::last_error();
+        return 0;
     }
-    return handle;
+    return sbuf.st_size;
+#endif
 }
 
-inline size_t query_file_size(file_handle_type handle, std::error_code& error)
+/** Closes `handle`, which must have been obtained through `open_file`. */
+inline void close_file(file_handle_type handle) noexcept
+{
+#ifdef _WIN32
+    ::CloseHandle(handle);
+#else // POSIX
+    ::close(handle);
+#endif
+}
+
+/**
+ * Sets the size of the file behind `handle` to `size` bytes, allocating them on disk
+ * if `preallocate` is set.
+ */
+inline void resize_file(file_handle_type handle, int64_t size, bool preallocate,
+        std::error_code& error)
 {
-    error.clear();
 #ifdef _WIN32
+    (void)preallocate;
     LARGE_INTEGER file_size;
-    if(::GetFileSizeEx(handle, &file_size) == 0)
+    file_size.QuadPart = size;
+    if(::SetFilePointerEx(handle, file_size, nullptr, FILE_BEGIN) == 0
+       || ::SetEndOfFile(handle) == 0)
     {
         error = detail::last_error();
-        return 0;
     }
-	return static_cast<int64_t>(file_size.QuadPart);
 #else // POSIX
-    struct stat sbuf;
-    if(::fstat(handle, &sbuf) == -1)
+# if !defined(__APPLE__)
+    if(preallocate)
     {
-        error = detail::last_error();
-        return 0;
+        const int ret = ::posix_fallocate(handle, 0, static_cast<off_t>(size));
+        if(ret == 0) { return; }
+        // Not all file systems support it, in which case the file is left sparse.
+        if(ret != EOPNOTSUPP && ret != EINVAL)
+        {
+            error = std::error_code(ret, std::system_category());
+            return;
+        }
     }
-    return sbuf.st_size;
+# else
+    (void)preallocate;
+# endif
+    if(::ftruncate(handle, static_cast<off_t>(size)) == -1) { error = detail::last_error(); }
+#endif
+}
+
+/** Passes `pattern` on to the kernel for the whole file. Errors are ignored. */
+inline void advise_file(file_handle_type handle, const access_pattern pattern) noexcept
+{
+#if defined(POSIX_FADV_SEQUENTIAL)
+    if(pattern != access_pattern::normal)
+    {
+        ::posix_fadvise(handle, 0, 0, pattern == access_pattern::sequential
+            ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_RANDOM);
+    }
+#else
+    // On Windows, the pattern is given when the file is opened.
+    (void)handle;
+    (void)pattern;
 #endif
 }
 
+template<typename String>
+file_handle_type open_file(const String& path, const access_mode mode,
+        const open_options& options, std::error_code& error)
+{
+    error.clear();
+    if(detail::empty(path))
+    {
+        error = std::make_error_code(std::errc::invalid_argument);
+        return invalid_handle;
+    }
+#ifdef _WIN32
+    const auto handle = win::open_file_helper(path, mode, options);
+#else // POSIX
+    int flags = mode == access_mode::read ? O_RDONLY : O_RDWR;
+    if(options.creation == creation_policy::create_new) { flags |= O_CREAT | O_EXCL; }
+    else if(options.creation == creation_policy::open_or_create
+            && mode == access_mode::write)
+    {
+        flags |= O_CREAT;
+    }
+    if(options.close_on_exec) { flags |= O_CLOEXEC; }
+# ifdef O_NOATIME
+    if(options.no_atime) { flags |= O_NOATIME; }
+# endif
+    auto handle = ::open(c_str(path), flags, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+# ifdef O_NOATIME
+    // Only the file's owner may open it with `O_NOATIME`.
+    if(handle == invalid_handle && errno == EPERM && (flags & O_NOATIME))
+    {
+        handle = ::open(c_str(path), flags & ~O_NOATIME, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+    }
+# endif
+#endif
+    if(handle == invalid_handle)
+    {
+        error = detail::last_error();
+        return invalid_handle;
+    }
+
+    if (mode == access_mode::write)
+    {
+        if (query_file_size(handle, error) == 0 && !error)
+        {
+            resize_file(handle, options.initial_size > 0
+                ? options.initial_size : page_size(), options.preallocate, error);
+        }
+        if (error)
+        {
+            close_file(handle);
+            return invalid_handle;
+        }
+    }
+    advise_file(handle, options.pattern);
+
+    return handle;
+}
+
+template<typename String>
+file_handle_type open_file(const String& path, const access_mode mode,
+        std::error_code& error)
+{
+    return open_file(path, mode, open_options(), error);
+}
+
 struct mmap_context
 {
     char* data;
@@ -967,6 +1360,98 @@ inline mmap_context memory_map(const file_handle_type file_handle, const int64_t
     return ctx;
 }
 
+inline mmap_context memory_remap(
+    const file_handle_type file_handle, void* old_address, const int64_t old_length,
+    const int64_t new_offset, const int64_t new_length, const access_mode mode, std::error_code& error)
+{
+    const int64_t aligned_offset = make_offset_page_aligned(new_offset);
+    const int64_t length_to_map = new_offset - aligned_offset + new_length;
+    const int64_t max_file_size = new_offset + new_length;
+#ifdef _WIN32
+    const auto file_mapping_handle = ::CreateFileMapping(
+            file_handle,
+            0,
+            mode == access_mode::read ? PAGE_READONLY : PAGE_READWRITE,
+            win::int64_high(max_file_size),
+            win::int64_low(max_file_size),
+            0);
+    if(file_mapping_handle == invalid_handle)
+    {
+        error = detail::last_error();
+        return {};
+    }
+    char* mapping_start = static_cast<char*>(::MapViewOfFile(
+            file_mapping_handle,
+            mode == access_mode::read ? FILE_MAP_READ : FILE_MAP_WRITE,
+            win::int64_high(aligned_offset),
+            win::int64_low(aligned_offset),
+            length_to_map));
+    if(mapping_start == nullptr)
+    {
+        error = detail::last_error();
+        return {};
+    }
+#else // POSIX
+    const auto file_size = detail::query_file_size(file_handle, error);
+    if (error) return {};
+    if (max_file_size > file_size)
+    {    
+        //fallocate(file_handle, max_file_size); // todo: implement this if supported
+        ftruncate(file_handle, max_file_size);
+    }
+    char* mapping_start = static_cast<char*>(::mmap(
+            old_address,
+            length_to_map,
+            mode == access_mode::read ? PROT_READ : PROT_WRITE,
+            MAP_SHARED,
+            file_handle,
+            aligned_offset));
+    // TODO:
+    // char* mapping_start = static_cast<char*>(::mremap(
+    //         old_address,
+    //         old_length,
+    //         length_to_map,
+    //         MREMAP_MAYMOVE));
+    if(mapping_start == MAP_FAILED)
+    {
+        error = detail::last_error();
+        return {};
+    }
+#endif
+    mmap_context ctx;
+    ctx.data = mapping_start + new_offset - aligned_offset;
+    ctx.length = new_length;
+    ctx.mapped_length = length_to_map;
+#ifdef _WIN32
+    ctx.file_mapping_handle = file_mapping_handle;
+#endif
+    return ctx;
+}
+
+#ifndef _WIN32
+/** Rounds `length` up to a multiple of the page size. */
+inline size_t make_length_page_aligned(size_t length) noexcept
+{
+    return make_offset_page_aligned(length + page_size() - 1);
+}
+
+/** Reserves `length` bytes of inaccessible address space that commit no memory. */
+inline char* reserve_address_space(size_t length, std::error_code& error)
+{
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+    void* address = ::mmap(nullptr, length, PROT_NONE, flags, -1, 0);
+    if(address == MAP_FAILED)
+    {
+        error = detail::last_error();
+        return nullptr;
+    }
+    return static_cast<char*>(address);
+}
+#endif
+
 } // namespace detail
 
 // -- basic_mmap --
@@ -983,6 +1468,9 @@ basic_mmap<AccessMode, ByteT>::basic_mmap(basic_mmap&& other)
     : data_(std::move(other.data_))
     , length_(std::move(other.length_))
     , mapped_length_(std::move(other.mapped_length_))
+    , file_offset_(std::move(other.file_offset_))
+    , reservation_(std::move(other.reservation_))
+    , reserved_length_(std::move(other.reserved_length_))
     , file_handle_(std::move(other.file_handle_))
 #ifdef _WIN32
     , file_mapping_handle_(std::move(other.file_mapping_handle_))
@@ -991,6 +1479,9 @@ basic_mmap<AccessMode, ByteT>::basic_mmap(basic_mmap&& other)
 {
     other.data_ = nullptr;
     other.length_ = other.mapped_length_ = 0;
+    other.file_offset_ = 0;
+    other.reservation_ = nullptr;
+    other.reserved_length_ = 0;
     other.file_handle_ = invalid_handle;
 #ifdef _WIN32
     other.file_mapping_handle_ = invalid_handle;
@@ -1008,6 +1499,9 @@ basic_mmap<AccessMode, ByteT>::operator=(basic_mmap&& other)
         data_ = std::move(other.data_);
         length_ = std::move(other.length_);
         mapped_length_ = std::move(other.mapped_length_);
+        file_offset_ = std::move(other.file_offset_);
+        reservation_ = std::move(other.reservation_);
+        reserved_length_ = std::move(other.reserved_length_);
         file_handle_ = std::move(other.file_handle_);
 #ifdef _WIN32
         file_mapping_handle_ = std::move(other.file_mapping_handle_);
@@ -1019,6 +1513,9 @@ basic_mmap<AccessMode, ByteT>::operator=(basic_mmap&& other)
         // just moved into this.
         other.data_ = nullptr;
         other.length_ = other.mapped_length_ = 0;
+        other.file_offset_ = 0;
+        other.reservation_ = nullptr;
+        other.reserved_length_ = 0;
         other.file_handle_ = invalid_handle;
 #ifdef _WIN32
         other.file_mapping_handle_ = invalid_handle;
@@ -1042,26 +1539,30 @@ basic_mmap<AccessMode, ByteT>::mapping_handle() const noexcept
 template<access_mode AccessMode, typename ByteT>
 template<typename String>
 void basic_mmap<AccessMode, ByteT>::map(const String& path, const size_type offset,
-        const size_type length, std::error_code& error)
+        const size_type length, const open_options& options, std::error_code& error)
 {
     error.clear();
-    if(detail::empty(path))
-    {
-        error = std::make_error_code(std::errc::invalid_argument);
+    
+    const auto handle = detail::open_file(path, AccessMode, options, error);
+    if(error)
         return;
-    }
-    const auto handle = detail::open_file(path, AccessMode, error);
+    
+    map(handle, offset, length, error);
     if(error)
     {
+        detail::close_file(handle);
         return;
     }
+    // This MUST be after the call to map, as that sets this to false.
+    is_handle_internal_ = true;
 
-    map(handle, offset, length, error);
-    // This MUST be after the call to map, as that sets this to true.
-    if(!error)
+#ifdef POSIX_FADV_WILLNEED
+    if(options.readahead > 0)
     {
-        is_handle_internal_ = true;
+        ::posix_fadvise(handle, static_cast<off_t>(offset),
+            static_cast<off_t>(std::min(options.readahead, length_)), POSIX_FADV_WILLNEED);
     }
+#endif
 }
 
 template<access_mode AccessMode, typename ByteT>
@@ -1103,6 +1604,7 @@ void basic_mmap<AccessMode, ByteT>::map(const handle_type handle,
         data_ = reinterpret_cast<pointer>(ctx.data);
         length_ = ctx.length;
         mapped_length_ = ctx.mapped_length;
+        file_offset_ = offset;
 #ifdef _WIN32
         file_mapping_handle_ = ctx.file_mapping_handle;
 #endif
@@ -1142,6 +1644,53 @@ basic_mmap<AccessMode, ByteT>::sync(std::error_code& error)
 #endif
 }
 
+template <access_mode AccessMode, typename ByteT>
+template<access_mode A>
+typename std::enable_if<A == access_mode::write, void>::type
+basic_mmap<AccessMode, ByteT>::truncate(size_type file_size, std::error_code &error)
+{
+    error.clear();
+    if (!is_open())
+    {
+        error = std::make_error_code(std::errc::bad_file_descriptor);
+        return;
+    }
+
+#ifdef _WIN32
+    // The file cannot be resized while a view of it exists.
+    if (is_mapped())
+    {
+        ::UnmapViewOfFile(get_mapping_start());
+        ::CloseHandle(file_mapping_handle_);
+        file_mapping_handle_ = invalid_handle;
+    }
+    LARGE_INTEGER file_offset, file_pointer;
+    file_offset.QuadPart = file_size;
+    if (SetFilePointerEx(file_handle_, file_offset, &file_pointer, FILE_BEGIN) == 0 ||
+        file_pointer.LowPart == INVALID_SET_FILE_POINTER ||
+        SetEndOfFile(file_handle_) == 0)
+#else // POSIX
+    if (ftruncate(file_handle_, file_size) == -1)
+#endif
+    {
+        error = detail::last_error();
+        return;
+    }
+
+    if (file_size > file_offset_ || reservation_)
+    {
+        remap(file_offset_, file_size > file_offset_ ? file_size - file_offset_ : 0, error);
+        return;
+    }
+
+    // Nothing is left to map past `file_offset_`, so only release the view.
+#ifndef _WIN32
+    if (data_) { ::munmap(get_mapping_start(), mapped_length_); }
+#endif
+    data_ = nullptr;
+    length_ = mapped_length_ = 0;
+}
+
 template<access_mode AccessMode, typename ByteT>
 void basic_mmap<AccessMode, ByteT>::unmap()
 {
@@ -1154,7 +1703,8 @@ void basic_mmap<AccessMode, ByteT>::unmap()
         ::CloseHandle(file_mapping_handle_);
     }
 #else // POSIX
-    if(data_) { ::munmap(const_cast<pointer>(get_mapping_start()), mapped_length_); }
+    if(reservation_) { ::munmap(reservation_, reserved_length_); }
+    else if(data_) { ::munmap(const_cast<pointer>(get_mapping_start()), mapped_length_); }
 #endif
 
     // If `file_handle_` was obtained by our opening it (when map is called with
@@ -1163,22 +1713,276 @@ void basic_mmap<AccessMode, ByteT>::unmap()
     // instance.
     if(is_handle_internal_)
     {
-#ifdef _WIN32
-        ::CloseHandle(file_handle_);
-#else // POSIX
-        ::close(file_handle_);
-#endif
+        detail::close_file(file_handle_);
     }
 
     // Reset fields to their default values.
     data_ = nullptr;
     length_ = mapped_length_ = 0;
+    file_offset_ = 0;
+    reservation_ = nullptr;
+    reserved_length_ = 0;
     file_handle_ = invalid_handle;
 #ifdef _WIN32
     file_mapping_handle_ = invalid_handle;
 #endif
 }
 
+template<access_mode AccessMode, typename ByteT>
+template<access_mode A>
+typename std::enable_if<A == access_mode::write, void>::type
+basic_mmap<AccessMode, ByteT>::remap(const size_type new_offset, size_type new_length, std::error_code& error)
+{
+    error.clear();
+    if(!is_open()) { return; }
+
+#ifndef _WIN32
+    if(reservation_)
+    {
+        if(new_offset == file_offset_)
+        {
+            remap_in_place(new_length, error);
+            return;
+        }
+        // A different offset doesn't fit the reserved range, so give it up.
+        ::munmap(reservation_, reserved_length_);
+        reservation_ = nullptr;
+        reserved_length_ = 0;
+        data_ = nullptr;
+        length_ = mapped_length_ = 0;
+    }
+#endif
+
+    // todo: remove?
+#ifdef _WIN32
+    if(is_mapped())
+    {
+        ::UnmapViewOfFile(get_mapping_start());
+        ::CloseHandle(file_mapping_handle_);
+    }
+#else // POSIX
+    if(data_) { ::munmap(const_cast<pointer>(get_mapping_start()), mapped_length_); }
+#endif
+
+    const auto ctx = detail::memory_remap(file_handle_, data_,
+        length_, new_offset, new_length, AccessMode, error);
+    if(!error)
+    {
+        is_handle_internal_ = true;
+        data_ = reinterpret_cast<pointer>(ctx.data);
+        length_ = ctx.length;
+        mapped_length_ = ctx.mapped_length;
+        file_offset_ = new_offset;
+#ifdef _WIN32
+        file_mapping_handle_ = ctx.file_mapping_handle;
+#endif
+    }
+}
+
+template<access_mode AccessMode, typename ByteT>
+void basic_mmap<AccessMode, ByteT>::reserve(const size_type capacity, std::error_code& error)
+{
+    error.clear();
+    if(!is_open())
+    {
+        error = std::make_error_code(std::errc::bad_file_descriptor);
+        return;
+    }
+#ifdef _WIN32
+    (void)capacity;
+    error = std::make_error_code(std::errc::not_supported);
+#else // POSIX
+    const size_type aligned_offset = make_offset_page_aligned(file_offset_);
+    const size_type head = file_offset_ - aligned_offset;
+    const size_type mapped_pages = data_ ? detail::make_length_page_aligned(mapped_length_) : 0;
+    const size_type length = std::max(
+        detail::make_length_page_aligned(head + capacity), mapped_pages);
+    if(length <= reserved_length_) { return; }
+
+    const int protection = AccessMode == access_mode::read ? PROT_READ : PROT_WRITE;
+    char* reservation = detail::reserve_address_space(length, error);
+    if(error) { return; }
+    // Map the same pages again at the start of the new range before releasing the
+    // old one, so that a failure leaves the mapping as it was.
+    if(mapped_pages > 0 && ::mmap(reservation, mapped_pages, protection,
+            MAP_SHARED | MAP_FIXED, file_handle_, aligned_offset) == MAP_FAILED)
+    {
+        error = detail::last_error();
+        ::munmap(reservation, length);
+        return;
+    }
+    if(reservation_) { ::munmap(reservation_, reserved_length_); }
+    else if(data_) { ::munmap(const_cast<pointer>(get_mapping_start()), mapped_length_); }
+
+    reservation_ = reinterpret_cast<pointer>(reservation);
+    reserved_length_ = length;
+    if(data_) { data_ = reservation_ + head; }
+#endif
+}
+
+template<access_mode AccessMode, typename ByteT>
+void basic_mmap<AccessMode, ByteT>::remap_in_place(
+        const size_type new_length, std::error_code& error)
+{
+#ifdef _WIN32
+    (void)new_length;
+    error = std::make_error_code(std::errc::not_supported);
+#else // POSIX
+    const size_type aligned_offset = make_offset_page_aligned(file_offset_);
+    const size_type head = file_offset_ - aligned_offset;
+    const size_type new_mapped_length = new_length > 0 ? head + new_length : 0;
+    const size_type new_pages = detail::make_length_page_aligned(new_mapped_length);
+    // Moving the mapping would leave the caller's pointers into it dangling.
+    if(new_pages > reserved_length_)
+    {
+        error = std::make_error_code(std::errc::not_enough_memory);
+        return;
+    }
+
+    // Grow the file as `detail::memory_remap` does. Read-only mappings may only be
+    // extended to the file's size, as pages past it can't be accessed.
+    const auto file_size = detail::query_file_size(file_handle_, error);
+    if(error) { return; }
+    if(int64_t(file_offset_ + new_length) > file_size)
+    {
+        if(AccessMode == access_mode::read)
+        {
+            error = std::make_error_code(std::errc::invalid_argument);
+            return;
+        }
+        if(::ftruncate(file_handle_, file_offset_ + new_length) == -1)
+        {
+            error = detail::last_error();
+            return;
+        }
+    }
+
+    const size_type old_pages = data_ ? detail::make_length_page_aligned(mapped_length_) : 0;
+    if(new_pages > old_pages)
+    {
+        const int protection = AccessMode == access_mode::read ? PROT_READ : PROT_WRITE;
+        if(::mmap(reservation_ + old_pages, new_pages - old_pages, protection,
+                MAP_SHARED | MAP_FIXED, file_handle_, aligned_offset + old_pages) == MAP_FAILED)
+        {
+            error = detail::last_error();
+            return;
+        }
+    }
+    else if(new_pages < old_pages)
+    {
+        // Return the pages cut off to the reservation.
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED;
+#ifdef MAP_NORESERVE
+        flags |= MAP_NORESERVE;
+#endif
+        if(::mmap(reservation_ + new_pages, old_pages - new_pages, PROT_NONE,
+                flags, -1, 0) == MAP_FAILED)
+        {
+            error = detail::last_error();
+            return;
+        }
+    }
+
+    data_ = new_mapped_length > 0 ? reservation_ + head : nullptr;
+    length_ = new_length;
+    mapped_length_ = new_mapped_length;
+#endif
+}
+
+template<access_mode AccessMode, typename ByteT>
+void basic_mmap<AccessMode, ByteT>::extend_to_file(std::error_code& error)
+{
+    error.clear();
+    if(!is_open())
+    {
+        error = std::make_error_code(std::errc::bad_file_descriptor);
+        return;
+    }
+    const auto file_size = detail::query_file_size(file_handle_, error);
+    if(error || file_size <= int64_t(file_offset_ + length_)) { return; }
+    const size_type new_length = static_cast<size_type>(file_size) - file_offset_;
+
+#ifndef _WIN32
+    if(reservation_)
+    {
+        remap_in_place(new_length, error);
+        return;
+    }
+#endif
+
+    // Map the new range before releasing the old one, so that a failure leaves the
+    // mapping as it was.
+    const auto ctx = detail::memory_map(file_handle_, file_offset_, new_length,
+        AccessMode, error);
+    if(error) { return; }
+#ifdef _WIN32
+    if(is_mapped())
+    {
+        ::UnmapViewOfFile(get_mapping_start());
+        ::CloseHandle(file_mapping_handle_);
+    }
+    file_mapping_handle_ = ctx.file_mapping_handle;
+#else // POSIX
+    if(data_) { ::munmap(const_cast<pointer>(get_mapping_start()), mapped_length_); }
+#endif
+    data_ = reinterpret_cast<pointer>(ctx.data);
+    length_ = ctx.length;
+    mapped_length_ = ctx.mapped_length;
+}
+
+template<access_mode AccessMode, typename ByteT>
+std::vector<data_extent> basic_mmap<AccessMode, ByteT>::data_extents(
+        std::error_code& error) const
+{
+    error.clear();
+    std::vector<data_extent> extents;
+    if(!is_open())
+    {
+        error = std::make_error_code(std::errc::bad_file_descriptor);
+        return extents;
+    }
+    if(length_ == 0) { return extents; }
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    // The handle's offset may be in use by the caller, so put it back afterwards.
+    const off_t saved_position = ::lseek(file_handle_, 0, SEEK_CUR);
+    const off_t begin = static_cast<off_t>(file_offset_);
+    const off_t end = static_cast<off_t>(file_offset_ + length_);
+    for(off_t position = begin; position < end;)
+    {
+        const off_t data = ::lseek(file_handle_, position, SEEK_DATA);
+        if(data == -1)
+        {
+            // There is no data past `position`.
+            if(errno == ENXIO) { break; }
+            // The file system can't tell; treat everything as data.
+            if(errno == EINVAL && position == begin)
+            {
+                extents.push_back(data_extent{ 0, length_ });
+                break;
+            }
+            error = detail::last_error();
+            break;
+        }
+        if(data >= end) { break; }
+        off_t hole = ::lseek(file_handle_, data, SEEK_HOLE);
+        if(hole == -1)
+        {
+            error = detail::last_error();
+            break;
+        }
+        hole = std::min(hole, end);
+        extents.push_back(data_extent{ static_cast<size_type>(data - begin),
+            static_cast<size_type>(hole - data) });
+        position = hole;
+    }
+    if(saved_position != -1) { ::lseek(file_handle_, saved_position, SEEK_SET); }
+    if(error) { extents.clear(); }
+#else
+    extents.push_back(data_extent{ 0, length_ });
+#endif
+    return extents;
+}
+
 template<access_mode AccessMode, typename ByteT>
 bool basic_mmap<AccessMode, ByteT>::is_mapped() const noexcept
 {
@@ -1202,6 +2006,9 @@ void basic_mmap<AccessMode, ByteT>::swap(basic_mmap& other)
 #endif
         swap(length_, other.length_);
         swap(mapped_length_, other.mapped_length_);
+        swap(file_offset_, other.file_offset_);
+        swap(reservation_, other.reservation_);
+        swap(reserved_length_, other.reserved_length_);
         swap(is_handle_internal_, other.is_handle_internal_);
     }
 }
@@ -1299,10 +2106,13 @@ bool operator>=(const basic_mmap<AccessMode, ByteT>& a,
 #ifndef MIO_PAGE_HEADER
 #define MIO_PAGE_HEADER
 
+#include <cstddef>
+
 #ifdef _WIN32
 # include <windows.h>
 #else
 # include <unistd.h>
+# include <sys/mman.h>
 #endif
 
 namespace mio {
@@ -1351,6 +2161,65 @@ inline size_t make_offset_page_aligned(size_t offset) noexcept
     return offset / page_size_ * page_size_;
 }
 
+/**
+ * Returns whether all pages overlapping the `length` bytes at `address`, which must
+ * lie within a memory mapping, are resident in memory, i.e. whether accessing them
+ * won't incur a major page fault. This is a snapshot; pages may be evicted at any
+ * time after the call.
+ *
+ * Residency cannot be queried on Windows, where all pages are reported resident.
+ */
+inline bool is_resident(const void* address, size_t length) noexcept
+{
+#ifdef _WIN32
+    (void)address;
+    (void)length;
+    return true;
+#else
+    if(length == 0) { return true; }
+    const size_t page_size_ = page_size();
+    const size_t start = make_offset_page_aligned(reinterpret_cast<size_t>(address));
+    const size_t end = reinterpret_cast<size_t>(address) + length;
+    // Query in fixed size batches so as not to allocate.
+    unsigned char vec[64];
+    for(size_t pos = start; pos < end; pos += sizeof(vec) * page_size_)
+    {
+        const size_t batch = end - pos < sizeof(vec) * page_size_
+            ? end - pos : sizeof(vec) * page_size_;
+        if(::mincore(reinterpret_cast<void*>(pos), batch, vec) != 0) { return false; }
+        const size_t num_pages = (batch + page_size_ - 1) / page_size_;
+        for(size_t i = 0; i < num_pages; ++i)
+        {
+            if(!(vec[i] & 1)) { return false; }
+        }
+    }
+    return true;
+#endif
+}
+
+/**
+ * Populates the pages overlapping the `length` bytes at `address`, which must lie
+ * within a memory mapping, by hinting the kernel to read them ahead and then
+ * touching each of them. This blocks until all pages are resident, and is meant to
+ * be run off the thread that is going to access the data.
+ */
+inline void prefault(const void* address, size_t length) noexcept
+{
+    if(length == 0) { return; }
+    const size_t page_size_ = page_size();
+    const size_t start = make_offset_page_aligned(reinterpret_cast<size_t>(address));
+    const size_t end = reinterpret_cast<size_t>(address) + length;
+#ifndef _WIN32
+    ::madvise(reinterpret_cast<void*>(start), end - start, MADV_WILLNEED);
+#endif
+    for(size_t pos = start; pos < end; pos += page_size_)
+    {
+        // The first page may start before `address`, but it is still part of the
+        // same mapping, as mappings are page aligned.
+        (void)*reinterpret_cast<const volatile char*>(pos);
+    }
+}
+
 } // namespace mio
 
 #endif // MIO_PAGE_HEADER
@@ -1519,6 +2388,9 @@ public:
         return pimpl_ ? pimpl_->mapped_length() : 0;
     }
 
+    /** See `basic_mmap::capacity`. */
+    size_type capacity() const noexcept { return pimpl_ ? pimpl_->capacity() : 0; }
+
     /**
      * Returns a pointer to the first requested byte, or `nullptr` if no memory mapping
      * exists.
@@ -1606,6 +2478,26 @@ public:
         map_impl(path, offset, length, error);
     }
 
+    /**
+     * The same as the above, except that the file is opened as described by
+     * `options`.
+     */
+    template<typename String>
+    void map(const String& path, const size_type offset, const size_type length,
+        const open_options& options, std::error_code& error)
+    {
+        if(!pimpl_)
+        {
+            mmap_type mmap = make_mmap<mmap_type>(path, offset, length, options, error);
+            if(error) { return; }
+            pimpl_ = std::make_shared<mmap_type>(std::move(mmap));
+        }
+        else
+        {
+            pimpl_->map(path, offset, length, options, error);
+        }
+    }
+
     /**
      * Establishes a memory mapping with AccessMode. If the mapping is unsuccesful, the
      * reason is reported via `error` and the object remains in a state as if this
@@ -1676,6 +2568,20 @@ public:
      */
     void unmap() { if(pimpl_) pimpl_->unmap(); }
 
+    template<access_mode A = AccessMode>
+    typename std::enable_if<A == access_mode::write, void>::type
+    remap(const size_type new_offset, size_type new_length, std::error_code& error)
+    {
+        if (pimpl_) pimpl_->remap(new_offset, new_length, error);
+    }
+
+    template<access_mode A = AccessMode>
+    typename std::enable_if<A == access_mode::write, void>::type
+    remap(size_type new_length, std::error_code& error)
+    {
+        if (pimpl_) pimpl_->remap(0, new_length, error);
+    }
+
     void swap(basic_shared_mmap& other) { pimpl_.swap(other.pimpl_); }
 
     /** Flushes the memory mapped page to disk. Errors are reported via `error`. */
@@ -1684,6 +2590,25 @@ public:
         typename = typename std::enable_if<A == access_mode::write>::type
     > void sync(std::error_code& error) { if(pimpl_) pimpl_->sync(error); }
 
+    template<
+        access_mode A = AccessMode,
+        typename = typename std::enable_if<A == access_mode::write>::type
+    > void truncate(size_type file_size, std::error_code& error) { if(pimpl_) pimpl_->truncate(file_size, error); }
+
+    /** See `basic_mmap::reserve`. */
+    void reserve(size_type capacity, std::error_code& error) { if(pimpl_) pimpl_->reserve(capacity, error); }
+
+    /** See `basic_mmap::extend_to_file`. */
+    void extend_to_file(std::error_code& error) { if(pimpl_) pimpl_->extend_to_file(error); }
+
+    /** See `basic_mmap::data_extents`. */
+    std::vector<data_extent> data_extents(std::error_code& error) const
+    {
+        if(pimpl_) { return pimpl_->data_extents(error); }
+        error = std::make_error_code(std::errc::bad_file_descriptor);
+        return std::vector<data_extent>();
+    }
+
     /** All operators compare the underlying `basic_mmap`'s addresses. */
 
     friend bool operator==(const basic_shared_mmap& a, const basic_shared_mmap& b)
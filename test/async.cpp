@@ -0,0 +1,182 @@
+#include <mio/mmap.hpp>
+#include <mio/async_map.hpp>
+#include <mio/async_reader.hpp>
+#include <mio/shared_mmap.hpp>
+#include <mio/readahead.hpp>
+
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cassert>
+#include <algorithm>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct task
+{
+    struct promise_type
+    {
+        task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+void write_file(const char* path, const std::string& contents)
+{
+    std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+    file << contents;
+}
+
+// Tries to evict the file from the page cache so that the suspending path is
+// exercised. This is best effort, the test holds either way.
+void drop_cache(const char* path)
+{
+#ifndef _WIN32
+    const int fd = ::open(path, O_RDONLY);
+    if(fd != -1)
+    {
+        ::fdatasync(fd);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+#endif
+}
+
+task read_all(mio::async_reader& reader, std::string& out, bool& done)
+{
+    for(;;)
+    {
+        const auto chunk = co_await reader.read(3 * mio::page_size() + 11);
+        if(chunk.empty()) { break; }
+        out.append(chunk.begin(), chunk.end());
+    }
+    done = true;
+}
+
+void test_async_reader(const char* path, const std::string& buffer)
+{
+    drop_cache(path);
+    mio::mmap_source mmap(path);
+
+    mio::resume_queue queue;
+    mio::async_reader reader(mmap,
+        [&queue](std::coroutine_handle<> h) { queue.push(h); });
+
+    std::string out;
+    bool done = false;
+    read_all(reader, out, done);
+    while(!done)
+    {
+        queue.wait();
+        queue.run();
+    }
+
+    assert(reader.eof());
+    assert(out == buffer);
+}
+
+void test_readahead(const char* path, const std::string& buffer,
+        mio::readahead_engine::backend backend)
+{
+    drop_cache(path);
+    mio::mmap_source mmap(path);
+    std::error_code error;
+
+    mio::readahead_engine engine(4, 2 * mio::page_size(), backend);
+    engine.prefetch(mmap, 0, mmap.size(), error);
+    assert(!error);
+    engine.wait(error);
+    assert(!error);
+    assert(engine.in_flight() == 0);
+    assert(engine.pending() == 0);
+
+    const auto& stats = engine.stats();
+    assert(stats.submitted == stats.completed);
+    assert(stats.bytes == buffer.size());
+    assert(stats.max_queue_depth <= 4);
+    assert(std::equal(mmap.begin(), mmap.end(), buffer.begin()));
+
+    // Ranges are relative to the first requested byte and clamped to the mapping.
+    mio::mmap_source tail(path, buffer.size() - 100);
+    engine.reset_stats();
+    engine.prefetch(tail, 50, 1000, error);
+    assert(!error);
+    engine.wait(error);
+    assert(!error);
+    assert(engine.stats().bytes == 50);
+
+#ifdef __linux__
+    // Reads the ring can't do, here into an unaligned buffer of a file opened with
+    // O_DIRECT, are issued through the syscall instead, as is everything after.
+    const int fd = ::open(path, O_RDONLY | O_DIRECT);
+    if(fd != -1)
+    {
+        engine.reset_stats();
+        engine.prefetch(fd, 0, 1000, error);
+        engine.wait(error);
+        assert(!error);
+        assert(engine.active_backend() == mio::readahead_engine::backend::syscall);
+        assert(engine.stats().submitted == engine.stats().completed);
+        assert(engine.stats().bytes == 1000);
+        ::close(fd);
+    }
+#endif
+}
+
+void test_async_map(const char* path, const std::string& buffer)
+{
+    mio::async_map_options options;
+    options.offset = mio::page_size();
+    options.prefault = true;
+    options.open.readahead = 1 << 20;
+    auto future = mio::async_map(path, options);
+    auto result = future.get();
+    assert(!result.error);
+    assert(result.mmap.size() == buffer.size() - mio::page_size());
+    assert(std::equal(result.mmap.begin(), result.mmap.end(), buffer.begin() + mio::page_size()));
+
+    auto missing = mio::async_map(std::string(path) + "-missing").get();
+    assert(missing.error);
+    assert(!missing.mmap.is_open());
+
+    // A callback, on a pool of its own, with a different mapping type.
+    mio::thread_pool pool(2);
+    std::promise<mio::shared_mmap_sink> done;
+    mio::async_map<mio::shared_mmap_sink>(path, mio::async_map_options(),
+        [&done](mio::shared_mmap_sink&& mmap, std::error_code error)
+        {
+            assert(!error);
+            done.set_value(std::move(mmap));
+        }, pool);
+    auto sink = done.get_future().get();
+    assert(sink.size() == buffer.size());
+    assert(sink[0] == buffer[0]);
+}
+
+} // namespace
+
+int main()
+{
+    const char* path = "test-async-file";
+    std::string buffer(64 * mio::page_size() + 123, 0);
+    for(size_t i = 0; i < buffer.size(); ++i) { buffer[i] = static_cast<char>(i * 7); }
+    write_file(path, buffer);
+
+    test_async_reader(path, buffer);
+    test_async_map(path, buffer);
+    test_readahead(path, buffer, mio::readahead_engine::backend::syscall);
+    // Falls back to the syscall backend where io_uring is unavailable.
+    test_readahead(path, buffer, mio::readahead_engine::backend::io_uring);
+
+    std::remove(path);
+    std::printf("all tests passed!\n");
+}
@@ -0,0 +1,454 @@
+#include <mio/mmap.hpp>
+#include <mio/demand_mmap.hpp>
+#include <mio/epoch_mmap.hpp>
+#include <mio/lazy_mmap.hpp>
+#include <mio/map_all.hpp>
+#include <mio/reaper.hpp>
+#include <mio/reloadable_mmap.hpp>
+
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <system_error>
+
+namespace {
+
+void write_file(const char* path, const std::string& contents)
+{
+    std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+    file << contents;
+}
+
+char pattern(size_t i) { return static_cast<char>('a' + i % 26); }
+
+void test_epoch_mmap(const char* path)
+{
+    const size_t page_size = mio::page_size();
+    write_file(path, std::string(page_size, pattern(0)));
+
+    mio::epoch_mmap_sink mmap(path);
+    assert(mmap.is_open());
+    assert(mmap.generation() == 1);
+
+    // Readers check that every byte they see has the value written to its page, or
+    // is still 0 if it was just added, while the writer keeps growing the file and
+    // remapping it.
+    const size_t pages = 64;
+    std::atomic<bool> done(false);
+    std::atomic<size_t> reads(0);
+    std::vector<std::thread> readers;
+    for(int t = 0; t < 4; ++t)
+    {
+        readers.emplace_back([&]
+        {
+            while(!done)
+            {
+                const auto guard = mmap.pin();
+                assert(guard.size() % page_size == 0);
+                for(size_t i = 0; i < guard.size(); i += page_size / 2)
+                {
+                    const char c = guard[i];
+                    assert(c == pattern(i / page_size) || c == 0);
+                }
+                ++reads;
+            }
+        });
+    }
+
+    std::error_code error;
+    for(size_t n = 2; n <= pages; ++n)
+    {
+        mmap.remap(0, n * page_size, error);
+        assert(!error);
+        const auto guard = mmap.pin();
+        std::fill_n(guard.data() + (n - 1) * page_size, page_size, pattern(n - 1));
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    done = true;
+    for(auto& r : readers) { r.join(); }
+    assert(reads > 0);
+    assert(mmap.generation() == pages);
+
+    // A remap waits for the readers of the previous generation.
+    auto guard = mmap.pin();
+    const char* old_data = guard.data();
+    std::atomic<bool> remapped(false);
+    std::thread writer([&]
+    {
+        std::error_code error;
+        mmap.remap(page_size, page_size, error);
+        assert(!error);
+        remapped = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    assert(!remapped);
+    // The pinned generation is still intact.
+    assert(guard.data() == old_data);
+    assert(guard[pages * page_size - 1] == pattern(pages - 1));
+    guard.release();
+    writer.join();
+    assert(remapped);
+
+    guard = mmap.pin();
+    assert(guard.size() == page_size);
+    assert(guard[0] == pattern(1));
+    guard.release();
+
+    mmap.remap(100 * page_size, mio::map_entire_file, error);
+    assert(error);
+
+    mmap.unmap();
+    assert(!mmap.is_open());
+    assert(!mmap.pin().data());
+    mmap.remap(0, page_size, error);
+    assert(error == std::errc::bad_file_descriptor);
+
+    mio::epoch_mmap_source source(path);
+    assert(source.pin().size() == pages * page_size);
+}
+
+// Publishes a version of `size` bytes all set to `c`.
+void publish(const char* path, size_t size, char c)
+{
+    mio::staged_file file(path, size);
+    std::fill_n(file.data(), size, c);
+    std::error_code error;
+    file.commit(error);
+    assert(!error);
+    assert(!file.is_open());
+}
+
+bool is_uniform(const mio::shared_mmap_source& mmap)
+{
+    return std::all_of(mmap.begin(), mmap.end(), [&](char c) { return c == mmap[0]; });
+}
+
+void test_reloadable_mmap(const char* path)
+{
+    const size_t page_size = mio::page_size();
+    publish(path, page_size, 'a');
+
+    // A file that isn't committed leaves the published one alone.
+    std::string temp_path;
+    {
+        mio::staged_file file(path, 3 * page_size);
+        temp_path = file.temp_path();
+        assert(!temp_path.empty());
+        std::fill_n(file.data(), file.size(), 'x');
+    }
+    assert(!std::ifstream(temp_path).good());
+
+    mio::reloadable_mmap mmap(path);
+    assert(mmap.is_open());
+    assert(mmap.generation() == 1);
+    const auto first = mmap.get();
+    assert(first.size() == page_size);
+    assert(first[0] == 'a');
+
+    // Readers always see one version in full while new ones are published.
+    std::atomic<bool> done(false);
+    std::atomic<size_t> reads(0);
+    std::vector<std::thread> readers;
+    for(int t = 0; t < 4; ++t)
+    {
+        readers.emplace_back([&]
+        {
+            while(!done)
+            {
+                const auto version = mmap.get();
+                assert(version.size() % page_size == 0);
+                assert(is_uniform(version));
+                ++reads;
+            }
+        });
+    }
+    std::error_code error;
+    for(size_t n = 1; n <= 16; ++n)
+    {
+        publish(path, n * page_size, static_cast<char>('a' + n));
+        if(!mmap.is_watching()) { mmap.reload(error); }
+    }
+    done = true;
+    for(auto& r : readers) { r.join(); }
+    assert(reads > 0);
+
+    // The last version is picked up without reloading explicitly.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while(mmap.get()[0] != 'a' + 16 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(mmap.get().size() == 16 * page_size);
+    assert(mmap.get()[0] == 'a' + 16);
+    assert(mmap.generation() > 1);
+    assert(!mmap.last_error());
+    // The first version is still mapped while it's held.
+    assert(first.size() == page_size);
+    assert(is_uniform(first) && first[0] == 'a');
+
+    mmap.reload(error);
+    assert(!error);
+    mmap.close();
+    assert(!mmap.is_open());
+    assert(!mmap.get().is_open());
+    mmap.reload(error);
+    assert(error == std::errc::bad_file_descriptor);
+
+    mmap.open("garbage-that-hopefully-doesnt-exist", error);
+    assert(error);
+    assert(!mmap.is_open());
+}
+
+void test_lazy_mmap(const char* path)
+{
+    const size_t page_size = mio::page_size();
+    std::string contents(3 * page_size + 10, 0);
+    for(size_t i = 0; i < contents.size(); ++i) { contents[i] = pattern(i); }
+    write_file(path, contents);
+
+    mio::lazy_mmap_source mmap(path, 5);
+    assert(mmap.is_open());
+    assert(!mmap.is_mapped());
+    assert(mmap.size() == contents.size() - 5);
+
+    // Threads racing to the first access all get the same mapping.
+    std::vector<const char*> seen(8);
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < seen.size(); ++t)
+    {
+        threads.emplace_back([&, t] { seen[t] = mmap.data(); });
+    }
+    for(auto& t : threads) { t.join(); }
+    assert(mmap.is_mapped());
+    for(const char* data : seen) { assert(data == seen[0]); }
+    assert(std::equal(mmap.begin(), mmap.end(), contents.begin() + 5));
+    assert(mmap.mmap().file_offset() == 5);
+
+    // Moving keeps the mapping.
+    mio::lazy_mmap_source moved = std::move(mmap);
+    assert(!mmap.is_open());
+    assert(moved.data() == seen[0]);
+
+    std::error_code error;
+    mio::lazy_mmap_sink sink;
+    sink.map(path, page_size, 10, mio::open_options(), error);
+    assert(!error);
+    assert(!sink.is_mapped());
+    sink.map_now(error);
+    assert(!error);
+    assert(sink.is_mapped());
+    sink[0] = 'X';
+    sink.unmap();
+    assert(!sink.is_open());
+    assert(moved[page_size - 5] == 'X');
+
+    sink.map(path, 100 * page_size, 10, mio::open_options(), error);
+    assert(error);
+    assert(!sink.is_open());
+    assert(!sink.data());
+}
+
+void test_map_all(const char* path)
+{
+    std::vector<std::string> paths;
+    for(size_t i = 0; i < 50; ++i)
+    {
+        paths.push_back(std::string(path) + "-" + std::to_string(i));
+        write_file(paths.back().c_str(), std::string(i + 1, pattern(i)));
+    }
+    paths.push_back(std::string(path) + "-missing");
+
+    mio::thread_pool pool(4);
+    mio::batch_options options;
+    options.batch_size = 7;
+    auto result = mio::map_all(paths, options, pool);
+    assert(result.size() == paths.size());
+    assert(result.num_failed() == 1);
+    assert(result.errors.back());
+    assert(!result.mmaps.back().is_open());
+    for(size_t i = 0; i + 1 < paths.size(); ++i)
+    {
+        assert(!result.errors[i]);
+        assert(result.mmaps[i].size() == i + 1);
+        assert(result.mmaps[i][i] == pattern(i));
+    }
+    assert(result.elapsed.count() > 0);
+
+    // Writable mappings would create the missing file otherwise.
+    options.open.creation = mio::creation_policy::open_existing;
+    auto lazy = mio::map_all<mio::lazy_mmap_sink>(paths, options, pool);
+    assert(lazy.num_failed() == 1);
+    assert(!lazy.mmaps[3].is_mapped());
+    lazy.mmaps[3][0] = 'X';
+    lazy.mmaps[3].unmap();
+    assert(mio::mmap_source(paths[3])[0] == 'X');
+
+    assert(mio::map_all(std::vector<std::string>(), options, pool).size() == 0);
+
+    for(size_t i = 0; i + 1 < paths.size(); ++i) { std::remove(paths[i].c_str()); }
+}
+
+void test_reaper(const char* path)
+{
+    const size_t page_size = mio::page_size();
+    write_file(path, std::string(4 * page_size, pattern(0)));
+
+    mio::mmap_reaper reaper;
+    {
+        mio::deferred_mmap_sink sink(path);
+        sink.set_reaper(reaper);
+        sink[0] = 'X';
+        mio::deferred_mmap_sink moved = std::move(sink);
+        assert(!sink.is_open());
+        assert(&moved.reaper() == &reaper);
+        moved[1] = 'Y';
+    }
+    // The sink is synced and unmapped by the reaper.
+    reaper.drain();
+    assert(reaper.pending() == 0);
+    assert(reaper.stats().released == 1);
+    {
+        mio::mmap_source source(path);
+        assert(source[0] == 'X' && source[1] == 'Y');
+    }
+
+    // Many threads releasing at once, some of it past the limit.
+    mio::reaper_options options;
+    options.max_pending = 8;
+    mio::mmap_reaper limited(options);
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&]
+        {
+            for(size_t i = 0; i < 50; ++i)
+            {
+                mio::mmap_source mmap(path);
+                limited.release(std::move(mmap));
+                assert(!mmap.is_open());
+                mio::deferred_mmap_source deferred(mio::mmap_source(path), limited);
+                deferred = mio::deferred_mmap_source(mio::mmap_source(path, page_size), limited);
+                assert(deferred.size() == 3 * page_size);
+            }
+        });
+    }
+    for(auto& t : threads) { t.join(); }
+    limited.drain();
+    const auto stats = limited.stats();
+    assert(stats.released == 4 * 50 * 3);
+    assert(stats.batches > 0);
+    assert(stats.released_inline <= stats.released);
+
+    // Unopened mappings aren't taken over.
+    limited.release(mio::mmap_source());
+    assert(limited.stats().released == stats.released);
+}
+
+char computed(size_t offset) { return static_cast<char>(offset * 31 + offset / 4096); }
+
+void test_demand_mmap()
+{
+    const size_t page_size = mio::page_size();
+    const size_t size = 100 * page_size + 10;
+    std::atomic<size_t> calls(0);
+    mio::page_provider provider = [&](size_t offset, char* buffer, size_t length, std::error_code& error)
+    {
+        ++calls;
+        if(offset % page_size != 0 || length % page_size != 0) { error = std::make_error_code(std::errc::invalid_argument); }
+        for(size_t i = 0; i < length; ++i) { buffer[i] = computed(offset + i); }
+    };
+
+    mio::demand_mmap mmap;
+    std::error_code error;
+    mmap.map(size, provider, mio::demand_options(), error);
+    if(error)
+    {
+        // userfaultfd may be disallowed, e.g. by a seccomp filter.
+        std::printf("skipping demand_mmap tests: %s\n", error.message().c_str());
+        return;
+    }
+    assert(mmap.size() == size);
+
+    // Threads faulting on the same pages at once all see their contents.
+    std::vector<std::thread> threads;
+    std::atomic<bool> ok(true);
+    for(size_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&, t]
+        {
+            for(size_t i = t * 7; i < size; i += 97)
+            {
+                if(mmap[i] != computed(i)) { ok = false; }
+            }
+        });
+    }
+    for(auto& t : threads) { t.join(); }
+    assert(ok);
+    for(size_t i = 0; i < size; ++i) { assert(mmap[i] == computed(i)); }
+    assert(!mmap.error());
+
+    // Each page is filled once, mostly along with others.
+    auto stats = mmap.stats();
+    assert(stats.pages_filled == 101);
+    assert(stats.batches == calls);
+    assert(stats.batches < 101);
+    assert(stats.faults > 0);
+
+    // Filled pages are ordinary memory.
+    mmap[0] = 'X';
+    assert(mmap[0] == 'X');
+    mio::demand_mmap moved = std::move(mmap);
+    assert(!mmap.is_open());
+    assert(moved[0] == 'X' && moved[size - 1] == computed(size - 1));
+    moved.unmap();
+
+    // Prefetched pages don't fault.
+    mio::demand_options options;
+    options.fault_around = 0;
+    mio::demand_mmap prefetched(size, provider, options);
+    prefetched.prefetch(0, size);
+    for(int i = 0; i < 1000 && prefetched.stats().pages_filled < 101; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(prefetched.stats().pages_prefetched == 101);
+    for(size_t i = 0; i < size; ++i) { assert(prefetched[i] == computed(i)); }
+    assert(prefetched.stats().faults == 0);
+
+    // Pages the provider fails to fill read as zeros.
+    mio::demand_mmap failing(size, [&](size_t offset, char* buffer, size_t length, std::error_code& error)
+    {
+        if(offset >= 50 * page_size) { error = std::make_error_code(std::errc::io_error); }
+        else { provider(offset, buffer, length, error); }
+    });
+    assert(failing[60 * page_size] == 0);
+    assert(failing.error() == std::errc::io_error);
+    assert(failing[page_size] == computed(page_size));
+
+    mmap.map(0, provider, mio::demand_options(), error);
+    assert(error == std::errc::invalid_argument);
+}
+
+} // namespace
+
+int main()
+{
+    const char* path = "test-concurrency-file";
+    test_epoch_mmap(path);
+    std::remove(path);
+    test_reloadable_mmap(path);
+    std::remove(path);
+    test_lazy_mmap(path);
+    std::remove(path);
+    test_map_all(path);
+    test_reaper(path);
+    std::remove(path);
+    test_demand_mmap();
+    std::printf("all tests passed!\n");
+}
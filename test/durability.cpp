@@ -0,0 +1,396 @@
+#include <mio/mmap.hpp>
+#include <mio/group_commit.hpp>
+#include <mio/writeback.hpp>
+#include <mio/journal.hpp>
+
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+
+#ifndef _WIN32
+#include <csignal>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+namespace {
+
+void write_file(const char* path, const std::string& contents)
+{
+    std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+    file << contents;
+}
+
+std::string read_file(const char* path)
+{
+    std::ifstream file(path, std::ios_base::binary);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+void test_group_commit(const char* path)
+{
+    const size_t record_size = 100;
+    const size_t num_threads = 8;
+    const size_t records_per_thread = 50;
+    write_file(path, std::string(num_threads * records_per_thread * record_size, 0));
+
+    mio::mmap_sink mmap(path);
+    std::atomic<size_t> completed(0);
+    {
+        mio::group_commit commit(mmap, std::chrono::microseconds(500));
+
+        std::vector<std::thread> writers;
+        for(size_t t = 0; t < num_threads; ++t)
+        {
+            writers.emplace_back([&, t]
+            {
+                for(size_t i = 0; i < records_per_thread; ++i)
+                {
+                    const size_t offset = (i * num_threads + t) * record_size;
+                    std::fill_n(mmap.data() + offset, record_size, static_cast<char>('a' + t));
+                    std::error_code error;
+                    commit.commit(offset, record_size, error);
+                    assert(!error);
+                }
+            });
+        }
+        for(auto& w : writers) { w.join(); }
+
+        auto stats = commit.stats();
+        assert(stats.requests == num_threads * records_per_thread);
+        assert(stats.batches <= stats.requests);
+        assert(stats.flushes >= stats.batches);
+        assert(stats.max_batch >= 1);
+
+        // Asynchronous commits, including an empty range, complete by destruction.
+        for(size_t i = 0; i < 10; ++i)
+        {
+            commit.commit(i * record_size, i == 0 ? 0 : record_size,
+                [&](const std::error_code& error)
+                {
+                    assert(!error);
+                    ++completed;
+                });
+        }
+
+        std::error_code error;
+        commit.commit(mmap.size(), 1, error);
+        assert(error == std::errc::invalid_argument);
+        commit.commit(mmap.size() - 1, 2, [&](const std::error_code& error)
+        {
+            assert(error == std::errc::invalid_argument);
+        });
+    }
+    assert(completed == 10);
+
+    // Mappings of unsigned char commit the same ranges.
+    {
+        mio::ummap_sink umap(path);
+        mio::group_commit commit(umap);
+        umap[0] = 'a';
+        std::error_code error;
+        commit.commit(0, 1, error);
+        assert(!error);
+        commit.commit(umap.size(), 1, error);
+        assert(error == std::errc::invalid_argument);
+    }
+
+    mmap.unmap();
+    const std::string contents = read_file(path);
+    for(size_t r = 0; r < num_threads * records_per_thread; ++r)
+    {
+        assert(contents[r * record_size] == static_cast<char>('a' + r % num_threads));
+    }
+}
+
+void test_writeback(const char* path)
+{
+    const size_t size = 64 * mio::page_size();
+    write_file(path, std::string(size, 0));
+    mio::mmap_sink mmap(path, 100);
+    {
+        // Threshold flushes of the reported ranges.
+        mio::writeback_options options;
+        options.interval = std::chrono::milliseconds(0);
+        options.dirty_bytes_limit = 4 * mio::page_size();
+        mio::writeback writeback(mmap, options);
+        for(size_t offset = 0; offset < mmap.size(); offset += mio::page_size())
+        {
+            const size_t length = std::min(mio::page_size(), mmap.size() - offset);
+            std::fill_n(mmap.data() + offset, length, 'x');
+            writeback.note_written(offset, length);
+            assert(writeback.dirty_bytes() < 2 * options.dirty_bytes_limit + mio::page_size());
+        }
+        // Ranges beyond the mapping are ignored.
+        writeback.note_written(mmap.size(), 10);
+        while(writeback.stats().bytes_flushed < mmap.size())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const auto stats = writeback.stats();
+        assert(stats.threshold_flushes > 0);
+        assert(stats.timed_flushes == 0);
+        assert(stats.errors == 0);
+    }
+    {
+        // Nothing is reported, so the whole mapping is flushed periodically.
+        mio::writeback_options options;
+        options.interval = std::chrono::milliseconds(5);
+        mio::writeback writeback(mmap, options);
+        std::fill_n(mmap.data(), 10, 'y');
+        while(writeback.stats().timed_flushes < 2)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const auto stats = writeback.stats();
+        assert(stats.bytes_flushed >= 2 * mmap.mapped_length());
+        assert(stats.errors == 0);
+    }
+    {
+        mio::writeback_options options;
+        options.method = mio::writeback_method::async_msync;
+        options.interval = std::chrono::milliseconds(0);
+        options.dirty_bytes_limit = mio::page_size();
+        mio::writeback writeback(mmap, options);
+        writeback.note_written(0, mmap.size());
+        while(writeback.stats().threshold_flushes == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        assert(writeback.stats().errors == 0);
+    }
+    {
+        // Mappings of unsigned char flush the same ranges.
+        mio::ummap_sink umap(path, 100);
+        mio::writeback_options options;
+        options.interval = std::chrono::milliseconds(0);
+        options.dirty_bytes_limit = mio::page_size();
+        mio::writeback writeback(umap, options);
+        writeback.note_written(0, umap.size());
+        while(writeback.stats().bytes_flushed < umap.size())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        assert(writeback.stats().errors == 0);
+    }
+    mmap.unmap();
+    const std::string contents = read_file(path);
+    assert(contents.substr(0, 100) == std::string(100, 0));
+    assert(contents.substr(100, 10) == std::string(10, 'y'));
+    assert(contents.substr(110) == std::string(size - 110, 'x'));
+}
+
+uint64_t read_u64(const char* p)
+{
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Commits transactions writing `k` to both ends of the data file.
+void commit_counter(mio::journal& journal, uint64_t k)
+{
+    auto t = journal.begin();
+    t.write(0, &k, sizeof(k));
+    t.write(journal.size() - sizeof(k), &k, sizeof(k));
+    std::error_code error;
+    journal.commit(t, error);
+    assert(!error);
+}
+
+void test_journal(const char* path, const char* log_path)
+{
+    const size_t size = 16 * mio::page_size();
+    write_file(path, std::string(size, 0));
+    std::remove(log_path);
+    std::error_code error;
+    {
+        mio::journal_options options;
+        options.log_capacity = 2 * mio::page_size();
+        mio::journal journal(path, log_path, options);
+        assert(journal.replayed() == 0);
+        assert(journal.size() == size);
+
+        auto t = journal.begin();
+        t.write(10, "hello", 5);
+        t.write(3 * mio::page_size() - 2, "world", 5);
+        journal.commit(t, error);
+        assert(!error);
+        // Transactions are only applied to the data on demand.
+        assert(journal.data()[10] == 0);
+        journal.apply();
+        assert(std::string(journal.data() + 10, 5) == "hello");
+        assert(std::string(journal.data() + 3 * mio::page_size() - 2, 5) == "world");
+        const size_t log_size = journal.log_size();
+
+        // Filling up the log checkpoints it.
+        for(uint64_t k = 1; k <= 200; ++k) { commit_counter(journal, k); }
+        assert(journal.log_size() < log_size + 200 * 72);
+        journal.apply();
+        assert(read_u64(journal.data()) == 200);
+
+        t.clear();
+        t.write(size - 1, "ab", 2);
+        journal.commit(t, error);
+        assert(error == std::errc::invalid_argument);
+        t.clear();
+        const std::string large(2 * mio::page_size(), 'x');
+        t.write(0, large.data(), large.size());
+        journal.commit(t, error);
+        assert(error == std::errc::no_buffer_space);
+        assert(read_u64(journal.data()) == 200);
+    }
+
+    // Closing checkpoints, so there's nothing to replay.
+    {
+        mio::journal_options options;
+        options.lazy_apply = false;
+        mio::journal journal(path, log_path, options);
+        assert(journal.replayed() == 0);
+        assert(journal.log_capacity() == mio::journal_options().log_capacity);
+        assert(std::string(journal.data() + 10, 5) == "hello");
+        assert(read_u64(journal.data() + size - 8) == 200);
+        commit_counter(journal, 201);
+        assert(read_u64(journal.data()) == 201);
+    }
+
+    mio::journal journal;
+    journal.open("garbage-that-hopefully-doesnt-exist/data", log_path, mio::journal_options(), error);
+    assert(error);
+    assert(!journal.is_open());
+}
+
+#ifndef _WIN32
+// Kills a process committing transactions at some point and checks that the
+// journal recovers every acknowledged transaction, and no partial one.
+void test_journal_crash(const char* path, const char* log_path)
+{
+    write_file(path, std::string(16 * mio::page_size(), 0));
+    std::remove(log_path);
+    uint64_t last = 0;
+    for(int round = 0; round < 6; ++round)
+    {
+        int fds[2];
+        assert(::pipe(fds) == 0);
+        const pid_t pid = ::fork();
+        assert(pid != -1);
+        if(pid == 0)
+        {
+            ::close(fds[0]);
+            mio::journal_options options;
+            options.log_capacity = 4 * mio::page_size();
+            mio::journal journal(path, log_path, options);
+            for(uint64_t k = read_u64(journal.data()) + 1;; ++k)
+            {
+                commit_counter(journal, k);
+                if(::write(fds[1], &k, sizeof(k)) != sizeof(k)) { ::_exit(1); }
+            }
+        }
+        ::close(fds[1]);
+
+        // Let the child run for a varying number of commits, then kill it.
+        const uint64_t commits = 20 + round * 53;
+        uint64_t acknowledged = last;
+        for(uint64_t i = 0; i < commits; ++i)
+        {
+            if(::read(fds[0], &acknowledged, sizeof(acknowledged)) != sizeof(acknowledged)) { break; }
+        }
+        ::usleep(round * 150);
+        ::kill(pid, SIGKILL);
+        int status;
+        ::waitpid(pid, &status, 0);
+        assert(WIFSIGNALED(status));
+        uint64_t k;
+        while(::read(fds[0], &k, sizeof(k)) == sizeof(k)) { acknowledged = k; }
+        ::close(fds[0]);
+
+        mio::journal journal(path, log_path);
+        const uint64_t first = read_u64(journal.data());
+        const uint64_t second = read_u64(journal.data() + journal.size() - 8);
+        assert(first == second);
+        assert(first >= acknowledged);
+        assert(first <= acknowledged + 1);
+        last = first;
+    }
+
+    // Reopening with a smaller log replays the records that lie past its new end.
+    std::remove(log_path);
+    const pid_t pid = ::fork();
+    assert(pid != -1);
+    if(pid == 0)
+    {
+        mio::journal journal(path, log_path);
+        for(uint64_t k = last + 1; k <= last + 300; ++k) { commit_counter(journal, k); }
+        // Skip the checkpoint on destruction, as a crash would.
+        ::_exit(0);
+    }
+    int status;
+    ::waitpid(pid, &status, 0);
+    assert(WIFEXITED(status));
+    mio::journal_options options;
+    options.log_capacity = 4 * mio::page_size();
+    mio::journal journal(path, log_path, options);
+    assert(journal.replayed() == 300);
+    assert(journal.log_capacity() == options.log_capacity);
+    assert(read_u64(journal.data()) == last + 300);
+    assert(read_u64(journal.data() + journal.size() - 8) == last + 300);
+    std::error_code error;
+    journal.close(error);
+    assert(!error);
+
+    // Leave a record of an older generation behind a newer one, then lose the header.
+    std::remove(log_path);
+    {
+        options.log_capacity = 2 * mio::page_size();
+        mio::journal older(path, log_path, options);
+        commit_counter(older, 1);
+        commit_counter(older, 2);
+        older.checkpoint(error);
+        assert(!error);
+        commit_counter(older, 3);
+    }
+    {
+        mio::mmap_sink log(log_path);
+        std::fill_n(log.data(), 8, 0);
+    }
+    // A crash after reopening must not replay the stale record over the new one.
+    const pid_t second = ::fork();
+    assert(second != -1);
+    if(second == 0)
+    {
+        mio::journal journal(path, log_path, options);
+        commit_counter(journal, 4);
+        ::_exit(0);
+    }
+    ::waitpid(second, &status, 0);
+    assert(WIFEXITED(status));
+    journal.open(path, log_path, options, error);
+    assert(!error);
+    assert(read_u64(journal.data()) == 4);
+}
+#endif
+
+} // namespace
+
+int main()
+{
+    const char* path = "test-durability-file";
+    test_group_commit(path);
+    test_writeback(path);
+    const char* log_path = "test-durability-log";
+    test_journal(path, log_path);
+#ifndef _WIN32
+    test_journal_crash(path, log_path);
+#endif
+    std::remove(log_path);
+    std::remove(path);
+    std::printf("all tests passed!\n");
+}
@@ -0,0 +1,730 @@
+#include <mio/mmap.hpp>
+#include <mio/chunk_reader.hpp>
+#include <mio/prefetch_reader.hpp>
+#include <mio/scan_reader.hpp>
+#include <mio/sparse_reader.hpp>
+#include <mio/direct_reader.hpp>
+#include <mio/send_range.hpp>
+#include <mio/readable_file.hpp>
+#include <mio/append_writer.hpp>
+#include <mio/follow.hpp>
+#include <mio/pack.hpp>
+#include <mio/compressed.hpp>
+#include <mio/mmap_iostream.hpp>
+
+#include <string>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+#include <cassert>
+#include <system_error>
+#include <thread>
+#include <chrono>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#endif
+
+namespace {
+
+void write_file(const char* path, const std::string& contents)
+{
+    std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+    file << contents;
+}
+
+// Reads everything through any chunk reader, via its iterators.
+template<typename Reader>
+std::string read_chunks(Reader& reader)
+{
+    std::string out;
+    for(const auto& chunk : reader)
+    {
+        assert(!chunk.empty());
+        assert(chunk.size() <= reader.chunk_size());
+        out.append(chunk.begin(), chunk.end());
+    }
+    assert(!reader.error());
+    return out;
+}
+
+void test_chunk_readers(const char* path, const std::string& buffer)
+{
+    mio::mmap_source mmap(path);
+    mio::mmap_chunk_reader mapped(mmap, 3 * mio::page_size());
+    assert(read_chunks(mapped) == buffer);
+    assert(mapped.position() == buffer.size());
+
+    // Scanning drops the pages behind the cursor, which are still readable.
+    for(const size_t offset : { size_t(0), size_t(1000) })
+    {
+        mio::mmap_source part(path, offset);
+        mio::scan_options options;
+        options.chunk_size = mio::page_size() + 1;
+        options.lag = 2 * mio::page_size();
+        options.drop_batch = 4 * mio::page_size();
+        mio::mmap_scan_reader scan(part, options);
+        assert(read_chunks(scan) == buffer.substr(offset));
+        assert(scan.dropped() > 0);
+        assert(scan.dropped() < scan.size());
+        std::error_code error;
+        scan.drop_consumed(error);
+        assert(!error);
+        assert(scan.dropped() == scan.size());
+        assert(std::equal(part.begin(), part.end(), buffer.begin() + offset));
+    }
+
+    // Prefetching doesn't change what's read, with or without the helper thread.
+    for(const bool use_helper_thread : { false, true })
+    {
+        mio::prefetch_options options;
+        options.chunk_size = 2 * mio::page_size() + 5;
+        options.distance = options.min_distance = 4 * mio::page_size();
+        options.max_distance = 16 * mio::page_size();
+        options.use_helper_thread = use_helper_thread;
+        mio::mmap_prefetch_reader prefetch(mmap, options);
+        assert(read_chunks(prefetch) == buffer);
+        const auto stats = prefetch.stats();
+        assert(stats.chunks() == (buffer.size() + options.chunk_size - 1) / options.chunk_size);
+        assert(stats.hit_rate() >= 0.0 && stats.hit_rate() <= 1.0);
+        assert(stats.bytes_advised > 0);
+        assert(stats.distance >= options.min_distance && stats.distance <= options.max_distance);
+    }
+    {
+        // Stalls shorter than the threshold never grow the distance.
+        mio::prefetch_options options;
+        options.chunk_size = mio::page_size();
+        options.distance = 8 * mio::page_size();
+        options.min_distance = 4 * mio::page_size();
+        options.stall_threshold = std::chrono::hours(1);
+        mio::mmap_prefetch_reader prefetch(mmap, options);
+        assert(read_chunks(prefetch) == buffer);
+        assert(prefetch.stats().distance <= options.distance);
+    }
+
+    auto pool = std::make_shared<mio::buffer_pool>(2 * mio::page_size());
+    for(unsigned depth : { 2u, 3u, 5u })
+    {
+        mio::direct_reader_options options;
+        options.chunk_size = 2 * mio::page_size();
+        options.depth = depth;
+        options.pool = pool;
+        mio::direct_reader direct(path, options);
+        assert(direct.is_open());
+        assert(direct.size() == buffer.size());
+        assert(read_chunks(direct) == buffer);
+        assert(direct.position() == buffer.size());
+        direct.close();
+        // All buffers made it back to the shared pool for the next reader.
+        assert(pool->free_count() == std::max<size_t>(depth, 2));
+    }
+
+    // The pool's buffers must be large enough for the chunks.
+    std::error_code error;
+    mio::direct_reader_options options;
+    options.chunk_size = 4 * mio::page_size();
+    options.pool = pool;
+    mio::direct_reader direct;
+    direct.open(path, options, error);
+    assert(error);
+    assert(!direct.is_open());
+
+    direct.open("garbage-that-hopefully-doesnt-exist", mio::direct_reader_options(), error);
+    assert(error);
+
+    // Reads may run on a pool other than the shared one.
+    mio::thread_pool workers(1);
+    direct.open(path, mio::direct_reader_options(), error, workers);
+    assert(!error);
+    assert(read_chunks(direct) == buffer);
+    direct.close();
+}
+
+void test_readable_file(const char* path, const std::string& buffer)
+{
+    const char* small_path = "test-io-small-file";
+    const std::string small = buffer.substr(0, 1000);
+    write_file(small_path, small);
+    {
+        mio::readable_file file(small_path);
+        assert(file.backend() == mio::read_backend::pread);
+        assert(file.size() == small.size());
+        assert(read_chunks(file) == small);
+        std::error_code error;
+        const auto tail = file.read(990, 100, error);
+        assert(!error);
+        assert(std::string(tail.begin(), tail.end()) == small.substr(990));
+    }
+    std::remove(small_path);
+
+    const struct { mio::access_pattern pattern; mio::read_backend backend; } cases[] = {
+        { mio::access_pattern::normal, mio::read_backend::mmap },
+        { mio::access_pattern::random, mio::read_backend::mmap },
+        { mio::access_pattern::sequential, mio::read_backend::stream },
+    };
+    for(const auto& c : cases)
+    {
+        mio::readable_file_options options;
+        options.pattern = c.pattern;
+        mio::readable_file file(path, options);
+        assert(file.backend() == c.backend);
+        assert(file.size() == buffer.size());
+        assert(file.is_size_known());
+        assert(read_chunks(file) == buffer);
+        assert(file.position() == buffer.size());
+
+        // Random access works on any regular file.
+        std::error_code error;
+        const auto range = file.read(5 * mio::page_size() + 3, 100, error);
+        assert(!error);
+        assert(std::string(range.begin(), range.end())
+            == buffer.substr(5 * mio::page_size() + 3, 100));
+        assert(file.read(buffer.size(), 1, error).empty());
+        assert(!error);
+    }
+
+    std::error_code error;
+    mio::readable_file file;
+    file.open("garbage-that-hopefully-doesnt-exist", mio::readable_file_options(), error);
+    assert(error);
+    assert(!file.is_open());
+
+#ifdef __linux__
+    // procfs files report a size of 0 but aren't empty.
+    file.open("/proc/self/status", mio::readable_file_options(), error);
+    assert(!error);
+    assert(file.backend() == mio::read_backend::stream);
+    assert(!file.is_size_known());
+    assert(read_chunks(file).find("Name:") != std::string::npos);
+
+    // Pipes are streamed and may only be read forward.
+    int fds[2];
+    assert(::pipe(fds) == 0);
+    std::thread writer([&] {
+        for(size_t n = 0; n < buffer.size(); )
+        {
+            const ssize_t ret = ::write(fds[1], buffer.data() + n, std::min<size_t>(3000, buffer.size() - n));
+            assert(ret > 0);
+            n += ret;
+        }
+        ::close(fds[1]);
+    });
+    mio::readable_file_options options;
+    options.pool = std::make_shared<mio::buffer_pool>(4 * mio::page_size());
+    file.open(fds[0], options, error);
+    assert(!error);
+    assert(file.backend() == mio::read_backend::stream);
+    auto range = file.read(100, 50, error);
+    assert(std::string(range.begin(), range.end()) == buffer.substr(100, 50));
+    // Bytes still buffered can be read again, and bytes beyond it are skipped.
+    range = file.read(120, 10, error);
+    assert(std::string(range.begin(), range.end()) == buffer.substr(120, 10));
+    range = file.read(10 * mio::page_size() + 1, 3 * mio::page_size(), error);
+    assert(!error);
+    assert(std::string(range.begin(), range.end()) == buffer.substr(10 * mio::page_size() + 1, 3 * mio::page_size()));
+    file.read(50, 1, error);
+    assert(error == std::errc::invalid_seek);
+    range = file.read(buffer.size() - 10, 100, error);
+    assert(!error);
+    assert(std::string(range.begin(), range.end()) == buffer.substr(buffer.size() - 10));
+    writer.join();
+    file.close();
+    ::close(fds[0]);
+#endif
+}
+
+void test_append_writer(const std::string& buffer)
+{
+    const char* path = "test-io-append-file";
+    std::error_code error;
+    {
+        mio::append_writer_options options;
+        options.batch_size = 1000;
+        options.truncate = true;
+        mio::append_writer writer(path, options);
+        assert(writer.size() == 0);
+        assert(writer.view(error).empty());
+        assert(!error);
+
+        // Small appends are batched, large ones are written straight away.
+        writer.append(buffer.data(), 300, error);
+        writer.append(buffer.data() + 300, 300, error);
+        assert(!error);
+        assert(writer.committed_size() == 0);
+        assert(writer.pending_size() == 600);
+        writer.append(buffer.data() + 600, 500, error);
+        assert(!error);
+        assert(writer.committed_size() == 1100);
+        assert(writer.pending_size() == 0);
+
+        auto view = writer.view(error);
+        assert(!error);
+        assert(std::string(view.begin(), view.end()) == buffer.substr(0, 1100));
+
+        writer.append(mio::span<const char>(buffer.data() + 1100, 3 * mio::page_size()), error);
+        writer.append(buffer.data() + 1100 + 3 * mio::page_size(), 10, error);
+        assert(writer.size() == 1110 + 3 * mio::page_size());
+        // The view only covers what's committed until the rest is flushed.
+        view = writer.view(error);
+        assert(view.size() == 1100 + 3 * mio::page_size());
+        writer.flush(error);
+        assert(!error);
+        // The view grows in place within the address space reserved for it.
+        const auto range = writer.read(1000, 200, error);
+        assert(!error);
+        assert(range.data() == view.data() + 1000);
+        assert(std::string(range.begin(), range.end()) == buffer.substr(1000, 200));
+        view = writer.view(error);
+        assert(std::string(view.begin(), view.end()) == buffer.substr(0, writer.size()));
+        writer.append(buffer.data(), 5, error);
+    }
+
+    // Pending bytes are written on destruction, and reopening appends.
+    mio::append_writer writer(path);
+    assert(writer.size() == 1115 + 3 * mio::page_size());
+    writer.append(buffer.data(), 7, error);
+    writer.sync(error);
+    assert(!error);
+    const auto view = writer.view(error);
+    assert(std::string(view.end() - 12, view.end()) == buffer.substr(0, 5) + buffer.substr(0, 7));
+    writer.close(error);
+    assert(!error);
+    assert(!writer.is_open());
+    writer.append(buffer.data(), 1, error);
+    assert(error == std::errc::bad_file_descriptor);
+    std::remove(path);
+}
+
+#ifdef __linux__
+std::string drain(int fd)
+{
+    std::string out;
+    char buf[4096];
+    ssize_t n;
+    while((n = ::read(fd, buf, sizeof(buf))) > 0) { out.append(buf, n); }
+    return out;
+}
+
+// Sends a range through a pipe or socket pair while another thread drains it.
+void check_send_through(int fds[2], const mio::mmap_source& mmap, const std::string& expected,
+        size_t offset, mio::send_method method)
+{
+    std::string received;
+    std::thread reader([&] { received = drain(fds[0]); });
+    std::error_code error;
+    const size_t sent = mio::send_range(mmap, offset, expected.size(), fds[1], error, method);
+    ::close(fds[1]);
+    reader.join();
+    ::close(fds[0]);
+    assert(!error);
+    assert(sent == expected.size());
+    assert(received == expected);
+}
+
+void test_send_range(const char* path, const std::string& buffer)
+{
+    // Map at an offset so that the file offset must be accounted for.
+    const size_t map_offset = 100;
+    const size_t offset = 5;
+    mio::mmap_source mmap(path, map_offset);
+    const std::string expected = buffer.substr(map_offset + offset, 20 * mio::page_size() + 3);
+
+    for(auto method : { mio::send_method::automatic, mio::send_method::splice,
+            mio::send_method::vmsplice, mio::send_method::sendfile, mio::send_method::write })
+    {
+        int fds[2];
+        assert(::pipe(fds) == 0);
+        check_send_through(fds, mmap, expected, offset, method);
+    }
+
+    for(auto method : { mio::send_method::automatic, mio::send_method::write })
+    {
+        int fds[2];
+        assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        check_send_through(fds, mmap, expected, offset, method);
+    }
+
+    // Regular files, and ranges clamped to the end of the mapping.
+    const char* out_path = "test-io-send-file";
+    const int out = ::open(out_path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    assert(out != -1);
+    std::error_code error;
+    const size_t sent = mio::send_range(mmap, offset, buffer.size(), out, error);
+    ::close(out);
+    assert(!error);
+    assert(sent == mmap.size() - offset);
+    std::ifstream file(out_path, std::ios_base::binary);
+    const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    assert(contents == buffer.substr(map_offset + offset));
+    std::remove(out_path);
+
+    mio::send_range(mmap, mmap.size() + 1, 1, 1, error);
+    assert(error == std::errc::invalid_argument);
+}
+#endif
+
+void append_file(const char* path, const std::string& contents)
+{
+    std::ofstream file(path, std::ios_base::binary | std::ios_base::app);
+    file << contents;
+}
+
+void test_follow(const std::string& buffer)
+{
+    const char* path = "test-io-follow-file";
+    const size_t page_size = mio::page_size();
+    write_file(path, buffer.substr(0, 100));
+    std::error_code error;
+
+    // A mapping is extended in place as the file grows.
+    {
+        mio::mmap_source mmap(path);
+        mmap.reserve(64 * page_size, error);
+        assert(!error);
+        const char* data = mmap.data();
+        mio::follow_options options;
+        options.timeout = std::chrono::milliseconds(20);
+        mio::file_follower follower(mmap.file_handle(), options);
+        assert(!mio::follow(mmap, follower, error));
+        assert(!error);
+        assert(mmap.size() == 100);
+
+        append_file(path, buffer.substr(100, 3 * page_size));
+        assert(mio::follow(mmap, follower, error));
+        assert(mmap.size() == 100 + 3 * page_size);
+        assert(mmap.data() == data);
+        assert(std::equal(mmap.begin(), mmap.end(), buffer.begin()));
+
+        // Without a reservation, the file is mapped anew.
+        mio::mmap_source other(path);
+        append_file(path, buffer.substr(100 + 3 * page_size, 10));
+        other.extend_to_file(error);
+        assert(!error);
+        assert(other.size() == 110 + 3 * page_size);
+        assert(std::equal(other.begin(), other.end(), buffer.begin()));
+    }
+
+    // A following stream waits for the writer, reading everything it appends.
+    write_file(path, buffer.substr(0, 100));
+    {
+        mio::mmap_istream is(path);
+        mio::follow_options options;
+        options.capacity = 4 * page_size;
+        is.follow(options, error);
+        assert(!error);
+        assert(is.is_following());
+
+        std::thread writer([&]
+        {
+            for(size_t n = 100; n < buffer.size(); n += 5000)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                append_file(path, buffer.substr(n, 5000));
+            }
+        });
+        std::string contents(buffer.size(), 0);
+        is.read(&contents[0], contents.size());
+        assert(is.gcount() == static_cast<std::streamsize>(buffer.size()));
+        assert(contents == buffer);
+        writer.join();
+
+        // Stopping wakes up a waiting reader, which sees the end of the file.
+        std::thread stopper([&]
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            is.stop_following();
+        });
+        assert(is.get() == std::char_traits<char>::eof());
+        stopper.join();
+        assert(!is.is_following());
+    }
+    std::remove(path);
+}
+
+void test_pack(const char* path, const std::string& buffer)
+{
+    const char* pack_path = "test-io-pack";
+    std::error_code error;
+    {
+        mio::pack_options options;
+        options.alignment = 64;
+        options.initial_capacity = 4096;
+        mio::pack_writer writer(pack_path, options);
+        for(size_t i = 0; i < 1000; ++i)
+        {
+            const std::string name = "entry/" + std::to_string(i);
+            writer.add(name, buffer.data() + i, i % 300, error);
+            assert(!error);
+        }
+        writer.add_file("file", path, error);
+        assert(!error);
+        assert(writer.size() == 1001);
+        writer.close(error);
+        assert(!error);
+    }
+
+    mio::pack_reader reader(pack_path);
+    assert(reader.size() == 1001);
+    for(size_t i = 0; i < 1000; ++i)
+    {
+        const auto data = reader.find("entry/" + std::to_string(i));
+        assert(data.data());
+        assert(reinterpret_cast<uintptr_t>(data.data()) % 64 == 0);
+        assert(std::string(data.data(), data.size()) == buffer.substr(i, i % 300));
+    }
+    const auto file = reader.find("file");
+    assert(std::string(file.data(), file.size()) == buffer);
+    assert(reader.contains("entry/0"));
+    assert(!reader.contains("entry/1000"));
+    assert(!reader.find("missing").data());
+
+    size_t visited = 0;
+    reader.for_each([&](mio::span<const char> name, mio::span<const char> data)
+    {
+        assert(reader.find(std::string(name.data(), name.size())).data() == data.data());
+        ++visited;
+    });
+    assert(visited == 1001);
+    reader.close();
+
+    // Duplicate names leave the archive without a valid header.
+    {
+        mio::pack_writer writer(pack_path);
+        writer.add("a", "1", 1, error);
+        writer.add("a", "2", 1, error);
+        writer.close(error);
+        assert(error == std::errc::file_exists);
+    }
+    reader.open(pack_path, error);
+    assert(error == std::errc::invalid_argument);
+    assert(!reader.is_open());
+
+    mio::pack_writer writer;
+    mio::pack_options options;
+    options.alignment = 3;
+    writer.open(pack_path, options, error);
+    assert(error == std::errc::invalid_argument);
+
+    std::remove(pack_path);
+}
+
+void test_compressed(const std::string& buffer)
+{
+    const char* container_path = "test-io-compressed";
+    // Compressible text, the incompressible test buffer and a long run.
+    std::string data;
+    for(size_t i = 0; data.size() < 300000; ++i) { data += "line " + std::to_string(i % 1000) + "\n"; }
+    data += buffer;
+    data += std::string(100000, 'z');
+
+    mio::lz_codec codec;
+    std::string packed(mio::lz_codec::compress_bound(data.size()), '\0');
+    const size_t packed_size = codec.compress(data.data(), data.size(), &packed[0], packed.size());
+    assert(packed_size > 0 && packed_size < data.size());
+    std::string unpacked(data.size(), '\0');
+    assert(codec.decompress(packed.data(), packed_size, &unpacked[0], unpacked.size()));
+    assert(unpacked == data);
+    assert(!codec.decompress(packed.data(), packed_size - 1, &unpacked[0], unpacked.size()));
+    assert(!codec.decompress(packed.data(), packed_size, &unpacked[0], unpacked.size() - 1));
+
+    std::error_code error;
+    {
+        mio::compressed_writer_options options;
+        options.block_size = 16 << 10;
+        options.initial_capacity = 4096;
+        mio::compressed_writer writer(container_path, options);
+        // Writes straddle blocks.
+        for(size_t offset = 0; offset < data.size(); offset += 10000)
+        {
+            writer.write(data.data() + offset, std::min<size_t>(10000, data.size() - offset), error);
+            assert(!error);
+        }
+        assert(writer.size() == data.size());
+        assert(writer.compressed_size() < data.size());
+        writer.close(error);
+        assert(!error);
+    }
+
+    mio::compressed_reader_options options;
+    options.cache_size = 64 << 10;
+    options.shards = 2;
+    mio::compressed_reader reader(container_path, options);
+    assert(reader.size() == data.size());
+    assert(reader.block_count() == (data.size() + (16 << 10) - 1) / (16 << 10));
+
+    std::string all(data.size(), '\0');
+    assert(reader.read(0, &all[0], all.size(), error) == data.size());
+    assert(!error && all == data);
+    for(size_t offset = 7; offset < data.size(); offset += 12345)
+    {
+        char chunk[5000];
+        const size_t n = reader.read(offset, chunk, sizeof(chunk), error);
+        assert(!error);
+        assert(n == std::min(sizeof(chunk), data.size() - offset));
+        assert(std::string(chunk, n) == data.substr(offset, n));
+
+        const auto view = reader.view(offset, error);
+        assert(!error);
+        assert((offset + view.size()) % (16 << 10) == 0 || offset + view.size() == data.size());
+        assert(std::string(view.begin(), view.end()) == data.substr(offset, view.size()));
+    }
+    assert(reader.view(data.size(), error).empty());
+    assert(reader.read(data.size() - 3, &all[0], 100, error) == 3);
+
+    // Views keep their block alive once evicted.
+    const auto first = reader.view(0, error);
+    for(size_t offset = 0; offset < data.size(); offset += 16 << 10) { reader.view(offset, error); }
+    assert(std::string(first.begin(), first.end()) == data.substr(0, first.size()));
+    const auto stats = reader.stats();
+    assert(stats.hits > 0 && stats.misses > 0 && stats.evictions > 0);
+    reader.close();
+
+    // A block whose index entry points past the end of the file is reported.
+    {
+        namespace format = mio::detail::compressed_format;
+        mio::mmap_sink file(container_path);
+        format::header header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        format::index_entry entry;
+        std::memcpy(&entry, file.data() + header.index_offset, sizeof(entry));
+        entry.size = static_cast<uint32_t>(file.size());
+        std::memcpy(file.data() + header.index_offset, &entry, sizeof(entry));
+    }
+    reader.open(container_path, error);
+    assert(!error);
+    reader.read(0, &all[0], all.size(), error);
+    assert(error == std::errc::bad_message);
+    reader.close();
+
+    // A header whose size overflows the block count check is rejected, or at
+    // least never lets a read index past the end of the index.
+    {
+        namespace format = mio::detail::compressed_format;
+        mio::mmap_sink file(container_path);
+        format::header header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        header.size = UINT64_MAX;
+        header.block_size = 2;
+        header.block_count = 0;
+        header.checksum = format::header_checksum(header);
+        std::memcpy(file.data(), &header, sizeof(header));
+    }
+    reader.open(container_path, error);
+    if(!error)
+    {
+        char byte;
+        assert(reader.read(size_t(1) << 40, &byte, 1, error) == 0);
+        assert(error == std::errc::bad_message);
+        reader.close();
+    }
+
+    write_file(container_path, data.substr(0, 1000));
+    reader.open(container_path, error);
+    assert(error == std::errc::invalid_argument);
+    assert(!reader.is_open());
+
+    std::remove(container_path);
+}
+
+#ifndef _WIN32
+void test_sparse_reader()
+{
+    const char* path = "test-io-sparse";
+    const size_t size = 8 << 20;
+    const size_t written[] = { 1 << 20, (5 << 20) + 100 };
+    {
+        std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+        for(const size_t offset : written)
+        {
+            file.seekp(offset);
+            file << std::string(4096, 'x');
+        }
+        file.seekp(size - 1);
+        file.put('\0');
+    }
+
+    // Whether or not the file system keeps the holes, the extents must hold all
+    // the data, in order.
+    for(const size_t offset : { size_t(0), size_t(1 << 20) })
+    {
+        mio::mmap_source mmap(path, offset);
+        std::error_code error;
+        const auto extents = mmap.data_extents(error);
+        assert(!error);
+        assert(!extents.empty());
+        for(size_t i = 0; i < extents.size(); ++i)
+        {
+            assert(extents[i].length > 0);
+            assert(extents[i].offset + extents[i].length <= mmap.size());
+            if(i > 0) { assert(extents[i].offset >= extents[i - 1].offset + extents[i - 1].length); }
+        }
+
+        mio::mmap_sparse_reader reader(mmap, 1000);
+        assert(!reader.error());
+        std::string seen(mmap.size(), '\0');
+        size_t total = 0;
+        for(const auto& chunk : reader)
+        {
+            assert(chunk.size() <= 1000);
+            std::copy(chunk.begin(), chunk.end(), seen.begin() + reader.offset_of(chunk));
+            total += chunk.size();
+        }
+        assert(total == reader.size());
+        assert(seen == std::string(mmap.begin(), mmap.end()));
+
+        const auto parts = mio::split_extents(extents, 3);
+        assert(!parts.empty() && parts.size() <= 3);
+        size_t split_total = 0;
+        for(const auto& part : parts)
+        {
+            mio::mmap_sparse_reader part_reader(mmap, part, 1 << 16);
+            for(const auto& chunk : part_reader) { split_total += chunk.size(); }
+        }
+        assert(split_total == reader.size());
+    }
+
+    // The offset of a handle the caller mapped is left where it was.
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    assert(fd != -1);
+    assert(::lseek(fd, 123, SEEK_SET) == 123);
+    {
+        mio::mmap_source mmap(fd, 0, mio::map_entire_file);
+        std::error_code error;
+        assert(!mmap.data_extents(error).empty());
+        assert(!error);
+    }
+    assert(::lseek(fd, 0, SEEK_CUR) == 123);
+    ::close(fd);
+
+    std::remove(path);
+}
+#endif
+
+} // namespace
+
+int main()
+{
+    const char* path = "test-io-file";
+    std::string buffer(37 * mio::page_size() + 77, 0);
+    for(size_t i = 0; i < buffer.size(); ++i) { buffer[i] = static_cast<char>(i * 13 + i / 4096); }
+    write_file(path, buffer);
+
+    test_chunk_readers(path, buffer);
+    test_readable_file(path, buffer);
+    test_append_writer(buffer);
+    test_follow(buffer);
+    test_pack(path, buffer);
+    test_compressed(buffer);
+#ifndef _WIN32
+    test_sparse_reader();
+#endif
+#ifdef __linux__
+    test_send_range(path, buffer);
+#endif
+
+    std::remove(path);
+    std::printf("all tests passed!\n");
+}
@@ -0,0 +1,111 @@
+#include <mio/mmap_iostream.hpp>
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cassert>
+#include <system_error>
+
+namespace {
+
+std::string read_file(const char* path)
+{
+    std::ifstream file(path, std::ios_base::binary);
+    std::ostringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+}
+
+void write_file(const char* path, const std::string& contents)
+{
+    std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+    file << contents;
+}
+
+} // namespace
+
+int main()
+{
+    const char* path = "test-streambuf-file";
+    const auto page_size = mio::page_size();
+
+    // The default mode truncates to whatever was written.
+    write_file(path, std::string(3 * page_size, 'x'));
+    {
+        mio::mmap_ostream os(path);
+        os << "hello";
+    }
+    assert(read_file(path) == "hello");
+
+    // Appending to a file larger than a page maps only its tail, but positions
+    // still refer to the whole file.
+    const std::string prefix(2 * page_size + 17, 'a');
+    write_file(path, prefix);
+    {
+        mio::mmap_ostream os(path, std::ios_base::out | std::ios_base::app);
+        assert(os.file_offset() == 2 * page_size);
+        assert(static_cast<size_t>(os.tellp()) == prefix.size());
+        os << "tail";
+        // Writes always go to the end in append mode.
+        os.seekp(prefix.size());
+        os << "!";
+        assert(static_cast<size_t>(os.tellp()) == prefix.size() + 5);
+    }
+    assert(read_file(path) == prefix + "tail!");
+
+    // Growing past the initial mapping keeps earlier contents intact.
+    const std::string big(4 * page_size + 3, 'b');
+    {
+        mio::mmap_ostream os(path, std::ios_base::app);
+        os.write(big.data(), big.size());
+    }
+    assert(read_file(path) == prefix + "tail!" + big);
+
+    // `ate` starts at the end without truncating, but may seek back.
+    write_file(path, "0123456789");
+    {
+        mio::mmap_iostream ios(path, std::ios_base::in | std::ios_base::out | std::ios_base::ate);
+        assert(ios.tellp() == 10);
+        ios << "ab";
+        ios.seekp(0);
+        ios << "X";
+    }
+    assert(read_file(path) == "X123456789ab");
+
+    // `in | out` keeps the contents even when less is written than was there.
+    {
+        mio::mmap_iostream ios(path, std::ios_base::in | std::ios_base::out);
+        char c = 0;
+        ios.get(c);
+        assert(c == 'X');
+        ios.seekp(1);
+        ios << "Y";
+    }
+    assert(read_file(path) == "XY23456789ab");
+
+    // Appending to a file that does not exist yet creates it.
+    std::remove(path);
+    {
+        mio::mmap_ostream os(path, std::ios_base::app);
+        assert(os.tellp() == 0);
+    }
+    assert(read_file(path).empty());
+    {
+        mio::mmap_ostream os(path, std::ios_base::app);
+        os << "fresh";
+    }
+    assert(read_file(path) == "fresh");
+
+    {
+        mio::mmap_istream is(path, std::ios_base::in | std::ios_base::ate);
+        assert(is.tellg() == 5);
+        is.seekg(-2, std::ios_base::end);
+        std::string s;
+        is >> s;
+        assert(s == "sh");
+    }
+
+    std::remove(path);
+    std::printf("all tests passed!\n");
+}
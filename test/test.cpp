@@ -27,6 +27,9 @@ void test_at_offset(const MMap& file_view, const std::string& buffer,
 void test_at_offset(const std::string& buffer, const char* path,
         const size_t offset, std::error_code& error);
 int handle_error(const std::error_code& error);
+#ifndef _WIN32
+void test_reserve(const std::string& buffer, const size_t offset);
+#endif
 
 int main()
 {
@@ -102,6 +105,56 @@ int main()
         CHECK_INVALID_MMAP(m);
     }
 
+    // Opening with options.
+    {
+        mio::open_options options;
+        options.no_atime = true;
+        options.pattern = mio::access_pattern::sequential;
+        options.readahead = 2 * page_size;
+        mio::mmap_source m(path, page_size + 3, mio::map_entire_file, options);
+        assert(m.size() == buffer.size() - page_size - 3);
+        assert(std::equal(m.begin(), m.end(), buffer.begin() + page_size + 3));
+
+        const char* new_path = "test-open-options-file";
+        std::remove(new_path);
+        options = mio::open_options();
+        options.creation = mio::creation_policy::open_existing;
+        auto sink = mio::make_mmap_sink(new_path, 0, 0, options, error);
+        CHECK_INVALID_MMAP(sink);
+
+        // New files are zero-filled up to their initial size.
+        options.creation = mio::creation_policy::create_new;
+        options.initial_size = 3 * page_size + 1;
+        options.preallocate = true;
+        sink = mio::make_mmap_sink(new_path, 0, 0, options, error);
+        if(error) { return handle_error(error); }
+        assert(sink.size() == 3 * page_size + 1);
+        assert(std::all_of(sink.begin(), sink.end(), [](char c) { return c == 0; }));
+        sink.unmap();
+        sink = mio::make_mmap_sink(new_path, 0, 0, options, error);
+        assert(error == std::errc::file_exists);
+        error.clear();
+
+        // An empty file is still given a page by default.
+        std::ofstream(new_path, std::ios_base::trunc).close();
+        sink = mio::make_mmap_sink(new_path, 0, 0, mio::open_options(), error);
+        if(error) { return handle_error(error); }
+        assert(sink.size() == page_size);
+        assert(std::all_of(sink.begin(), sink.end(), [](char c) { return c == 0; }));
+        sink.unmap();
+        std::remove(new_path);
+
+#ifndef _WIN32
+        // Handles are inherited by default, and closed on exec on request.
+        mio::mmap_source inherited(path);
+        assert(!(::fcntl(inherited.file_handle(), F_GETFD) & FD_CLOEXEC));
+        options = mio::open_options();
+        options.close_on_exec = true;
+        mio::mmap_source cloexec(path, 0, mio::map_entire_file, options);
+        assert(::fcntl(cloexec.file_handle(), F_GETFD) & FD_CLOEXEC);
+#endif
+    }
+
     // Make sure these compile.
     {
         mio::ummap_source _1;
@@ -128,6 +181,12 @@ int main()
 #endif
     }
 
+#ifndef _WIN32
+    // Growing within reserved address space.
+    test_reserve(buffer, 0);
+    test_reserve(buffer, page_size + 3);
+#endif
+
     std::printf("all tests passed!\n");
 }
 
@@ -180,3 +239,80 @@ int handle_error(const std::error_code& error)
     std::printf("Error mapping file: %s, exiting...\n", errmsg.c_str());
     return error.value();
 }
+
+#ifndef _WIN32
+void test_reserve(const std::string& buffer, const size_t offset)
+{
+    const char* grow_path = "test-reserve-file";
+    {
+        std::ofstream file(grow_path, std::ios_base::binary | std::ios_base::trunc);
+        file << buffer;
+    }
+
+    std::error_code error;
+    mio::mmap_sink m(grow_path, offset);
+    assert(m.capacity() == m.size());
+    const size_t page_size = mio::page_size();
+    m.reserve(64 * page_size, error);
+    if(error) { std::exit(handle_error(error)); }
+    assert(m.capacity() >= 64 * page_size);
+    assert(m.size() == buffer.size() - offset);
+    assert(std::equal(m.begin(), m.end(), buffer.begin() + offset));
+
+    // Grow in place up to the capacity.
+    const char* data = m.data();
+    for(size_t length = m.size() + page_size; length <= m.capacity(); length += page_size)
+    {
+        m.remap(offset, length, error);
+        if(error) { std::exit(handle_error(error)); }
+        assert(m.data() == data);
+        m[length - 1] = 'x';
+    }
+    assert(std::equal(buffer.begin() + offset, buffer.end(), m.begin()));
+
+    // Growing past it fails rather than moving the mapping, until more is reserved.
+    const size_t size = m.size();
+    m.remap(offset, m.capacity() + page_size, error);
+    assert(error == std::errc::not_enough_memory);
+    assert(m.data() == data);
+    assert(m.size() == size);
+    m.reserve(80 * page_size, error);
+    assert(!error);
+    m.remap(offset, 80 * page_size, error);
+    assert(!error);
+    assert(m.capacity() >= 80 * page_size);
+    data = m.data();
+    assert(std::equal(buffer.begin() + offset, buffer.end(), m.begin()));
+
+    // Shrink, then grow again without moving.
+    m.truncate(offset + 10, error);
+    if(error) { std::exit(handle_error(error)); }
+    assert(m.data() == data);
+    assert(m.size() == 10);
+    m.truncate(offset, error);
+    assert(!error);
+    assert(m.is_open());
+    assert(m.size() == 0);
+    m.remap(offset, 3 * page_size, error);
+    assert(!error);
+    assert(m.data() == data);
+    // The file was cut at `offset`, so the bytes are new.
+    assert(m[0] == 0);
+    assert(m[3 * page_size - 1] == 0);
+
+    // Moving keeps the reservation with the mapping.
+    mio::mmap_sink moved = std::move(m);
+    assert(moved.data() == data);
+    moved.remap(offset, 5 * page_size, error);
+    assert(!error);
+    assert(moved.data() == data);
+
+    // A different offset gives up the reservation.
+    moved.remap(offset + page_size, page_size, error);
+    assert(!error);
+    assert(moved.capacity() == moved.size());
+    moved.unmap();
+
+    std::remove(grow_path);
+}
+#endif